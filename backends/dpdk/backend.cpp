@@ -13,17 +13,20 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
+#include <map>
 #include <unordered_map>
 #include "backend.h"
 #include "backends/bmv2/psa_switch/psaSwitch.h"
 #include "dpdkArch.h"
 #include "dpdkAsmOpt.h"
+#include "dpdkCostReport.h"
 #include "dpdkHelpers.h"
 #include "dpdkProgram.h"
 #include "dpdkVarCollector.h"
 #include "midend/eliminateTypedefs.h"
 #include "ir/dbprint.h"
 #include "ir/ir.h"
+#include "lib/nullstream.h"
 #include "lib/stringify.h"
 
 namespace DPDK {
@@ -54,6 +57,11 @@ void PsaSwitchBackend::convert(const IR::ToplevelBlock *tlb) {
         // because the user metadata type has changed
         new P4::ClearTypeMap(typeMap),
         new P4::TypeChecking(refMap, typeMap),
+        new PassIf([this]() { return options.flowCache; }, {
+            new DPDK::InsertFlowCache(refMap, typeMap),
+            new P4::ClearTypeMap(typeMap),
+            new P4::TypeChecking(refMap, typeMap),
+        }),
         new BMV2::LowerExpressions(typeMap),
         new P4::ConstantFolding(refMap, typeMap, false),
         new P4::TypeChecking(refMap, typeMap),
@@ -97,8 +105,21 @@ void PsaSwitchBackend::convert(const IR::ToplevelBlock *tlb) {
         return;
     PassManager post_code_gen = {
         new EliminateUnusedAction(),
-        new DpdkAsmOptimization,
     };
+    if (options.optimizeInstructions)
+        post_code_gen.addPasses({new DpdkInstructionOptimization});
+    post_code_gen.addPasses({new DpdkAsmOptimization});
+    if (!options.mergeActions.isNullOrEmpty()) {
+        actionMerging = new DpdkActionMerging;
+        post_code_gen.addPasses({actionMerging});
+    }
+    // The metadata layout follows the order of the table keys.
+    if (!options.optimizeTableKeys.isNullOrEmpty()) {
+        tableKeys = new OptimizeTableKeys;
+        post_code_gen.addPasses({tableKeys});
+    }
+    if (options.optimizeMetadataLayout)
+        post_code_gen.addPasses({new DpdkMetadataLayout});
 
     dpdk_program = dpdk_program->apply(post_code_gen)->to<IR::DpdkAsmProgram>();
 }
@@ -107,4 +128,61 @@ void PsaSwitchBackend::codegen(std::ostream &out) const {
     dpdk_program->toSpec(out) << std::endl;
 }
 
+// One file per table, so that the tables can be loaded independently and in
+// parallel with "pipeline PIPELINE0 table <table> add <file>".
+void PsaSwitchBackend::emitConstEntries(cstring dir) const {
+    for (auto t : dpdk_program->tables) {
+        std::stringstream entries;
+        t->entriesToSpec(entries, dpdk_program->actions, dpdk_program->structType);
+        if (entries.str().empty())
+            continue;
+        std::ostream *out = openFile(dir + "/" + t->name + ".txt", false);
+        if (out == nullptr)
+            continue;
+        *out << entries.str();
+        out->flush();
+    }
+}
+
+// The P4Info is written before the back-end runs and still lists the
+// removed actions, so the control plane needs their replacements.
+void PsaSwitchBackend::emitMergedActions(cstring file) const {
+    std::ostream *out = openFile(file, false);
+    if (out == nullptr)
+        return;
+    if (actionMerging != nullptr) {
+        std::map<cstring, cstring> sorted(actionMerging->getReplacements().begin(),
+                                          actionMerging->getReplacements().end());
+        for (auto &r : sorted)
+            *out << r.first << " " << r.second << std::endl;
+    }
+    out->flush();
+}
+
+// The control plane builds its entries from the P4Info, which lists the key
+// fields in P4 order with their P4 match kinds.
+void PsaSwitchBackend::emitTableKeys(cstring file) const {
+    std::ostream *out = openFile(file, false);
+    if (out == nullptr)
+        return;
+    if (tableKeys != nullptr) {
+        for (auto &k : tableKeys->getChangedKeys())
+            *out << k.table << " " << k.p4infoName << " " << k.field << " " <<
+                k.p4infoKind << " " << k.kind << std::endl;
+    }
+    out->flush();
+}
+
+void PsaSwitchBackend::emitCostReport(cstring file) const {
+    PipelineCostReport report;
+    dpdk_program->apply(report);
+    std::ostream *out = openFile(file, false);
+    if (out == nullptr)
+        return;
+    report.toJson()->serialize(*out);
+    *out << std::endl;
+    out->flush();
+    report.toText(std::cout);
+}
+
 }  // namespace DPDK
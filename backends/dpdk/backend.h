@@ -27,6 +27,7 @@ limitations under the License.
 #include "backends/bmv2/common/parser.h"
 #include "backends/bmv2/common/programStructure.h"
 #include "backends/bmv2/psa_switch/psaSwitch.h"
+#include "backends/dpdk/options.h"
 #include "frontends/common/constantFolding.h"
 #include "frontends/common/resolveReferences/referenceMap.h"
 #include "frontends/p4/coreLibrary.h"
@@ -41,17 +42,30 @@ limitations under the License.
 #include "lib/json.h"
 
 namespace DPDK {
+class DpdkActionMerging;
+class OptimizeTableKeys;
+
 class PsaSwitchBackend : public BMV2::Backend {
-    BMV2::BMV2Options &options;
+    PsaSwitchOptions &options;
     const IR::DpdkAsmProgram *dpdk_program = nullptr;
+    DpdkActionMerging *actionMerging = nullptr;
+    OptimizeTableKeys *tableKeys = nullptr;
 
   public:
     void convert(const IR::ToplevelBlock *tlb) override;
-    PsaSwitchBackend(BMV2::BMV2Options &options, P4::ReferenceMap *refMap,
+    PsaSwitchBackend(PsaSwitchOptions &options, P4::ReferenceMap *refMap,
                      P4::TypeMap *typeMap,
                      P4::ConvertEnums::EnumMapping *enumMap)
         : Backend(options, refMap, typeMap, enumMap), options(options) {}
     void codegen(std::ostream &) const;
+    /// Writes the const entries of each table to dir/<table>.txt.
+    void emitConstEntries(cstring dir) const;
+    /// Writes to file the name of each merged action and of its replacement.
+    void emitMergedActions(cstring file) const;
+    /// Writes to file the new key of each table whose key was optimized.
+    void emitTableKeys(cstring file) const;
+    /// Writes the cost report of the program to file, and prints it.
+    void emitCostReport(cstring file) const;
 };
 
 } // namespace DPDK
@@ -29,6 +29,7 @@ limitations under the License.
 #include "frontends/p4/externInstance.h"
 #include "frontends/p4/typeMap.h"
 #include "frontends/p4/tableApply.h"
+#include "midend/flowCache.h"
 
 namespace DPDK {
 
@@ -618,11 +619,21 @@ const IR::Node *IfStatementUnroll::postorder(IR::P4Control *a) {
 bool LogicalExpressionUnroll::preorder(const IR::Operation_Unary *u) {
     expressionUnrollSanityCheck(u->expr);
 
+    // A negation is lowered into jumps with the expression it negates, so it
+    // needs no temporary either.
+    if (u->is<IR::LNot>()) {
+        visit(u->expr);
+        root = new IR::LNot(root ? root : u->expr);
+        return false;
+    }
+
     // If the expression is a methodcall expression, do not insert a temporary
     // variable to represent the value of the methodcall. Instead the
     // methodcall is converted to a dpdk branch instruction in a later pass.
-    if (u->expr->is<IR::MethodCallExpression>())
+    if (u->expr->is<IR::MethodCallExpression>()) {
+        root = nullptr;
         return false;
+    }
 
     // if the expression is apply().hit or apply().miss, do not insert a temporary
     // variable.
@@ -630,6 +641,7 @@ bool LogicalExpressionUnroll::preorder(const IR::Operation_Unary *u) {
         if (member->expr->is<IR::MethodCallExpression>() &&
             (member->member == IR::Type_Table::hit ||
              member->member == IR::Type_Table::miss)) {
+            root = nullptr;
             return false;
         }
     }
@@ -916,6 +928,32 @@ const IR::Node *PrependPDotToActionArgs::postorder(IR::P4Program *program) {
     return program;
 }
 
+const IR::Node *PrependPDotToActionArgs::postorder(IR::Entry *e) {
+    auto call = e->action->to<IR::MethodCallExpression>();
+    if (call == nullptr || call->arguments->size() == 0)
+        return e;
+    auto path = call->method->to<IR::PathExpression>();
+    if (path == nullptr)
+        return e;
+    // The reference map still points to the action with its parameters;
+    // the fields of the struct keep the original names of the parameters.
+    auto action = refMap->getDeclaration(path->path)->to<IR::P4Action>();
+    if (action == nullptr)
+        return e;
+    auto params = action->parameters->parameters;
+    IR::IndexedVector<IR::NamedExpression> components;
+    for (size_t i = 0; i < call->arguments->size(); i++) {
+        auto arg = call->arguments->at(i);
+        cstring name = arg->name ? arg->name.toString() : params.at(i)->name.toString();
+        components.push_back(new IR::NamedExpression(name, arg->expression));
+    }
+    auto args = new IR::Vector<IR::Argument>();
+    args->push_back(new IR::Argument(new IR::StructExpression(
+        new IR::Type_Name(IR::ID(action->name.toString() + "_arg_t")), components)));
+    e->action = new IR::MethodCallExpression(call->srcInfo, call->method, args);
+    return e;
+}
+
 const IR::Node *PrependPDotToActionArgs::preorder(IR::PathExpression *path) {
     auto declaration = refMap->getDeclaration(path->path);
     if (auto action = findContext<IR::P4Action>()) {
@@ -1404,4 +1442,82 @@ const IR::Node* SplitActionSelectorTable::postorder(IR::SwitchStatement* stateme
     return statement;
 }
 
+namespace {
+// A copy of a field of a parameter or of a local variable of the control.
+const IR::Expression* cloneField(const IR::Expression* field) {
+    if (auto m = field->to<IR::Member>())
+        return new IR::Member(cloneField(m->expr), m->member);
+    auto path = field->to<IR::PathExpression>();
+    BUG_CHECK(path != nullptr, "%1%: unexpected flow cache field", field);
+    return new IR::PathExpression(path->path->name);
+}
+}  // namespace
+
+const IR::Node* InsertFlowCache::preorder(IR::P4Control* control) {
+    P4::FindFlowCacheRegions find(refMap, typeMap);
+    (void)getOriginal<IR::P4Control>()->apply(find);
+    for (auto r : find.regions) {
+        auto region = r.second;
+        cstring tableName = refMap->newName(control->name + "_flow_cache");
+
+        // the hit action restores the fields written by the region
+        auto params = new IR::ParameterList();
+        auto restore = new IR::BlockStatement();
+        for (auto field : region->value) {
+            cstring param = field->toString().replace('.', '_');
+            params->parameters.push_back(new IR::Parameter(param, IR::Direction::None,
+                                                           typeMap->getType(field, true)));
+            restore->push_back(new IR::AssignmentStatement(
+                    cloneField(field), new IR::PathExpression(param)));
+        }
+        auto tableOnly = new IR::Annotations();
+        tableOnly->add(new IR::Annotation(IR::Annotation::tableOnlyAnnotation, {}));
+        cstring hitName = refMap->newName(tableName + "_hit");
+        auto hit = new IR::P4Action(hitName, tableOnly, params, restore);
+
+        auto defaultOnly = new IR::Annotations();
+        defaultOnly->add(new IR::Annotation(IR::Annotation::defaultOnlyAnnotation, {}));
+        cstring missName = refMap->newName(tableName + "_miss");
+        auto miss = new IR::P4Action(missName, defaultOnly, new IR::ParameterList(),
+                                     new IR::BlockStatement());
+
+        IR::Vector<IR::KeyElement> keys;
+        for (auto field : region->key) {
+            keys.push_back(new IR::KeyElement(cloneField(field),
+                    new IR::PathExpression(P4::P4CoreLibrary::instance.exactMatch.Id())));
+        }
+        IR::IndexedVector<IR::ActionListElement> actionsList;
+        actionsList.push_back(new IR::ActionListElement(
+                new IR::MethodCallExpression(new IR::PathExpression(hitName))));
+        actionsList.push_back(new IR::ActionListElement(
+                new IR::MethodCallExpression(new IR::PathExpression(missName))));
+        IR::IndexedVector<IR::Property> properties;
+        properties.push_back(new IR::Property("key", new IR::Key(keys), false));
+        properties.push_back(new IR::Property("actions", new IR::ActionList(actionsList), false));
+        properties.push_back(new IR::Property("default_action",
+                new IR::ExpressionValue(
+                        new IR::MethodCallExpression(new IR::PathExpression(missName))),
+                false));
+        properties.push_back(new IR::Property("size",
+                new IR::ExpressionValue(new IR::Constant(region->size)), false));
+        auto table = new IR::P4Table(tableName, new IR::TableProperties(properties));
+
+        control->controlLocals.push_back(hit);
+        control->controlLocals.push_back(miss);
+        control->controlLocals.push_back(table);
+        cacheTables.emplace(r.first, tableName);
+    }
+    return control;
+}
+
+const IR::Node* InsertFlowCache::postorder(IR::BlockStatement* block) {
+    auto it = cacheTables.find(getOriginal<IR::BlockStatement>());
+    if (it == cacheTables.end())
+        return block;
+    auto hit = new IR::Member(new IR::MethodCallExpression(
+            new IR::Member(new IR::PathExpression(it->second),
+                           IR::ID(IR::IApply::applyMethodName))), "hit");
+    return new IR::IfStatement(block->srcInfo, new IR::LNot(hit), block, nullptr);
+}
+
 }  // namespace DPDK
@@ -281,14 +281,8 @@ class LogicalExpressionUnroll : public Inspector {
     IR::IndexedVector<IR::Declaration> decl;
     IR::Expression *root;
     static bool is_logical(const IR::Operation_Binary *bin) {
-        if (bin->is<IR::LAnd>() || bin->is<IR::LOr>() || bin->is<IR::Leq>() ||
-            bin->is<IR::Equ>() || bin->is<IR::Neq>() || bin->is<IR::Grt>() ||
-            bin->is<IR::Lss>())
-            return true;
-        else if (bin->is<IR::Geq>() or bin->is<IR::Leq>()) {
-            BUG("%1%: not implemented", bin);
-        } else
-            return false;
+        return bin->is<IR::LAnd>() || bin->is<IR::LOr>() ||
+               bin->is<IR::Operation_Relation>();
     }
 
     LogicalExpressionUnroll(P4::ReferenceMap* refMap, DpdkVariableCollector *collector)
@@ -342,6 +336,8 @@ class CollectLocalVariableToMetadata : public Transform {
 // front of action parameters. Please note that it is possible that the user
 // defines a struct paremeter himself or define multiple struct parameters in
 // action parameterlist. Current implementation does not support this.
+// The arguments of the actions called by const entries are packed into a
+// struct expression of the new struct type.
 class PrependPDotToActionArgs : public Transform {
     P4::ReferenceMap *refMap;
     BlockInfoMapping *toBlockInfo;
@@ -354,6 +350,7 @@ class PrependPDotToActionArgs : public Transform {
         : refMap(refMap), toBlockInfo(toBlockInfo) {}
     const IR::Node *postorder(IR::P4Action *a) override;
     const IR::Node *postorder(IR::P4Program *s) override;
+    const IR::Node *postorder(IR::Entry *e) override;
     const IR::Node *preorder(IR::PathExpression *path) override;
 };
 
@@ -482,108 +479,6 @@ class CollectExternDeclaration : public Inspector {
     }
 };
 
-// This pass is preparing logical expression for following branching statement
-// optimization. This pass breaks parenthesis looks liks this: (a && b) && c.
-// After this pass, the expression looks like this: a && b && c. (The AST is
-// different).
-class BreakLogicalExpressionParenthesis : public Transform {
-  public:
-    const IR::Node *postorder(IR::LAnd *land) {
-        if (auto land2 = land->left->to<IR::LAnd>()) {
-            auto sub = new IR::LAnd(land2->right, land->right);
-            return new IR::LAnd(land2->left, sub);
-        } else if (not land->left->is<IR::LOr>() and
-                   not land->left->is<IR::Equ>() and
-                   not land->left->is<IR::Neq>() and
-                   not land->left->is<IR::Lss>() and
-                   not land->left->is<IR::Grt>() and
-                   not land->left->is<IR::MethodCallExpression>() and
-                   not land->left->is<IR::PathExpression>() and
-                   not land->left->is<IR::Member>()) {
-            BUG("Logical Expression Unroll pass failed");
-        }
-        return land;
-    }
-    const IR::Node *postorder(IR::LOr *lor) {
-        if (auto lor2 = lor->left->to<IR::LOr>()) {
-            auto sub = new IR::LOr(lor2->right, lor->right);
-            return new IR::LOr(lor2->left, sub);
-        } else if (not lor->left->is<IR::LOr>() and
-                   not lor->left->is<IR::Equ>() and
-                   not lor->left->is<IR::Neq>() and
-                   not lor->left->is<IR::Lss>() and
-                   not lor->left->is<IR::Grt>() and
-                   not lor->left->is<IR::MethodCallExpression>() and
-                   not lor->left->is<IR::PathExpression>() and
-                   not lor->left->is<IR::Member>()) {
-            BUG("Logical Expression Unroll pass failed");
-        }
-        return lor;
-    }
-};
-
-// This pass will swap the simple expression to the front of an logical
-// expression. Note that even for a subexpression of a logical expression, we
-// will swap it as well. For example, a && ((b && c) || d), will become
-// a && (d || (b && c))
-class SwapSimpleExpressionToFrontOfLogicalExpression : public Transform {
-    bool is_simple(const IR::Node *n) {
-        if (n->is<IR::Equ>() or n->is<IR::Neq>() or n->is<IR::Lss>() or
-            n->is<IR::Grt>() or n->is<IR::MethodCallExpression>() or
-            n->is<IR::PathExpression>() or n->is<IR::Member>()) {
-            return true;
-        } else if (not n->is<IR::LAnd>() and not n->is<IR::LOr>()) {
-            BUG("Logical Expression Unroll pass failed");
-        } else {
-            return false;
-        }
-    }
-
-  public:
-    const IR::Node *postorder(IR::LAnd *land) {
-        if (not is_simple(land->left) and is_simple(land->right)) {
-            return new IR::LAnd(land->right, land->left);
-        } else if (not is_simple(land->left)) {
-            if (auto land2 = land->right->to<IR::LAnd>()) {
-                if (is_simple(land2->left)) {
-                    auto sub = new IR::LAnd(land->left, land2->right);
-                    return new IR::LAnd(land2->left, sub);
-                }
-            }
-        }
-        return land;
-    }
-    const IR::Node *postorder(IR::LOr *lor) {
-        if (not is_simple(lor->left) and is_simple(lor->right)) {
-            return new IR::LOr(lor->right, lor->left);
-        } else if (not is_simple(lor->left)) {
-            if (auto lor2 = lor->right->to<IR::LOr>()) {
-                if (is_simple(lor2->left)) {
-                    auto sub = new IR::LOr(lor->left, lor2->right);
-                    return new IR::LOr(lor2->left, sub);
-                }
-            }
-        }
-        return lor;
-    }
-};
-
-// This passmanager togethor transform logical expression into a form that
-// the simple expression will go to the front of the expression. And for
-// expression at the same level(the same level is that expressions that are
-// connected directly by && or ||) should be traversed from left to right
-// (a && b) && c is not a valid expression here.
-class ConvertLogicalExpression : public PassManager {
-  public:
-    ConvertLogicalExpression() {
-        auto r = new PassRepeated{new BreakLogicalExpressionParenthesis};
-        passes.push_back(r);
-        r = new PassRepeated{
-            new SwapSimpleExpressionToFrontOfLogicalExpression};
-        passes.push_back(r);
-    }
-};
-
 // This pass transforms the tables such that all the Match keys are part of the same
 // header/metadata struct. If the match keys are from different headers, this pass creates
 // mirror copies of the struct field into the metadata struct and updates the table to use
@@ -629,6 +524,34 @@ class ConvertActionSelector : public PassManager {
     }
 };
 
+/*
+ * Puts an exact match table in front of each block annotated with
+ * @flow_cache, see P4::FindFlowCacheRegions:
+ *
+ *   @flow_cache { ... }
+ *
+ * becomes
+ *
+ *   if (!ingress_flow_cache.apply().hit) { ... }
+ *
+ * The table matches on the key fields of the region; its action restores
+ * the fields the region writes. The SWX pipeline cannot add table entries
+ * from the data plane, so the control plane fills the table, and must
+ * clear it when it changes the tables of the region.
+ */
+class InsertFlowCache : public Transform {
+    P4::ReferenceMap* refMap;
+    P4::TypeMap* typeMap;
+    // The table in front of each region, by block of the original program.
+    std::map<const IR::BlockStatement*, cstring> cacheTables;
+
+  public:
+    InsertFlowCache(P4::ReferenceMap *refMap, P4::TypeMap* typeMap) :
+        refMap(refMap), typeMap(typeMap) { setName("InsertFlowCache"); }
+    const IR::Node* preorder(IR::P4Control* control) override;
+    const IR::Node* postorder(IR::BlockStatement* block) override;
+};
+
 class DpdkArchLast : public PassManager {
  public:
     DpdkArchLast() { setName("DpdkArchLast"); }
@@ -693,7 +616,6 @@ class RewriteToDpdkArch : public PassManager {
         auto p = new PrependPDotToActionArgs(&parsePsa->toBlockInfo, refMap);
         args_struct_map = &p->args_struct_map;
         passes.push_back(p);
-        passes.push_back(new ConvertLogicalExpression);
         auto insertExternDeclaration = new CollectExternDeclaration(typeMap);
         passes.push_back(insertExternDeclaration);
         externDecls = &insertExternDeclaration->externDecls;
@@ -15,158 +15,1134 @@ limitations under the License.
 */
 
 #include "dpdkAsmOpt.h"
+#include "lib/stringify.h"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace DPDK {
-// The assumption is compiler can only produce forward jumps.
-const IR::Node *RemoveRedundantLabel::postorder(IR::DpdkListStatement *l) {
+
+// defined in spec.cpp
+cstring toStr(const IR::Expression *const);
+
+bool OptimizeJumps::simplify(std::vector<const IR::DpdkAsmStatement *> &stmts) const {
+    size_t n = stmts.size();
+    // Position of each label, and for each label position the last label
+    // of the run of consecutive labels it belongs to.
+    std::unordered_map<cstring, size_t> position;
+    std::vector<cstring> runEnd(n);
+    for (size_t i = n; i-- > 0;) {
+        if (auto label = stmts[i]->to<IR::DpdkLabelStatement>()) {
+            position[label->label] = i;
+            if (i + 1 < n && stmts[i + 1]->is<IR::DpdkLabelStatement>())
+                runEnd[i] = runEnd[i + 1];
+            else
+                runEnd[i] = label->label;
+        }
+    }
+    auto canonical = [&](cstring label) {
+        auto it = position.find(label);
+        return it == position.end() ? label : runEnd[it->second];
+    };
+
+    // Final target of a jump to each label, memoized over the chains of
+    // unconditional jmps. A label is entered before its chain is followed,
+    // so a cycle of jmps stops where it closes.
+    std::unordered_map<cstring, cstring> threaded;
+    auto resolve = [&](cstring label) {
+        std::vector<cstring> path;
+        label = canonical(label);
+        while (true) {
+            auto it = threaded.find(label);
+            if (it != threaded.end()) {
+                label = it->second;
+                break;
+            }
+            threaded.emplace(label, label);
+            path.push_back(label);
+            auto pos = position.find(label);
+            if (pos == position.end() || pos->second + 1 >= n)
+                break;
+            auto jmp = stmts[pos->second + 1]->to<IR::DpdkJmpLabelStatement>();
+            if (jmp == nullptr || jmp->label == label)
+                break;
+            label = canonical(jmp->label);
+        }
+        for (auto p : path)
+            threaded[p] = label;
+        return label;
+    };
+
     bool changed = false;
-    IR::IndexedVector<IR::DpdkAsmStatement> used_labels;
-    for (auto stmt : l->statements) {
+    std::unordered_set<cstring> used;
+    std::vector<const IR::DpdkAsmStatement *> result;
+    result.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        auto stmt = stmts[i];
         if (auto jmp = stmt->to<IR::DpdkJmpStatement>()) {
-            bool found = false;
-            for (auto label : used_labels) {
-                if (label->to<IR::DpdkJmpStatement>()->label ==
-                    jmp->label) {
-                    found = true;
-                    break;
-                }
+            // A jump to the run of labels right after it falls through anyway.
+            if (i + 1 < n && stmts[i + 1]->is<IR::DpdkLabelStatement>() &&
+                runEnd[i + 1] == canonical(jmp->label)) {
+                changed = true;
+                continue;
             }
-            if (!found) {
-                used_labels.push_back(stmt);
+            cstring target = resolve(jmp->label);
+            if (target != jmp->label) {
+                auto retargeted = jmp->clone();
+                retargeted->label = target;
+                stmt = retargeted;
+                changed = true;
             }
+            used.insert(target);
         }
+        result.push_back(stmt);
     }
-    auto new_l = new IR::IndexedVector<IR::DpdkAsmStatement>;
-    for (auto stmt : l->statements) {
-        if (auto label = stmt->to<IR::DpdkLabelStatement>()) {
-            bool found = false;
-            for (auto jmp_label : used_labels) {
-                if (jmp_label->to<IR::DpdkJmpStatement>()->label ==
-                    label->label) {
-                    found = true;
-                    break;
+
+    stmts.clear();
+    for (auto stmt : result) {
+        auto label = stmt->to<IR::DpdkLabelStatement>();
+        if (label != nullptr && !used.count(label->label)) {
+            changed = true;
+            continue;
+        }
+        stmts.push_back(stmt);
+    }
+    return changed;
+}
+
+const IR::Node *OptimizeJumps::postorder(IR::DpdkListStatement *l) {
+    std::vector<const IR::DpdkAsmStatement *> stmts(l->statements.begin(),
+                                                    l->statements.end());
+    bool changed = false;
+    while (simplify(stmts))
+        changed = true;
+    if (changed) {
+        IR::IndexedVector<IR::DpdkAsmStatement> new_l;
+        for (auto stmt : stmts)
+            new_l.push_back(stmt);
+        l->statements = new_l;
+    }
+    return l;
+}
+
+namespace {
+
+// Header and metadata fields are members of h and m (e.g. h.ipv4.ttl); the
+// temporaries added during the conversion are plain names (e.g. m.tmpMask).
+bool isField(const IR::Expression *e) {
+    while (auto m = e->to<IR::Member>())
+        e = m->expr;
+    return e->is<IR::PathExpression>();
+}
+
+cstring fieldName(const IR::Expression *e) {
+    return isField(e) ? toStr(e) : cstring();
+}
+
+bool sameValue(const IR::Expression *a, const IR::Expression *b) {
+    auto ca = a->to<IR::Constant>();
+    auto cb = b->to<IR::Constant>();
+    if (ca != nullptr || cb != nullptr)
+        return ca != nullptr && cb != nullptr && ca->value == cb->value;
+    return isField(a) && isField(b) && toStr(a) == toStr(b);
+}
+
+bool hasNoEffect(const IR::DpdkBinaryStatement *s, const IR::Expression *src) {
+    auto c = src->to<IR::Constant>();
+    if (c == nullptr || c->value != 0)
+        return false;
+    return s->is<IR::DpdkAddStatement>() || s->is<IR::DpdkSubStatement>() ||
+           s->is<IR::DpdkOrStatement>() || s->is<IR::DpdkXorStatement>() ||
+           s->is<IR::DpdkShlStatement>() || s->is<IR::DpdkShrStatement>();
+}
+
+// Computes the result of "s" on a field of the given width holding dst;
+// returns false for the operations which are not folded.
+bool fold(const IR::DpdkBinaryStatement *s, uint64_t dst, uint64_t src,
+          unsigned width, uint64_t &result) {
+    if (s->is<IR::DpdkAddStatement>())
+        result = dst + src;
+    else if (s->is<IR::DpdkSubStatement>())
+        result = dst - src;
+    else if (s->is<IR::DpdkAndStatement>())
+        result = dst & src;
+    else if (s->is<IR::DpdkOrStatement>())
+        result = dst | src;
+    else if (s->is<IR::DpdkXorStatement>())
+        result = dst ^ src;
+    else if (s->is<IR::DpdkShlStatement>())
+        result = src >= width ? 0 : dst << src;
+    else if (s->is<IR::DpdkShrStatement>())
+        result = src >= width ? 0 : dst >> src;
+    else
+        return false;
+    if (width < 64)
+        result &= (uint64_t(1) << width) - 1;
+    return true;
+}
+
+// Name of the metadata field an operand refers to: m.x is either a member x
+// of m or, for the temporaries, a path named m.x.
+cstring metadataField(cstring name) {
+    return name.startsWith("m.") ? name.substr(2) : cstring();
+}
+
+cstring metadataField(const IR::Expression *e) {
+    if (auto m = e->to<IR::Member>()) {
+        auto path = m->expr->to<IR::PathExpression>();
+        if (path != nullptr && path->path->name == "m")
+            return m->member.originalName;
+    } else if (auto p = e->to<IR::PathExpression>()) {
+        return metadataField(p->path->name.name);
+    }
+    return cstring();
+}
+
+// Size of a metadata field in bits, 0 if unknown.
+unsigned fieldBits(const IR::StructField *f) {
+    if (auto bits = f->type->to<IR::Type_Bits>())
+        return bits->width_bits();
+    // DPDK implements bool and error as bit<8>
+    if (f->type->is<IR::Type_Boolean>() || f->type->is<IR::Type_Error>())
+        return 8;
+    if (auto t = f->type->to<IR::Type_Name>()) {
+        if (t->path->name == "error")
+            return 8;
+    }
+    return 0;
+}
+
+// Alignment in bits of a field of the given size: the largest power of two
+// number of bytes, up to 8, which divides its size.
+unsigned fieldAlignment(unsigned bits) {
+    if (bits == 0 || bits % 8 != 0)
+        return 1;
+    unsigned align = 64;
+    while (bits % align != 0)
+        align /= 2;
+    return align;
+}
+
+// Calls f with the metadata structure and with the type of each header
+// instance, and the prefix naming their fields, e.g. "m." or "h.ipv4.".
+void forEachStruct(const IR::DpdkAsmProgram *p,
+                   std::function<void(cstring, const IR::Type_StructLike *)> f) {
+    std::unordered_map<cstring, const IR::DpdkHeaderType *> headerTypes;
+    for (auto h : p->headerType)
+        headerTypes.emplace(h->name.name, h);
+    for (auto s : p->structType) {
+        if (s->getAnnotations()->getSingle("__metadata__")) {
+            f("m.", s);
+        } else if (s->getAnnotations()->getSingle("__packet_data__")) {
+            for (auto field : s->fields) {
+                if (auto t = field->type->to<IR::Type_Name>()) {
+                    auto h = headerTypes.find(t->path->name.name);
+                    if (h != headerTypes.end())
+                        f(cstring("h.") + field->name.name + ".", h->second);
+                } else if (auto t = field->type->to<IR::Type_Stack>()) {
+                    auto elem = t->elementType->to<IR::Type_Name>();
+                    auto size = t->size->to<IR::Constant>();
+                    if (elem == nullptr || size == nullptr)
+                        continue;
+                    auto h = headerTypes.find(elem->path->name.name);
+                    if (h == headerTypes.end())
+                        continue;
+                    for (int i = 0; i < size->asInt(); i++)
+                        f(cstring("h.") + field->name.name + "_" + Util::toString(i) + ".",
+                          h->second);
                 }
             }
-            if (found) {
-                new_l->push_back(stmt);
-            } else {
-                changed = true;
-            }
-        } else {
-            new_l->push_back(stmt);
         }
     }
-    if (changed)
-        l->statements = *new_l;
-    return l;
 }
 
-const IR::Node *
-RemoveConsecutiveJmpAndLabel::postorder(IR::DpdkListStatement *l) {
-    const IR::DpdkJmpStatement *cache = nullptr;
-    bool changed = false;
-    IR::IndexedVector<IR::DpdkAsmStatement> new_l;
-    for (auto stmt : l->statements) {
-        if (auto jmp = stmt->to<IR::DpdkJmpStatement>()) {
-            if (cache)
-                new_l.push_back(cache);
-            cache = jmp;
-        } else if (auto label = stmt->to<IR::DpdkLabelStatement>()) {
-            if (!cache) {
-                new_l.push_back(stmt);
-            } else if (cache->label != label->label) {
-                new_l.push_back(cache);
-                cache = nullptr;
-                new_l.push_back(stmt);
-            } else {
-                new_l.push_back(stmt);
-                cache = nullptr;
-                changed = true;
+// The value and mask an entry matches for a key field of the given width;
+// returns false for keysets other than constants, masks and don't care.
+bool entryMask(const IR::Expression *keyset, unsigned width, big_int &value, big_int &mask) {
+    big_int all = Util::mask(width);
+    if (keyset->is<IR::DefaultExpression>()) {
+        value = 0;
+        mask = 0;
+    } else if (auto c = keyset->to<IR::Constant>()) {
+        value = c->value & all;
+        mask = all;
+    } else if (auto m = keyset->to<IR::Mask>()) {
+        auto v = m->left->to<IR::Constant>();
+        auto k = m->right->to<IR::Constant>();
+        if (v == nullptr || k == nullptr)
+            return false;
+        mask = k->value & all;
+        value = v->value & mask;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Length of the prefix a mask matches, -1 if it is not a prefix.
+int prefixLength(const big_int &mask, unsigned width) {
+    if (mask == 0)
+        return 0;
+    auto ones = Util::findOnes(mask);
+    if (ones.value != mask || ones.highIndex != width - 1)
+        return -1;
+    return width - ones.lowIndex;
+}
+
+// Renames the fields of the argument of an action and its labels by their
+// position, so that equivalent actions print the same instructions.
+class CanonicalAction : public Transform {
+    cstring arg;
+    const std::unordered_map<cstring, size_t> &argFields;
+    std::unordered_map<cstring, cstring> labels;
+
+    cstring label(cstring l) {
+        auto it = labels.emplace(l, cstring("L" + Util::toString(labels.size())));
+        return it.first->second;
+    }
+
+  public:
+    CanonicalAction(cstring arg, const std::unordered_map<cstring, size_t> &argFields)
+        : arg(arg), argFields(argFields) {}
+    const IR::Node *postorder(IR::Member *m) override {
+        auto path = m->expr->to<IR::PathExpression>();
+        if (path == nullptr || path->path->name.name != arg)
+            return m;
+        auto it = argFields.find(m->member.name);
+        if (it != argFields.end())
+            m->member = IR::ID(cstring("arg" + Util::toString(it->second)));
+        return m;
+    }
+    const IR::Node *postorder(IR::DpdkJmpStatement *j) override {
+        j->label = label(j->label);
+        return j;
+    }
+    const IR::Node *postorder(IR::DpdkLabelStatement *l) override {
+        l->label = label(l->label);
+        return l;
+    }
+};
+
+}  // namespace
+
+Visitor::profile_t CollectFieldInfo::init_apply(const IR::Node *node) {
+    readFields.clear();
+    widths.clear();
+    return Inspector::init_apply(node);
+}
+
+bool CollectFieldInfo::preorder(const IR::DpdkAsmProgram *p) {
+    forEachStruct(p, [this](cstring prefix, const IR::Type_StructLike *type) {
+        for (auto f : type->fields) {
+            if (auto bits = f->type->to<IR::Type_Bits>())
+                widths[prefix + f->externalName()] = bits->width_bits();
+        }
+    });
+    return true;
+}
+
+// The group and member ids of a selector are named, not Member expressions.
+bool CollectFieldInfo::preorder(const IR::DpdkSelector *s) {
+    readFields.insert(s->group_id);
+    readFields.insert(s->member_id);
+    return true;
+}
+
+bool CollectFieldInfo::preorder(const IR::Member *m) {
+    if (!isField(m))
+        return true;
+    readFields.insert(toStr(m));
+    return false;
+}
+
+bool CollectFieldInfo::preorder(const IR::PathExpression *p) {
+    readFields.insert(p->path->name.name);
+    return false;
+}
+
+// The destination of an assignment is not read, nor is the destination of
+// an in-place update read by anything but the update itself.
+bool CollectFieldInfo::preorder(const IR::DpdkUnaryStatement *s) {
+    visit(s->src);
+    return false;
+}
+
+bool CollectFieldInfo::preorder(const IR::DpdkBinaryStatement *s) {
+    if (!s->dst->equiv(*s->src1))
+        visit(s->src1);
+    visit(s->src2);
+    return false;
+}
+
+// The spec is the whole program: every instruction, table key and selector
+// which reads a metadata field is in it, and CollectFieldInfo records the
+// read. The pipeline itself only reads the PSA metadata, which are the
+// fields named m.psa_*; the other metadata fields are not visible outside
+// of the spec, so they are dead when nothing in the spec reads them.
+bool OptimizeInstructions::isDeadTemporary(cstring field) const {
+    return field.startsWith("m.") && !field.startsWith("m.psa_") &&
+           readFields.count(field) == 0;
+}
+
+unsigned OptimizeInstructions::width(const IR::Expression *field) const {
+    auto it = widths.find(toStr(field));
+    if (it != widths.end())
+        return it->second;
+    if (auto bits = field->type->to<IR::Type_Bits>())
+        return bits->width_bits();
+    return 0;
+}
+
+IR::IndexedVector<IR::DpdkAsmStatement>
+OptimizeInstructions::optimize(const IR::IndexedVector<IR::DpdkAsmStatement> &stmts) const {
+    std::vector<const IR::DpdkAsmStatement *> result;
+    std::vector<bool> removed;
+    // Fields known to hold the value of another field or a constant.
+    std::unordered_map<cstring, const IR::Expression *> values;
+    // Headers known to be valid (true) or invalid (false).
+    std::unordered_map<cstring, bool> validity;
+    // Positions in result of the last assignment to each field and of the
+    // in-place updates which followed it, as long as the field is not read.
+    std::unordered_map<cstring, std::vector<size_t>> unreadStores;
+    // Position of the last validate or invalidate of each header, as long
+    // as the validity of the header is not read.
+    std::unordered_map<cstring, size_t> unreadValidity;
+
+    auto forgetStores = [&]() {
+        unreadStores.clear();
+        unreadValidity.clear();
+    };
+    auto forgetAll = [&]() {
+        forgetStores();
+        values.clear();
+        validity.clear();
+    };
+    auto emit = [&](const IR::DpdkAsmStatement *s) {
+        result.push_back(s);
+        removed.push_back(false);
+    };
+    auto propagate = [&](const IR::Expression *e, bool allowConstant) {
+        if (!isField(e))
+            return e;
+        auto it = values.find(toStr(e));
+        if (it == values.end() || (!allowConstant && it->second->is<IR::Constant>()))
+            return e;
+        return it->second;
+    };
+    auto read = [&](const IR::Expression *e) {
+        if (isField(e))
+            unreadStores.erase(toStr(e));
+    };
+    // The unread stores to dst are dead once the next statement assigns it.
+    auto overwrite = [&](cstring dst) {
+        auto it = unreadStores.find(dst);
+        if (it != unreadStores.end()) {
+            for (auto pos : it->second)
+                removed[pos] = true;
+        }
+        unreadStores[dst] = { result.size() };
+    };
+    // Values copied from or into a field do not hold once it is written.
+    auto written = [&](cstring field) {
+        values.erase(field);
+        for (auto it = values.begin(); it != values.end();) {
+            if (fieldName(it->second) == field)
+                it = values.erase(it);
+            else
+                ++it;
+        }
+    };
+    auto canPropagate = [&](const IR::Expression *dst, const IR::Expression *src) {
+        unsigned w = width(dst);
+        if (w == 0 || w > 64)
+            return false;
+        if (auto c = src->to<IR::Constant>())
+            return c->fitsUint() && c->value < (big_int(1) << w);
+        return isField(src) && width(src) == w;
+    };
+
+    for (auto s : stmts) {
+        if (s->is<IR::DpdkLabelStatement>()) {
+            forgetAll();
+            emit(s);
+            continue;
+        }
+
+        if (auto jmp = s->to<IR::DpdkJmpStatement>()) {
+            // The target of the jump may read anything.
+            forgetStores();
+            if (auto cond = jmp->to<IR::DpdkJmpCondStatement>()) {
+                // Only the second operand of a comparison may be a constant.
+                auto src1 = propagate(cond->src1, false);
+                auto src2 = propagate(cond->src2, !src1->is<IR::Constant>());
+                if (src1 != cond->src1 || src2 != cond->src2) {
+                    auto c = cond->clone();
+                    c->src1 = src1;
+                    c->src2 = src2;
+                    s = c;
+                }
+            } else if (auto hdr = jmp->to<IR::DpdkJmpHeaderStatement>()) {
+                // jmpv falls through when the header is invalid, jmpnv when it is valid.
+                validity[toStr(hdr->header)] = hdr->is<IR::DpdkJmpIfInvalidStatement>();
+            } else if (jmp->is<IR::DpdkJmpLabelStatement>()) {
+                forgetAll();
+            }
+            emit(s);
+            continue;
+        }
+
+        const IR::Expression *header = nullptr;
+        bool valid = false;
+        if (auto v = s->to<IR::DpdkValidateStatement>()) {
+            header = v->header;
+            valid = true;
+        } else if (auto v = s->to<IR::DpdkInvalidateStatement>()) {
+            header = v->header;
+        }
+        if (header != nullptr) {
+            cstring name = toStr(header);
+            auto known = validity.find(name);
+            if (known != validity.end() && known->second == valid)
+                continue;
+            auto unread = unreadValidity.find(name);
+            if (unread != unreadValidity.end())
+                removed[unread->second] = true;
+            unreadValidity[name] = result.size();
+            validity[name] = valid;
+            emit(s);
+            continue;
+        }
+
+        auto unary = s->to<IR::DpdkUnaryStatement>();
+        if (unary != nullptr && isField(unary->dst)) {
+            cstring dst = toStr(unary->dst);
+            if (isDeadTemporary(dst))
+                continue;
+            bool mov = unary->is<IR::DpdkMovStatement>();
+            auto src = propagate(unary->src, mov);
+            if (mov) {
+                auto known = values.find(dst);
+                if (fieldName(src) == dst ||
+                    (known != values.end() && sameValue(known->second, src)))
+                    continue;
             }
-        } else {
-            if (cache) {
-                new_l.push_back(cache);
-                cache = nullptr;
+            read(src);
+            overwrite(dst);
+            written(dst);
+            if (mov && canPropagate(unary->dst, src))
+                values[dst] = src;
+            if (src != unary->src) {
+                auto c = unary->clone();
+                c->src = src;
+                s = c;
             }
-            new_l.push_back(stmt);
+            emit(s);
+            continue;
+        }
+
+        auto binary = s->to<IR::DpdkBinaryStatement>();
+        if (binary != nullptr && isField(binary->dst) && binary->dst->equiv(*binary->src1)) {
+            cstring dst = toStr(binary->dst);
+            if (isDeadTemporary(dst))
+                continue;
+            auto src = propagate(binary->src2, true);
+            if (hasNoEffect(binary, src))
+                continue;
+            auto known = values.find(dst);
+            unsigned w = width(binary->dst);
+            uint64_t folded;
+            if (known != values.end() && w != 0 && w <= 64 &&
+                known->second->is<IR::Constant>() && src->is<IR::Constant>() &&
+                fold(binary, known->second->to<IR::Constant>()->asUint64(),
+                     src->to<IR::Constant>()->asUint64(), w, folded) &&
+                folded <= UINT32_MAX) {
+                auto c = new IR::Constant(IR::Type_Bits::get(w), folded);
+                overwrite(dst);
+                written(dst);
+                values[dst] = c;
+                emit(new IR::DpdkMovStatement(binary->dst, c));
+                continue;
+            }
+            read(src);
+            // An in-place update is dead if the field is overwritten before
+            // being read, as is the assignment before it.
+            unreadStores[dst].push_back(result.size());
+            written(dst);
+            if (src != binary->src2) {
+                auto c = binary->clone();
+                c->src2 = src;
+                s = c;
+            }
+            emit(s);
+            continue;
         }
+
+        // Table applies, extracts, externs, ... may read or write anything.
+        forgetAll();
+        emit(s);
     }
-    if (changed)
-        l->statements = new_l;
+
+    IR::IndexedVector<IR::DpdkAsmStatement> optimized;
+    for (size_t i = 0; i < result.size(); i++) {
+        if (!removed[i])
+            optimized.push_back(result[i]);
+    }
+    return optimized;
+}
+
+Visitor::profile_t OptimizeInstructions::init_apply(const IR::Node *root) {
+    newlyUnread.clear();
+    for (auto field : lastReadFields) {
+        if (readFields.count(field) == 0)
+            newlyUnread.insert(field);
+    }
+    lastReadFields = readFields;
+    return Transform::init_apply(root);
+}
+
+// optimize() depends on the rest of the program only through isDeadTemporary,
+// so a list it left unchanged can only shrink if it writes a field which is
+// no longer read.
+bool OptimizeInstructions::visitConverged(const IR::Node *n) const {
+    const IR::IndexedVector<IR::DpdkAsmStatement> *stmts = nullptr;
+    if (auto l = n->to<IR::DpdkListStatement>())
+        stmts = &l->statements;
+    else if (auto a = n->to<IR::DpdkAction>())
+        stmts = &a->statements;
+    if (stmts == nullptr || newlyUnread.empty())
+        return false;
+    for (auto s : *stmts) {
+        const IR::Expression *dst = nullptr;
+        if (auto unary = s->to<IR::DpdkUnaryStatement>())
+            dst = unary->dst;
+        else if (auto binary = s->to<IR::DpdkBinaryStatement>())
+            dst = binary->dst;
+        if (dst != nullptr && isField(dst) && newlyUnread.count(toStr(dst)))
+            return true;
+    }
+    return false;
+}
+
+const IR::Node *OptimizeInstructions::postorder(IR::DpdkListStatement *l) {
+    l->statements = optimize(l->statements);
     return l;
 }
 
-const IR::Node *ThreadJumps::postorder(IR::DpdkListStatement *l) {
-    std::map<const cstring, cstring> label_map;
-    const IR::DpdkLabelStatement *cache = nullptr;
-    for (auto stmt : l->statements) {
-        if (!cache) {
-            if (auto label = stmt->to<IR::DpdkLabelStatement>()) {
-                LOG1("label " << label);
-                cache = label;
+const IR::Node *OptimizeInstructions::postorder(IR::DpdkAction *a) {
+    a->statements = optimize(a->statements);
+    return a;
+}
+
+const IR::Node *OptimizeTableKeys::preorder(IR::DpdkAsmProgram *p) {
+    offsets.clear();
+    changedKeys.clear();
+    forEachStruct(p, [this](cstring prefix, const IR::Type_StructLike *type) {
+        unsigned offset = 0;
+        for (auto f : type->fields) {
+            unsigned bits = fieldBits(f);
+            if (bits == 0)
+                break;
+            offsets[prefix + f->externalName()] = offset;
+            offset += bits;
+        }
+    });
+    return p;
+}
+
+std::vector<cstring> OptimizeTableKeys::lowerMatchKinds(const IR::DpdkTable *t,
+                                                        const IR::EntriesList *entries) const {
+    auto &keys = t->match_keys->keyElements;
+    size_t n = keys.size();
+    std::vector<cstring> kinds;
+    std::vector<unsigned> widths;
+    for (auto k : keys) {
+        cstring kind = k->matchType->path->name.name;
+        if (kind != "exact" && kind != "ternary" && kind != "lpm")
+            return {};
+        unsigned width = k->expression->type->width_bits();
+        if (width == 0)
+            return {};
+        kinds.push_back(kind);
+        widths.push_back(width);
+    }
+
+    // The value and mask of each entry, for each key field.
+    std::vector<std::vector<std::pair<big_int, big_int>>> matches;
+    for (auto e : entries->entries) {
+        // Explicit priorities need a wildcard table.
+        if (e->getAnnotations()->getSingle("priority") || e->keys->components.size() != n)
+            return {};
+        std::vector<std::pair<big_int, big_int>> match(n);
+        for (size_t i = 0; i < n; i++) {
+            if (!entryMask(e->keys->components.at(i), widths[i],
+                           match[i].first, match[i].second))
+                return {};
+        }
+        matches.push_back(match);
+    }
+
+    std::vector<cstring> lowered = kinds;
+    std::vector<size_t> wildcard;
+    for (size_t i = 0; i < n; i++) {
+        if (kinds[i] == "exact")
+            continue;
+        bool full = true;
+        for (auto &m : matches)
+            full = full && m[i].second == Util::mask(widths[i]);
+        if (full)
+            lowered[i] = "exact";
+        else
+            wildcard.push_back(i);
+    }
+    if (wildcard.size() > 1)
+        return {};
+
+    // A field matched by prefixes of the given lengths; -1 for exact tables.
+    size_t lpm = wildcard.empty() ? n : wildcard.front();
+    std::vector<int> lengths;
+    if (lpm < n) {
+        for (auto &m : matches) {
+            int length = prefixLength(m[lpm].second, widths[lpm]);
+            if (length < 0)
+                return {};
+            lengths.push_back(length);
+        }
+        lowered[lpm] = "lpm";
+    }
+    // When two entries match the same packet the first one wins, so it must
+    // also be the one with the longest prefix, and exact tables cannot have
+    // two such entries at all.
+    for (size_t a = 0; a < matches.size(); a++) {
+        for (size_t b = a + 1; b < matches.size(); b++) {
+            bool overlap = true;
+            for (size_t i = 0; i < n && overlap; i++) {
+                auto &x = matches[a][i];
+                auto &y = matches[b][i];
+                overlap = ((x.first ^ y.first) & x.second & y.second) == 0;
             }
-        } else {
-            if (auto jmp = stmt->to<IR::DpdkJmpLabelStatement>()) {
-                LOG1("emplace " << cache->label << " " << jmp->label);
-                label_map.emplace(cache->label, jmp->label);
-            } else {
-                cache = nullptr;
+            if (overlap && (lpm == n || lengths[a] <= lengths[b]))
+                return {};
+        }
+    }
+    return lowered;
+}
+
+const IR::Node *OptimizeTableKeys::postorder(IR::DpdkTable *t) {
+    if (t->match_keys == nullptr || t->match_keys->keyElements.empty())
+        return t;
+    auto &keys = t->match_keys->keyElements;
+    size_t n = keys.size();
+
+    std::vector<cstring> kinds;
+    for (auto k : keys)
+        kinds.push_back(k->matchType->path->name.name);
+    auto entriesProperty = t->properties->getProperty(IR::TableProperties::entriesPropertyName);
+    const IR::EntriesList *entries = nullptr;
+    if (entriesProperty != nullptr && entriesProperty->isConstant)
+        entries = entriesProperty->value->to<IR::EntriesList>();
+    if (entries != nullptr) {
+        auto lowered = lowerMatchKinds(t, entries);
+        if (!lowered.empty())
+            kinds = lowered;
+    }
+
+    // Memory order, or declaration order if some offset is unknown, with
+    // the lpm field last.
+    std::vector<size_t> order(n);
+    std::vector<unsigned> position(n);
+    bool known = true;
+    for (size_t i = 0; i < n; i++) {
+        order[i] = i;
+        auto offset = offsets.find(fieldName(keys.at(i)->expression));
+        if (offset == offsets.end())
+            known = false;
+        else
+            position[i] = offset->second;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        bool lpmA = kinds[a] == "lpm", lpmB = kinds[b] == "lpm";
+        if (lpmA != lpmB)
+            return lpmB;
+        return known && position[a] < position[b];
+    });
+
+    bool changed = false;
+    IR::Vector<IR::KeyElement> elements;
+    for (auto i : order) {
+        auto k = keys.at(i);
+        if (kinds[i] != k->matchType->path->name.name) {
+            auto lowered = k->clone();
+            lowered->matchType = new IR::PathExpression(kinds[i]);
+            k = lowered;
+        }
+        changed = changed || i != elements.size() || k != keys.at(i);
+        elements.push_back(k);
+    }
+    if (!changed)
+        return t;
+    for (auto i : order) {
+        auto k = keys.at(i);
+        auto name = k->getAnnotation(IR::Annotation::nameAnnotation);
+        changedKeys.push_back({t->name, name ? name->getName() : toStr(k->expression),
+                               toStr(k->expression), k->matchType->path->name.name,
+                               kinds[i]});
+    }
+    t->match_keys = new IR::Key(t->match_keys->srcInfo, elements);
+
+    if (entries != nullptr) {
+        // Reorder the keysets like the key; the keysets of the fields now
+        // exact are their value.
+        IR::Vector<IR::Entry> reordered;
+        for (auto e : entries->entries) {
+            IR::Vector<IR::Expression> keysets;
+            for (auto i : order) {
+                auto keyset = e->keys->components.at(i);
+                if (kinds[i] == "exact") {
+                    if (auto m = keyset->to<IR::Mask>())
+                        keyset = m->left;
+                }
+                keysets.push_back(keyset);
             }
+            auto entry = e->clone();
+            entry->keys = new IR::ListExpression(e->keys->srcInfo, keysets);
+            reordered.push_back(entry);
         }
+        auto property = entriesProperty->clone();
+        property->value = new IR::EntriesList(entries->srcInfo, reordered);
+        IR::IndexedVector<IR::Property> properties;
+        for (auto p : t->properties->properties)
+            properties.push_back(p == entriesProperty ? property : p);
+        t->properties = new IR::TableProperties(t->properties->srcInfo, properties);
     }
-    auto new_l = new IR::IndexedVector<IR::DpdkAsmStatement>;
-    for (auto stmt : l->statements) {
-        if (auto jmp = stmt->to<IR::DpdkJmpStatement>()) {
-            auto res = label_map.find(jmp->label);
-            if (res != label_map.end()) {
-                ((IR::DpdkJmpStatement *)stmt)->label = res->second;
-                new_l->push_back(stmt);
-            } else {
-                new_l->push_back(stmt);
+    return t;
+}
+
+Visitor::profile_t CollectMetadataUses::init_apply(const IR::Node *node) {
+    groups.clear();
+    used.clear();
+    keys.clear();
+    keyOf.clear();
+    return Inspector::init_apply(node);
+}
+
+void CollectMetadataUses::use(cstring field) {
+    if (used.count(field))
+        return;
+    auto key = keyOf.find(field);
+    if (key == keyOf.end()) {
+        used.insert(field);
+        groups.push_back({ field });
+        return;
+    }
+    std::vector<cstring> group;
+    for (auto f : keys[key->second]) {
+        if (used.insert(f).second)
+            group.push_back(f);
+    }
+    groups.push_back(group);
+}
+
+bool CollectMetadataUses::preorder(const IR::DpdkAsmProgram *p) {
+    auto addKey = [this](std::vector<cstring> key) {
+        for (auto f : key)
+            keyOf.emplace(f, keys.size());
+        keys.push_back(key);
+    };
+    for (auto s : p->selectors) {
+        std::vector<cstring> key;
+        if (auto f = metadataField(s->group_id))
+            key.push_back(f);
+        if (s->selectors) {
+            for (auto k : s->selectors->keyElements) {
+                if (auto f = metadataField(k->expression))
+                    key.push_back(f);
             }
-        } else {
-            new_l->push_back(stmt);
         }
+        if (auto f = metadataField(s->member_id))
+            key.push_back(f);
+        addKey(key);
     }
-    if (l->statements.size() != new_l->size())
-        l->statements = *new_l;
-    return l;
+    std::unordered_map<cstring, const IR::DpdkTable *> tables;
+    for (auto t : p->tables) {
+        tables.emplace(t->name, t);
+        if (t->match_keys == nullptr)
+            continue;
+        std::vector<cstring> key;
+        for (auto k : t->match_keys->keyElements) {
+            if (auto f = metadataField(k->expression))
+                key.push_back(f);
+        }
+        addKey(key);
+    }
+    std::unordered_map<cstring, const IR::DpdkAction *> actions;
+    for (auto a : p->actions)
+        actions.emplace(a->name.toString(), a);
+
+    // Every packet is received, checked for drop and transmitted.
+    use("psa_ingress_input_metadata_ingress_port");
+    use("psa_ingress_output_metadata_drop");
+    use("psa_ingress_output_metadata_egress_port");
+    std::vector<const IR::DpdkTable *> applied;
+    for (auto s : p->statements) {
+        auto list = s->to<IR::DpdkListStatement>();
+        if (list == nullptr) {
+            visit(s);
+            continue;
+        }
+        for (auto i : list->statements) {
+            visit(i);
+            auto apply = i->to<IR::DpdkApplyStatement>();
+            if (apply == nullptr)
+                continue;
+            auto t = tables.find(apply->table);
+            if (t != tables.end()) {
+                visit(t->second);
+                applied.push_back(t->second);
+            }
+        }
+    }
+    for (auto t : applied) {
+        for (auto ale : t->actions->actionList) {
+            auto mce = ale->expression->to<IR::MethodCallExpression>();
+            if (mce == nullptr || !mce->method->is<IR::PathExpression>())
+                continue;
+            auto a = actions.find(mce->method->to<IR::PathExpression>()->path->name.toString());
+            if (a != actions.end())
+                visit(a->second);
+        }
+    }
+    // Nodes visited already are not visited again.
+    for (auto a : p->actions)
+        visit(a);
+    for (auto t : p->tables)
+        visit(t);
+    for (auto s : p->selectors)
+        visit(s);
+    for (auto e : p->externDeclarations)
+        visit(e);
+    return false;
 }
 
-const IR::Node *RemoveLabelAfterLabel::postorder(IR::DpdkListStatement *l) {
-    bool changed = false;
-    std::map<const cstring, cstring> label_map;
-    const IR::DpdkLabelStatement *cache = nullptr;
-    for (auto stmt : l->statements) {
-        if (!cache) {
-            if (auto label = stmt->to<IR::DpdkLabelStatement>()) {
-                cache = label;
+bool CollectMetadataUses::preorder(const IR::DpdkSelector *s) {
+    if (auto f = metadataField(s->group_id))
+        use(f);
+    if (auto f = metadataField(s->member_id))
+        use(f);
+    return true;
+}
+
+bool CollectMetadataUses::preorder(const IR::Member *m) {
+    auto f = metadataField(m);
+    if (!f)
+        return true;
+    use(f);
+    return false;
+}
+
+bool CollectMetadataUses::preorder(const IR::PathExpression *p) {
+    if (auto f = metadataField(p))
+        use(f);
+    return false;
+}
+
+const IR::Node *LayoutMetadata::postorder(IR::DpdkStructType *s) {
+    if (!s->getAnnotations()->getSingle("__metadata__"))
+        return s;
+    std::unordered_map<cstring, const IR::StructField *> byName;
+    for (auto f : s->fields)
+        byName.emplace(f->externalName(), f);
+
+    std::vector<std::vector<const IR::StructField *>> used;
+    std::unordered_set<cstring> placed;
+    for (auto &group : groups) {
+        std::vector<const IR::StructField *> fields;
+        for (auto name : group) {
+            auto f = byName.find(name);
+            if (f == byName.end() || fieldBits(f->second) == 0 || !placed.insert(name).second)
+                continue;
+            fields.push_back(f->second);
+        }
+        if (!fields.empty())
+            used.push_back(fields);
+    }
+    auto alignment = [](const IR::StructField *f) { return fieldAlignment(fieldBits(f)); };
+    // Fields of unknown size stay at the end, in declaration order.
+    std::vector<const IR::StructField *> unused, unknown;
+    for (auto f : s->fields) {
+        if (placed.count(f->externalName()))
+            continue;
+        if (fieldBits(f) == 0)
+            unknown.push_back(f);
+        else
+            unused.push_back(f);
+    }
+    std::stable_sort(unused.begin(), unused.end(),
+                     [&](const IR::StructField *a, const IR::StructField *b) {
+                         return alignment(a) > alignment(b); });
+
+    IR::IndexedVector<IR::StructField> fields;
+    unsigned offset = 0;
+    unsigned pads = 0;
+    auto place = [&](const IR::StructField *f) {
+        fields.push_back(f);
+        offset += fieldBits(f);
+    };
+    auto alignTo = [&](unsigned align) {
+        while (offset % align != 0) {
+            unsigned gap = align - offset % align;
+            auto f = std::find_if(unused.begin(), unused.end(), [&](const IR::StructField *f) {
+                return fieldBits(f) <= gap && offset % alignment(f) == 0; });
+            if (f != unused.end()) {
+                place(*f);
+                unused.erase(f);
+                continue;
             }
-        } else {
-            if (auto label = stmt->to<IR::DpdkLabelStatement>()) {
-                label_map.emplace(cache->label, label->label);
-            } else {
-                cache = nullptr;
+            cstring pad;
+            do {
+                pad = "pad_" + Util::toString(pads++);
+            } while (byName.count(pad));
+            fields.push_back(new IR::StructField(IR::ID(pad), IR::Type_Bits::get(gap)));
+            offset += gap;
+        }
+    };
+
+    const unsigned cacheLineBits = 512;
+    auto groupBits = [](const std::vector<const IR::StructField *> &group) {
+        unsigned bits = 0;
+        for (auto f : group)
+            bits += fieldBits(f);
+        return bits;
+    };
+    for (size_t i = 0; i < used.size();) {
+        size_t j = i;
+        unsigned bits = 0;
+        while (j < used.size() && (j == i || bits + groupBits(used[j]) <= cacheLineBits))
+            bits += groupBits(used[j++]);
+        std::stable_sort(used.begin() + i, used.begin() + j,
+                         [&](const std::vector<const IR::StructField *> &a,
+                             const std::vector<const IR::StructField *> &b) {
+                             return alignment(a.front()) > alignment(b.front()); });
+        for (; i < j; i++) {
+            for (auto f : used[i]) {
+                alignTo(alignment(f));
+                place(f);
             }
         }
     }
-    auto new_l = new IR::IndexedVector<IR::DpdkAsmStatement>;
-    for (auto stmt : l->statements) {
-        if (auto jmp = stmt->to<IR::DpdkJmpStatement>()) {
-            auto res = label_map.find(jmp->label);
-            if (res != label_map.end()) {
-                ((IR::DpdkJmpStatement *)stmt)->label = res->second;
-                new_l->push_back(stmt);
-                changed = true;
-            } else {
-                new_l->push_back(stmt);
+    while (!unused.empty()) {
+        auto f = unused.front();
+        unused.erase(unused.begin());
+        alignTo(alignment(f));
+        place(f);
+    }
+    for (auto f : unknown)
+        fields.push_back(f);
+
+    s->fields = fields;
+    return s;
+}
+
+Visitor::profile_t CollectEquivalentActions::init_apply(const IR::Node *node) {
+    replacements.clear();
+    unusedArgs.clear();
+    return Inspector::init_apply(node);
+}
+
+bool CollectEquivalentActions::preorder(const IR::DpdkAsmProgram *p) {
+    std::unordered_map<cstring, const IR::DpdkStructType *> structs;
+    for (auto s : p->structType)
+        structs.emplace(s->name.name, s);
+
+    // The signature of an action: the types of its arguments and its
+    // instructions, as printed in the spec once canonical.
+    std::map<std::string, cstring> actionOf;
+    std::unordered_set<cstring> usedArgs;
+    std::unordered_set<cstring> replacedArgs;
+    for (auto a : p->actions) {
+        std::ostringstream signature;
+        cstring arg;
+        cstring argType;
+        std::unordered_map<cstring, size_t> argFields;
+        if (a->para.size() > 1)
+            continue;
+        if (a->para.size() == 1) {
+            auto param = a->para.parameters.at(0);
+            auto type = param->type->to<IR::Type_Name>();
+            if (type == nullptr)
+                continue;
+            auto s = structs.find(type->path->name.name);
+            if (s == structs.end())
+                continue;
+            arg = param->name.name;
+            argType = s->first;
+            for (auto f : s->second->fields) {
+                argFields.emplace(f->name.name, argFields.size());
+                signature << f->type->toString() << " ";
             }
-        } else {
-            new_l->push_back(stmt);
         }
+        signature << "{\n";
+        CanonicalAction canonical(arg, argFields);
+        for (auto stmt : a->statements) {
+            stmt->apply(canonical)->to<IR::DpdkAsmStatement>()->toSpec(signature);
+            signature << "\n";
+        }
+        auto it = actionOf.emplace(signature.str(), a->name.toString());
+        if (it.second) {
+            if (!argType.isNullOrEmpty())
+                usedArgs.insert(argType);
+            continue;
+        }
+        LOG1("Action " << a->name << " merged into " << it.first->second);
+        replacements.emplace(a->name.toString(), it.first->second);
+        if (!argType.isNullOrEmpty())
+            replacedArgs.insert(argType);
+    }
+    for (auto arg : replacedArgs) {
+        if (usedArgs.count(arg) == 0)
+            unusedArgs.insert(arg);
+    }
+    return false;
+}
+
+const IR::Node *MergeEquivalentActions::postorder(IR::DpdkAction *a) {
+    if (replacements.count(a->name.toString()))
+        return nullptr;
+    return a;
+}
+
+const IR::Node *MergeEquivalentActions::postorder(IR::DpdkStructType *s) {
+    if (unusedArgs.count(s->name.name))
+        return nullptr;
+    return s;
+}
+
+// The actions of the tables, the default actions and the actions of the
+// entries are the only calls with a plain name.
+const IR::Node *MergeEquivalentActions::postorder(IR::MethodCallExpression *m) {
+    auto path = m->method->to<IR::PathExpression>();
+    if (path == nullptr)
+        return m;
+    auto it = replacements.find(path->path->name.toString());
+    if (it == replacements.end())
+        return m;
+    m->method = new IR::PathExpression(IR::ID(it->second));
+    return m;
+}
+
+// A table may now list the same action more than once.
+const IR::Node *MergeEquivalentActions::postorder(IR::ActionList *l) {
+    IR::IndexedVector<IR::ActionListElement> actions;
+    std::unordered_set<cstring> seen;
+    for (auto a : l->actionList) {
+        if (seen.insert(a->getName().name).second)
+            actions.push_back(a);
     }
-    if (changed)
-        l->statements = *new_l;
+    l->actionList = actions;
     return l;
 }
 
@@ -39,64 +39,269 @@ limitations under the License.
 #include "ir/ir.h"
 #include "lib/gmputil.h"
 #include "lib/json.h"
+
+#include <unordered_map>
+#include <unordered_set>
+
 namespace DPDK {
-// This pass removes label that no jmps jump to
-class RemoveRedundantLabel : public Transform {
+// This pass simplifies the jumps and labels of each instruction list. Each
+// round builds an index of the labels and of the runs of consecutive labels
+// in one scan of the list, and rewrites the list in a second scan:
+// - a jump to any label of a run jumps to the last label of the run;
+// - a jump to a label whose next instruction is an unconditional jmp
+//   jumps to the target of that jmp instead (jump threading). For example:
+//   jeq label1
+//   ...
+//   label1
+//   jmp label2
+//
+//   will become (label1 is then unused):
+//   jeq label2
+//   ...
+//   jmp label2
+// - a jump to the label right after it is removed;
+// - labels that no jump jumps to are removed.
+// Each round is linear in the length of the list; rounds repeat only while
+// a round exposes new opportunities, e.g. a removed jump making two labels
+// consecutive.
+class OptimizeJumps : public Transform {
+    // Returns true if the round changed stmts.
+    bool simplify(std::vector<const IR::DpdkAsmStatement *> &stmts) const;
+
   public:
     const IR::Node *postorder(IR::DpdkListStatement *l) override;
 };
 
-// This pass removes jmps that jump to a label that is immediately after it.
-// For example,
-// (jmp label1)
-// (label1)
-//
-// jmp label1 will be removed.
+// Collects the fields whose value some instruction, table key, selector or
+// extern reads; a field which is only ever assigned, or only updated in place
+// (e.g. add m.x 0x1), is not read. Also collects the width of the header and
+// metadata fields, as named in the instructions (e.g. h.ipv4.ttl).
+class CollectFieldInfo : public Inspector {
+    std::unordered_set<cstring> &readFields;
+    std::unordered_map<cstring, unsigned> &widths;
 
-class RemoveConsecutiveJmpAndLabel : public Transform {
   public:
-    const IR::Node *postorder(IR::DpdkListStatement *l) override;
+    CollectFieldInfo(std::unordered_set<cstring> &readFields,
+                     std::unordered_map<cstring, unsigned> &widths)
+        : readFields(readFields), widths(widths) {}
+    Visitor::profile_t init_apply(const IR::Node *node) override;
+    bool preorder(const IR::DpdkAsmProgram *p) override;
+    bool preorder(const IR::DpdkSelector *s) override;
+    bool preorder(const IR::Member *m) override;
+    bool preorder(const IR::PathExpression *p) override;
+    bool preorder(const IR::DpdkUnaryStatement *s) override;
+    bool preorder(const IR::DpdkBinaryStatement *s) override;
 };
 
-// This pass removes labels whose next instruction is a jmp statement. This pass
-// will update any kinds of jmp(conditional + unconditional) that jump to this
-// label to the label that jmp statement jump to. For example:
-// jeq label1
-// ...
-// ...
-// label1
-// jmp label2
-//
-// will become:
-// jeq label2
-// ...
-// ...
-// jmp label2
+// This pass optimizes the instructions of each instruction list and each
+// action, one basic block at a time. A block starts at a label; what is known
+// before a conditional jump still holds after it. Within a block:
+// - copies and constants are propagated: after "mov m.t h.f", the reads
+//   of m.t read h.f until either field is written. Only copies between
+//   fields of the same width, of at most 64 bits, are propagated, and only
+//   constants that fit in 32 bits;
+// - add, sub, and, or, xor, shl and shr of a field whose value is a known
+//   constant are folded into a mov, and operations with no effect
+//   (e.g. add m.x 0x0, mov m.x m.x) are removed;
+// - an assignment overwritten before any read is removed, together with
+//   the in-place updates in between;
+// - validate and invalidate are removed when the header is known to be
+//   valid, respectively invalid, or when the validity is set again before
+//   being read.
+// Any other instruction (table apply, extract, externs, ...) may read or
+// write anything, so the block state is reset around it.
+// Across the program, assignments to metadata temporaries which are never
+// read are removed; the psa_* metadata fields are read by the pipeline
+// and are always kept.
+class OptimizeInstructions : public Transform {
+    const std::unordered_set<cstring> &readFields;
+    const std::unordered_map<cstring, unsigned> &widths;
+    // Fields read when this pass last ran, and those of them no longer read.
+    std::unordered_set<cstring> lastReadFields;
+    std::unordered_set<cstring> newlyUnread;
+
+    bool isDeadTemporary(cstring field) const;
+    // Width of a field operand, 0 if unknown.
+    unsigned width(const IR::Expression *field) const;
+    IR::IndexedVector<IR::DpdkAsmStatement>
+    optimize(const IR::IndexedVector<IR::DpdkAsmStatement> &stmts) const;
 
-class ThreadJumps : public Transform {
   public:
+    OptimizeInstructions(const std::unordered_set<cstring> &readFields,
+                         const std::unordered_map<cstring, unsigned> &widths)
+        : readFields(readFields), widths(widths) {}
+    Visitor::profile_t init_apply(const IR::Node *root) override;
+    bool visitConverged(const IR::Node *n) const override;
     const IR::Node *postorder(IR::DpdkListStatement *l) override;
+    const IR::Node *postorder(IR::DpdkAction *a) override;
 };
 
-// This pass removes labels whose next instruction is a label. In addition, it
-// will update any jmp that jump to this label to the label next to it.
+// Removing an instruction may leave more temporaries unread, so the
+// optimization repeats until the program does not change.  The repetition is
+// incremental: an instruction list or action left unchanged by an iteration
+// is only optimized again when it writes a temporary which became unread.
+class DpdkInstructionOptimization : public PassRepeated {
+    std::unordered_set<cstring> readFields;
+    std::unordered_map<cstring, unsigned> widths;
 
-class RemoveLabelAfterLabel : public Transform {
   public:
-    const IR::Node *postorder(IR::DpdkListStatement *l) override;
+    DpdkInstructionOptimization() {
+        passes.push_back(new CollectFieldInfo(readFields, widths));
+        passes.push_back(new OptimizeInstructions(readFields, widths));
+        setIncremental();
+    }
 };
 
-class DpdkAsmOptimization : public PassRepeated {
+// This pass lets the SWX pipeline use the cheapest table type for each table.
+// The pipeline implements a table whose key fields are all exact as an exact
+// match table, a table whose only non-exact field is an lpm field placed
+// last as an LPM table, and any other table as a wildcard table, much slower
+// than the other two.
+// - The match kind of the ternary and lpm fields is lowered when the const
+//   entries of the table allow it without changing which entry matches:
+//   to exact when every entry has a full mask for the field, or, for a
+//   single remaining ternary field, to lpm when every mask is a prefix and
+//   overlapping entries are ordered longest prefix first. Tables which would
+//   still need a wildcard table are left alone.
+// - The key fields are ordered as they are laid out in memory, so the key is
+//   read as one span of its header or of the metadata, with the lpm field
+//   last. The entries are reordered to match.
+// The key order is the order of the fields in the control plane entries.
+// The P4Info is written before the back-end runs and keeps the P4 key, so
+// the pass records the new key of each table it changes.
+class OptimizeTableKeys : public Transform {
+  public:
+    // A key field of a changed table, in the new key order.
+    struct KeyField {
+        cstring table;
+        cstring p4infoName;   // name of the match field in the P4Info
+        cstring field;        // key field in the spec
+        cstring p4infoKind;   // match kind in the P4Info
+        cstring kind;         // match kind in the spec
+    };
+
   private:
+    // Offset in bits of each field within its header or the metadata.
+    std::unordered_map<cstring, unsigned> offsets;
+    std::vector<KeyField> changedKeys;
+
+    std::vector<cstring> lowerMatchKinds(const IR::DpdkTable *t,
+                                         const IR::EntriesList *entries) const;
+
+  public:
+    const IR::Node *preorder(IR::DpdkAsmProgram *p) override;
+    const IR::Node *postorder(IR::DpdkTable *t) override;
+    /// The key fields of the tables whose key changed, table by table.
+    const std::vector<KeyField> &getChangedKeys() const { return changedKeys; }
+};
+
+// Collects the metadata fields in the order the pipeline first uses them:
+// first the instructions of the apply block, which run for every packet,
+// with the key of each table where the table is applied, then the actions
+// of the tables in the order of the tables, then everything else. The
+// fields of a table key, of a selector key, or of a selector's group and
+// member ids form one group, in key order.
+class CollectMetadataUses : public Inspector {
+    std::vector<std::vector<cstring>> &groups;
+    std::unordered_set<cstring> used;
+    std::vector<std::vector<cstring>> keys;
+    // Index in keys of the key of each field which is part of one.
+    std::unordered_map<cstring, size_t> keyOf;
+
+    void use(cstring field);
+
+  public:
+    explicit CollectMetadataUses(std::vector<std::vector<cstring>> &groups)
+        : groups(groups) {}
+    Visitor::profile_t init_apply(const IR::Node *node) override;
+    bool preorder(const IR::DpdkAsmProgram *p) override;
+    bool preorder(const IR::DpdkSelector *s) override;
+    bool preorder(const IR::Member *m) override;
+    bool preorder(const IR::PathExpression *p) override;
+};
+
+// Lays out the metadata structure for locality. The used fields come first,
+// in the order collected above; the groups which fit in a cache line
+// are ordered by decreasing alignment so that each field can start at an
+// offset aligned to its size (a 32-bit field at a multiple of 32 bits).
+// The unused fields follow, also by decreasing alignment; they fill the
+// gaps left before aligned fields, and padding fills the remaining gaps.
+class LayoutMetadata : public Transform {
+    const std::vector<std::vector<cstring>> &groups;
+
+  public:
+    explicit LayoutMetadata(const std::vector<std::vector<cstring>> &groups)
+        : groups(groups) {}
+    const IR::Node *postorder(IR::DpdkStructType *s) override;
+};
+
+class DpdkMetadataLayout : public PassManager {
+    std::vector<std::vector<cstring>> groups;
+
+  public:
+    DpdkMetadataLayout() {
+        passes.push_back(new CollectMetadataUses(groups));
+        passes.push_back(new LayoutMetadata(groups));
+    }
+};
+
+// Finds the actions which are equivalent to an earlier action: same
+// instructions, up to the names of the labels and of the arguments, and
+// arguments of the same types in the same order. The frontend localizes
+// the actions, so each table gets its own copy of the actions it shares
+// with other tables.
+class CollectEquivalentActions : public Inspector {
+    // The action which replaces each equivalent action.
+    std::unordered_map<cstring, cstring> &replacements;
+    // The argument structures of the replaced actions.
+    std::unordered_set<cstring> &unusedArgs;
+
+  public:
+    CollectEquivalentActions(std::unordered_map<cstring, cstring> &replacements,
+                             std::unordered_set<cstring> &unusedArgs)
+        : replacements(replacements), unusedArgs(unusedArgs) {}
+    Visitor::profile_t init_apply(const IR::Node *node) override;
+    bool preorder(const IR::DpdkAsmProgram *p) override;
+};
+
+// Removes the replaced actions and their argument structures, and makes the
+// tables, their default actions and their entries use the replacements.
+class MergeEquivalentActions : public Transform {
+    const std::unordered_map<cstring, cstring> &replacements;
+    const std::unordered_set<cstring> &unusedArgs;
+
+  public:
+    MergeEquivalentActions(const std::unordered_map<cstring, cstring> &replacements,
+                           const std::unordered_set<cstring> &unusedArgs)
+        : replacements(replacements), unusedArgs(unusedArgs) {}
+    const IR::Node *postorder(IR::DpdkAction *a) override;
+    const IR::Node *postorder(IR::DpdkStructType *s) override;
+    const IR::Node *postorder(IR::MethodCallExpression *m) override;
+    const IR::Node *postorder(IR::ActionList *l) override;
+};
+
+// The control plane refers to the merged actions by the name of the action
+// which replaces them, given by getReplacements() once the pass has run.
+class DpdkActionMerging : public PassManager {
+    std::unordered_map<cstring, cstring> replacements;
+    std::unordered_set<cstring> unusedArgs;
+
+  public:
+    DpdkActionMerging() {
+        passes.push_back(new CollectEquivalentActions(replacements, unusedArgs));
+        passes.push_back(new MergeEquivalentActions(replacements, unusedArgs));
+    }
+    /// Maps the name of each removed action to the name of the action which
+    /// replaces it.
+    const std::unordered_map<cstring, cstring> &getReplacements() const {
+        return replacements;
+    }
+};
+
+class DpdkAsmOptimization : public PassManager {
   public:
     DpdkAsmOptimization() {
-        passes.push_back(new RemoveRedundantLabel);
-        auto r = new PassRepeated{new RemoveLabelAfterLabel};
-        passes.push_back(r);
-        passes.push_back(new RemoveConsecutiveJmpAndLabel);
-        passes.push_back(new RemoveRedundantLabel);
-        passes.push_back(r);
-        passes.push_back(new ThreadJumps);
+        passes.push_back(new OptimizeJumps);
     }
 };
 
@@ -0,0 +1,272 @@
+/*
+Copyright 2020 Intel Corp.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "dpdkCostReport.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <tuple>
+
+namespace DPDK {
+
+namespace {
+
+// The metadata fields which the spec of the apply block reads or writes
+// implicitly, see DpdkListStatement::toSpec.
+const char *const rxField = "m.psa_ingress_input_metadata_ingress_port";
+const char *const dropField = "m.psa_ingress_output_metadata_drop";
+const char *const txField = "m.psa_ingress_output_metadata_egress_port";
+
+// Sums the bytes of the metadata operands of an instruction. Metadata
+// operands are either members of m or temporaries named m.<name>.
+class MetadataAccesses : public Inspector {
+    const std::unordered_map<cstring, unsigned> &widths;
+
+  public:
+    unsigned bytes = 0;
+
+    explicit MetadataAccesses(const std::unordered_map<cstring, unsigned> &widths)
+        : widths(widths) {}
+    void access(cstring field) {
+        auto it = widths.find(field);
+        if (it != widths.end())
+            bytes += (it->second + 7) / 8;
+    }
+    bool preorder(const IR::Member *m) override {
+        auto path = m->expr->to<IR::PathExpression>();
+        if (path != nullptr && path->path->name.name == "m") {
+            access(cstring("m.") + m->member.originalName);
+            return false;
+        }
+        return true;
+    }
+    bool preorder(const IR::PathExpression *p) override {
+        access(p->path->name.name);
+        return false;
+    }
+};
+
+unsigned fieldBits(const IR::Type *type) {
+    if (auto bits = type->to<IR::Type_Bits>())
+        return bits->width_bits();
+    // DPDK implements bool and error as bit<8>
+    if (type->is<IR::Type_Boolean>() || type->is<IR::Type_Error>())
+        return 8;
+    if (auto name = type->to<IR::Type_Name>())
+        return name->path->name == "error" ? 8 : 0;
+    return 0;
+}
+
+}  // namespace
+
+bool PipelineCost::operator<(const PipelineCost &other) const {
+    return std::tie(instructions, tableLookups, metadataBytes) <
+           std::tie(other.instructions, other.tableLookups, other.metadataBytes);
+}
+
+Util::JsonObject *PipelineCost::toJson() const {
+    auto result = new Util::JsonObject();
+    result->emplace("instructions", instructions);
+    result->emplace("table_lookups", tableLookups);
+    result->emplace("metadata_bytes", metadataBytes);
+    return result;
+}
+
+PipelineCost PipelineCostReport::instructionCost(const IR::DpdkAsmStatement *s) const {
+    PipelineCost cost;
+    if (s->is<IR::DpdkLabelStatement>())
+        return cost;
+    MetadataAccesses accesses(metadataWidths);
+    s->apply(accesses);
+    cost.instructions = 1;
+    cost.metadataBytes = accesses.bytes;
+    return cost;
+}
+
+// The lookup reads the key, then runs one of the actions of the table.
+PipelineCost PipelineCostReport::lookupCost(const IR::DpdkApplyStatement *s) const {
+    PipelineCost cost = instructionCost(s);
+    cost.tableLookups = 1;
+    auto t = tables.find(s->table);
+    if (t == tables.end())
+        return cost;
+    if (t->second->match_keys) {
+        MetadataAccesses accesses(metadataWidths);
+        for (auto key : t->second->match_keys->keyElements)
+            key->expression->apply(accesses);
+        cost.metadataBytes += accesses.bytes;
+    }
+    PipelineCost worst;
+    for (auto a : t->second->actions->actionList) {
+        auto path = a->expression->to<IR::PathExpression>();
+        if (auto mce = a->expression->to<IR::MethodCallExpression>())
+            path = mce->method->to<IR::PathExpression>();
+        if (path == nullptr)
+            continue;
+        auto action = actions.find(path->path->name.toString());
+        if (action != actions.end() && worst < action->second)
+            worst = action->second;
+    }
+    cost += worst;
+    return cost;
+}
+
+// The apply block only jumps forward, so the cost of the worst path from
+// each instruction to the end is computed in one backward scan.
+PipelineCost
+PipelineCostReport::worstCasePath(const IR::IndexedVector<IR::DpdkAsmStatement> &stmts) const {
+    size_t n = stmts.size();
+    std::unordered_map<cstring, size_t> labels;
+    for (size_t i = 0; i < n; i++) {
+        if (auto label = stmts.at(i)->to<IR::DpdkLabelStatement>())
+            labels.emplace(label->label, i);
+    }
+    // fromHere[i] is the cost of the worst path from instruction i; the
+    // path ends with tx at n, or with drop at the LABEL_DROP label.
+    std::vector<PipelineCost> fromHere(n + 1);
+    PipelineCost drop;
+    drop.instructions = 1;
+    fromHere[n].instructions = 1;
+    MetadataAccesses tx(metadataWidths);
+    tx.access(txField);
+    fromHere[n].metadataBytes = tx.bytes;
+
+    auto target = [&](cstring label, size_t from) {
+        if (label == "LABEL_DROP")
+            return drop;
+        auto it = labels.find(label);
+        if (it == labels.end() || it->second <= from)
+            return PipelineCost();
+        return fromHere[it->second];
+    };
+    for (size_t i = n; i-- > 0;) {
+        auto s = stmts.at(i);
+        PipelineCost cost;
+        PipelineCost next = fromHere[i + 1];
+        if (auto apply = s->to<IR::DpdkApplyStatement>()) {
+            cost = lookupCost(apply);
+        } else if (auto jmp = s->to<IR::DpdkJmpStatement>()) {
+            cost = instructionCost(s);
+            auto taken = target(jmp->label, i);
+            if (jmp->is<IR::DpdkJmpLabelStatement>() || next < taken)
+                next = taken;
+        } else {
+            cost = instructionCost(s);
+        }
+        cost += next;
+        fromHere[i] = cost;
+    }
+    return fromHere[0];
+}
+
+bool PipelineCostReport::preorder(const IR::DpdkAsmProgram *p) {
+    metadataWidths.clear();
+    tables.clear();
+    actions.clear();
+    apply = PipelineCost();
+    worstCase = PipelineCost();
+
+    for (auto s : p->structType) {
+        if (!s->getAnnotations()->getSingle("__metadata__"))
+            continue;
+        for (auto f : s->fields) {
+            if (auto bits = fieldBits(f->type))
+                metadataWidths.emplace(cstring("m.") + f->externalName(), bits);
+        }
+    }
+    for (auto t : p->tables)
+        tables.emplace(t->name, t);
+
+    for (auto a : p->actions) {
+        // the return added by the spec
+        PipelineCost cost;
+        cost.instructions = 1;
+        for (auto s : a->statements)
+            cost += instructionCost(s);
+        actions.emplace(a->name.toString(), cost);
+    }
+
+    // rx, the drop flag reset and tx, added by the spec
+    MetadataAccesses implicit(metadataWidths);
+    for (auto field : { rxField, dropField, txField })
+        implicit.access(field);
+    PipelineCost start;
+    start.instructions = 2;
+    MetadataAccesses startFields(metadataWidths);
+    for (auto field : { rxField, dropField })
+        startFields.access(field);
+    start.metadataBytes = startFields.bytes;
+
+    for (auto s : p->statements) {
+        auto l = s->to<IR::DpdkListStatement>();
+        if (l == nullptr)
+            continue;
+        apply.instructions += 3;
+        apply.metadataBytes += implicit.bytes;
+        for (auto i : l->statements) {
+            if (i->is<IR::DpdkApplyStatement>()) {
+                auto lookup = instructionCost(i);
+                lookup.tableLookups = 1;
+                apply += lookup;
+            } else {
+                apply += instructionCost(i);
+            }
+        }
+        PipelineCost path = start;
+        path += worstCasePath(l->statements);
+        if (worstCase < path)
+            worstCase = path;
+    }
+    return false;
+}
+
+Util::JsonObject *PipelineCostReport::toJson() const {
+    auto result = new Util::JsonObject();
+    auto actionsJson = new Util::JsonArray();
+    for (auto &a : actions) {
+        auto action = new Util::JsonObject();
+        action->emplace("name", a.first);
+        for (auto &c : *a.second.toJson())
+            action->emplace(c.first, c.second);
+        actionsJson->append(action);
+    }
+    result->emplace("actions", actionsJson);
+    result->emplace("apply", apply.toJson());
+    result->emplace("worst_case_path", worstCase.toJson());
+    return result;
+}
+
+void PipelineCostReport::toText(std::ostream &out) const {
+    size_t width = std::string("worst-case path").size();
+    for (auto &a : actions)
+        width = std::max(width, std::string("action ").size() + a.first.size());
+    auto line = [&](cstring name, const PipelineCost &cost) {
+        out << std::left << std::setw(width) << name << std::right
+            << std::setw(14) << cost.instructions
+            << std::setw(15) << cost.tableLookups
+            << std::setw(16) << cost.metadataBytes << std::endl;
+    };
+    out << std::left << std::setw(width) << "" << std::right
+        << std::setw(14) << "instructions"
+        << std::setw(15) << "table lookups"
+        << std::setw(16) << "metadata bytes" << std::endl;
+    for (auto &a : actions)
+        line("action " + a.first, a.second);
+    line("apply block", apply);
+    line("worst-case path", worstCase);
+}
+
+} // namespace DPDK
@@ -0,0 +1,75 @@
+/*
+Copyright 2020 Intel Corp.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef BACKEND_DPDK_COST_REPORT_H_
+#define BACKEND_DPDK_COST_REPORT_H_
+
+#include "ir/ir.h"
+#include "lib/json.h"
+#include "lib/ordered_map.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace DPDK {
+
+// Cost of running a sequence of instructions once.
+struct PipelineCost {
+    unsigned instructions = 0;
+    unsigned tableLookups = 0;
+    // Bytes of the metadata fields read or written, counted for each
+    // instruction or table key which accesses them.
+    unsigned metadataBytes = 0;
+
+    PipelineCost &operator+=(const PipelineCost &other) {
+        instructions += other.instructions;
+        tableLookups += other.tableLookups;
+        metadataBytes += other.metadataBytes;
+        return *this;
+    }
+    // Orders the costs by instructions, then by lookups, then by bytes.
+    bool operator<(const PipelineCost &other) const;
+    Util::JsonObject *toJson() const;
+};
+
+// Computes the per packet cost of the generated program, for each action,
+// for the apply block, which holds the parser, the controls and the
+// deparser, and for the worst-case path through the apply block. The
+// worst-case path is the path with the most instructions from rx to tx,
+// where each table lookup runs its most expensive action. The instructions
+// which the spec adds implicitly (rx, tx, the return of each action) are
+// counted. Backward jumps are not followed: the apply block has none.
+class PipelineCostReport : public Inspector {
+    std::unordered_map<cstring, unsigned> metadataWidths;
+    std::unordered_map<cstring, const IR::DpdkTable *> tables;
+
+    PipelineCost instructionCost(const IR::DpdkAsmStatement *s) const;
+    PipelineCost lookupCost(const IR::DpdkApplyStatement *s) const;
+    PipelineCost worstCasePath(const IR::IndexedVector<IR::DpdkAsmStatement> &stmts) const;
+
+  public:
+    ordered_map<cstring, PipelineCost> actions;
+    PipelineCost apply;
+    PipelineCost worstCase;
+
+    bool preorder(const IR::DpdkAsmProgram *p) override;
+
+    Util::JsonObject *toJson() const;
+    void toText(std::ostream &out) const;
+};
+
+} // namespace DPDK
+#endif
@@ -16,6 +16,7 @@ limitations under the License.
 #include <iostream>
 #include "dpdkHelpers.h"
 #include "ir/ir.h"
+#include "lib/stringify.h"
 
 namespace DPDK {
 
@@ -135,204 +136,119 @@ bool ConvertStatementToDpdk::preorder(const IR::AssignmentStatement *a) {
     return false;
 }
 
-/* This recursion requires the pass of ConvertLogicalExpression. This pass will
- * transform the logical experssion to a form that this function use as
- * presumption. The presumption of this function is that the left side of
- * the logical expression can be a simple expression(expression that is not
- *  LAnd or LOr) or a nested expression(LAnd or LOr). The right side can be a
- * nested expression or {simple one if left side is simple as well}.
- */
-bool BranchingInstructionGeneration::generate(const IR::Expression *expr,
+cstring BranchingInstructionGeneration::newLabel(cstring base) {
+    return base + "_" + Util::toString(next_label_id++);
+}
+
+namespace {
+
+// Conditional jump to label when rel holds, or when it does not if negate.
+const IR::DpdkJmpCondStatement *comparisonJump(const IR::Operation_Relation *rel,
+                                               cstring label, bool negate) {
+    auto left = rel->left;
+    auto right = rel->right;
+    // Each relation is the negation of another: == and !=, < and >=, > and <=.
+    if (rel->is<IR::Equ>() || rel->is<IR::Neq>()) {
+        if (rel->is<IR::Equ>() != negate)
+            return new IR::DpdkJmpEqualStatement(label, left, right);
+        return new IR::DpdkJmpNotEqualStatement(label, left, right);
+    }
+    if (rel->is<IR::Lss>() || rel->is<IR::Geq>()) {
+        if (rel->is<IR::Lss>() != negate)
+            return new IR::DpdkJmpLessStatement(label, left, right);
+        return new IR::DpdkJmpGreaterEqualStatement(label, left, right);
+    }
+    if (rel->is<IR::Grt>() || rel->is<IR::Leq>()) {
+        if (rel->is<IR::Grt>() != negate)
+            return new IR::DpdkJmpGreaterStatement(label, left, right);
+        return new IR::DpdkJmpLessOrEqualStatement(label, left, right);
+    }
+    BUG("%1%: not implemented", rel);
+}
+
+}  // namespace
+
+void BranchingInstructionGeneration::generate(const IR::Expression *expr,
         cstring true_label,
         cstring false_label,
-        bool is_and) {
+        bool true_is_next) {
+    // The single jump of a simple condition goes to the outcome which does
+    // not fall through.
+    cstring target = true_is_next ? false_label : true_label;
     if (auto land = expr->to<IR::LAnd>()) {
-        /* First, the left side and right side are both nested expressions. In
-         * this case, we need to introduce another label that represent the half
-         * truth for LAnd(means the left side of LAnd is true).And what will
-         * fall through depends on the return value of recursion for right side.
-         */
-        if (nested(land->left) && nested(land->right)) {
-            generate(land->left, true_label + "half", false_label, true);
-            instructions.push_back(
-                    new IR::DpdkLabelStatement(true_label + "half"));
-            return generate(land->right, true_label, false_label, true);
-        } else if (!nested(land->left) && nested(land->right)) {
-        /* Second, left is simple and right is nested. Call recursion for the
-         * left part, true fall through. Note that right now, the truthfulness
-         * of right represents the truthfulness of the whole, because if the
-         * left part is false, it will not ranch to the right part due to
-         * principle of short-circuit. For right side, recursion is called and
-         * what will fall through depends on the return value of this recursion
-         * function. Since the basic case and `left simple right simple` case
-         * have already properly jmp to correct label, there is no need to jmp
-         * to any label.
-         */
-            generate(land->left, true_label, false_label, true);
-            return generate(land->right, true_label, false_label, true);
-        } else if (!nested(land->left) && !nested(land->right)) {
-        /* Third, left is simple and right is simple. In this case, call the
-         * recursion and indicating  that this call is from LAnd, the
-         * subfunction will let true fall  through. Therefore, after two
-         * function calls, the control flow  should jump to true label. In
-         * addition, indicate that true condition  fallen through. The reason
-         * why I still need to indicate true fallen  through is because there
-         * is chance to eliminate the jmp instruction  I just added.
-         */
-            generate(land->left, true_label, false_label, true);
-            generate(land->right, true_label, false_label, true);
-            instructions.push_back(new IR::DpdkJmpLabelStatement(true_label));
-            return true;
-        } else {
-            BUG("Previous simple expression lifting pass failed");
-        }
+        // The right side is reached when the left side is true.
+        auto right = newLabel(false_label);
+        generate(land->left, right, false_label, true);
+        instructions.push_back(new IR::DpdkLabelStatement(right));
+        generate(land->right, true_label, false_label, true_is_next);
     } else if (auto lor = expr->to<IR::LOr>()) {
-        if (nested(lor->left) && nested(lor->right)) {
-            generate(lor->left, true_label, false_label + "half", false);
-            instructions.push_back(
-                    new IR::DpdkLabelStatement(false_label + "half"));
-            return generate(lor->right, true_label, false_label, false);
-        } else if (!nested(lor->left) && nested(lor->right)) {
-            generate(lor->left, true_label, false_label, false);
-            return generate(lor->right, true_label, false_label, false);
-        } else if (!nested(lor->left) && !nested(lor->right)) {
-            generate(lor->left, true_label, false_label, false);
-            generate(lor->right, true_label, false_label, false);
-            instructions.push_back(new IR::DpdkJmpLabelStatement(false_label));
-            return false;
-        } else {
-            BUG("Previous simple expression lifting pass failed");
-        }
-    } else if (auto equ = expr->to<IR::Equ>()) {
-    /* First, I will describe the base case. The base case is handling logical
-     * expression that is not LAnd and LOr. It will conside whether the simple
-     * expression itself is the left or right of a LAnd or a LOr(The
-     * information is provided by is_and). If it is from LAnd, it will use the
-     * opposite branching statement and let true fall through. For example, a
-     * == b becomes jneq a b false. This is because for a LAnd if one of its
-     * statement is true it is not necessary to be true, but if one is false,
-     * it is definitely false. If it is from a LOr, it will let false fall
-     * through. And finally for a base case, it returns what condition it fall
-     * through.
-     */
-        if (is_and) {
-            instructions.push_back(new IR::DpdkJmpNotEqualStatement(
-                        false_label, equ->left, equ->right));
-        } else {
-            instructions.push_back(new IR::DpdkJmpEqualStatement(
-                        true_label, equ->left, equ->right)); }
-        return is_and;
-    } else if (auto neq = expr->to<IR::Neq>()) {
-        if (is_and) {
-            instructions.push_back(new IR::DpdkJmpEqualStatement(
-                        false_label, neq->left, neq->right));
-        } else {
-            instructions.push_back(new IR::DpdkJmpNotEqualStatement(
-                        true_label, neq->left, neq->right)); }
-        return is_and;
-    } else if (auto lss = expr->to<IR::Lss>()) {
-        if (is_and) {
-            instructions.push_back(new IR::DpdkJmpGreaterEqualStatement(
-                        false_label, lss->left, lss->right));
-        } else {
-            instructions.push_back(new IR::DpdkJmpLessStatement(
-                        true_label, lss->left, lss->right)); }
-        return is_and;
-    } else if (auto grt = expr->to<IR::Grt>()) {
-        if (is_and) {
-            instructions.push_back(new IR::DpdkJmpLessOrEqualStatement(
-                        false_label, grt->left, grt->right));
-        } else {
-            instructions.push_back(new IR::DpdkJmpGreaterStatement(
-                        true_label, grt->left, grt->right)); }
-        return is_and;
-    } else if (auto leq = expr->to<IR::Leq>()) {
-        if (is_and) {
-            instructions.push_back(new IR::DpdkJmpGreaterStatement(
-                        false_label, leq->left, leq->right));
-        } else {
-            instructions.push_back(new IR::DpdkJmpLessOrEqualStatement(
-                        true_label, leq->left, leq->right));
-        }
-        return is_and;
+        // The right side is reached when the left side is false.
+        auto right = newLabel(false_label);
+        generate(lor->left, true_label, right, false);
+        instructions.push_back(new IR::DpdkLabelStatement(right));
+        generate(lor->right, true_label, false_label, true_is_next);
+    } else if (auto lnot = expr->to<IR::LNot>()) {
+        generate(lnot->expr, false_label, true_label, !true_is_next);
+    } else if (auto b = expr->to<IR::BoolLiteral>()) {
+        if (b->value != true_is_next)
+            instructions.push_back(new IR::DpdkJmpLabelStatement(target));
+    } else if (auto rel = expr->to<IR::Operation_Relation>()) {
+        instructions.push_back(comparisonJump(rel, target, true_is_next));
     } else if (auto mce = expr->to<IR::MethodCallExpression>()) {
         auto mi = P4::MethodInstance::resolve(mce, refMap, typeMap);
-        if (auto a = mi->to<P4::BuiltInMethod>()) {
-            if (a->name == "isValid") {
-                if (is_and) {
-                    instructions.push_back(new IR::DpdkJmpIfInvalidStatement(
-                                false_label, a->appliedTo));
-                } else {
-                    instructions.push_back(new IR::DpdkJmpIfValidStatement(
-                                true_label, a->appliedTo)); }
-                return is_and;
-            } else {
-                BUG("%1%: Not implemented", expr);
-            }
-        } else {
-            BUG("%1%:not implemented method instance", expr);
-        }
-    } else if (expr->is<IR::PathExpression>()) {
-        if (is_and) {
-            instructions.push_back(new IR::DpdkJmpNotEqualStatement(
-                        false_label, expr, new IR::Constant(1)));
-        } else {
-            instructions.push_back(new IR::DpdkJmpEqualStatement(
-                        true_label, expr, new IR::Constant(1))); }
+        auto a = mi->to<P4::BuiltInMethod>();
+        if (a == nullptr || a->name != "isValid")
+            BUG("%1%: not implemented", expr);
+        if (true_is_next)
+            instructions.push_back(new IR::DpdkJmpIfInvalidStatement(target, a->appliedTo));
+        else
+            instructions.push_back(new IR::DpdkJmpIfValidStatement(target, a->appliedTo));
     } else if (auto mem = expr->to<IR::Member>()) {
         if (auto mce = mem->expr->to<IR::MethodCallExpression>()) {
             auto mi = P4::MethodInstance::resolve(mce, refMap, typeMap);
-            if (auto a = mi->to<P4::ApplyMethod>()) {
-                if (a->isTableApply()) {
-                    if (mem->member == IR::Type_Table::hit) {
-                        auto tbl = a->object->to<IR::P4Table>();
-                        instructions.push_back(
-                                new IR::DpdkApplyStatement(tbl->name.toString()));
-                        if (is_and) {
-                            instructions.push_back(
-                                    new IR::DpdkJmpMissStatement(false_label));
-                        } else {
-                            instructions.push_back(
-                                    new IR::DpdkJmpHitStatement(true_label));
-                        }
-                    }
-                } else {
-                    BUG("%1%: not implemented.", expr);
-                }
-            } else {
-                BUG("%1%: not implemented.", expr);
-            }
+            auto a = mi->to<P4::ApplyMethod>();
+            if (a == nullptr || !a->isTableApply() ||
+                (mem->member != IR::Type_Table::hit && mem->member != IR::Type_Table::miss))
+                BUG("%1%: not implemented", expr);
+            auto tbl = a->object->to<IR::P4Table>();
+            instructions.push_back(new IR::DpdkApplyStatement(tbl->name.toString()));
+            bool hit = mem->member == IR::Type_Table::hit;
+            if (hit != true_is_next)
+                instructions.push_back(new IR::DpdkJmpHitStatement(target));
+            else
+                instructions.push_back(new IR::DpdkJmpMissStatement(target));
+        } else if (true_is_next) {
+            instructions.push_back(new IR::DpdkJmpNotEqualStatement(
+                        target, expr, new IR::Constant(1)));
         } else {
-            if (is_and) {
-                instructions.push_back(new IR::DpdkJmpNotEqualStatement(
-                            false_label, expr, new IR::Constant(1)));
-            } else {
-                instructions.push_back(new IR::DpdkJmpEqualStatement(
-                            true_label, expr, new IR::Constant(1))); }
+            instructions.push_back(new IR::DpdkJmpEqualStatement(
+                        target, expr, new IR::Constant(1)));
         }
-        return is_and;
-    } else if (auto lnot = expr->to<IR::LNot>()) {
-        generate(lnot->expr, false_label, true_label, false);
-        return is_and;
+    } else if (expr->is<IR::PathExpression>()) {
+        if (true_is_next)
+            instructions.push_back(new IR::DpdkJmpNotEqualStatement(
+                        target, expr, new IR::Constant(1)));
+        else
+            instructions.push_back(new IR::DpdkJmpEqualStatement(
+                        target, expr, new IR::Constant(1)));
     } else {
         BUG("%1%: not implemented", expr);
     }
-    return is_and;
 }
 
-// This function convert IfStatement to dpdk asm. Based on the return value of
-// BranchingInstructionGeneration's recursion function, this function decides
-// whether the true or false code block will go first. This is important because
-// following optimization pass might eliminate some redundant jmps and labels.
+// This function convert IfStatement to dpdk asm. Either order of the two
+// blocks takes one jump per operand of the condition; the true block comes
+// first, except for a disjunction, whose jumps all go to the true block.
 bool ConvertStatementToDpdk::preorder(const IR::IfStatement *s) {
     auto true_label = Util::printf_format("label_%dtrue", next_label_id);
     auto false_label = Util::printf_format("label_%dfalse", next_label_id);
     auto end_label = Util::printf_format("label_%dend", next_label_id++);
     auto gen = new BranchingInstructionGeneration(refmap, typemap);
-    bool res = gen->generate(s->condition, true_label, false_label, true);
+    bool true_is_next = !s->condition->is<IR::LOr>();
+    gen->generate(s->condition, true_label, false_label, true_is_next);
 
     instructions.append(gen->instructions);
-    if (res == true) {
+    if (true_is_next) {
         add_instr(new IR::DpdkLabelStatement(true_label));
         visit(s->ifTrue);
         add_instr(new IR::DpdkJmpLabelStatement(end_label));
@@ -44,22 +44,24 @@ limitations under the License.
 #define TOSTR_DECLA(NAME) std::ostream &toStr(std::ostream &, IR::NAME *)
 
 namespace DPDK {
-/* This class will generate a optimized jmp and label control flow.
- * Couple of examples here
+/* This class lowers a condition straight into a short-circuit sequence of
+ * conditional jumps, without computing the value of the condition or of any
+ * of its subexpressions. Each subexpression is lowered knowing which of its
+ * two outcomes falls through to the next instruction, so that it takes a
+ * single jump for the other one: && and || chain their operands, ! swaps
+ * the outcomes, and each comparison, isValid() and hit or miss of a table
+ * maps to one jump instruction. For example:
  *
- * Example 1:
- * If(a && b){
+ * if (a.isValid() && (b.isValid() || x == y)) {
  *
- * }
- * Else{
+ * } else {
  *
  * }
  *
- * Will be translated to(in an optimal form):
- * cmp a 1
- * jneq false
- * cmp b 1
- * jneq false
+ * becomes:
+ *     jmpnv false a
+ *     jmpv true b
+ *     jmpneq false x y
  * true:
  *     // if true statements go here
  *     jmp end
@@ -67,66 +69,25 @@ namespace DPDK {
  *     // if false statements go here
  * end:
  *
- * In this case, in order to use fewer jmp, I use jneq instead of jeq to let the
- * true condition fall through the jmp statement and short-circuit the false
- * condition.
- *
- * Example 2:
- * (a && b) || c
- * cmp a 1
- * jneq half_false
- * cmp b 1
- * jneq half_false
- * jmp true
- * half_false:
- *     cmp c 1
- *     jeq true
- * false:
- *
- *     jmp end
- * true:
- *
- * end:
- *
- * In this case, it is not in an optimal form. To make it optimal, I need to
- * change (a && b) || c to c ||(a && b) and assembly code looks like this:
- * cmp c 1
- * jeq true
- * cmp a 1
- * jneq false
- * cmp b 1
- * jneq false
- * false:
- *
- *     jmp end
- * true:
- *
- * end:
- *
- * It is very important to generate as fewer jmp and label instructions as
- * possible, because the performance of DPDK is directly related to the number
- * of instructions.
- *
- * This class uses a recursive function to generate the control flow and is
- * optmized.
+ * The labels between the operands of && and || which no jump uses are
+ * removed with the other unused labels.
  */
 class BranchingInstructionGeneration {
     P4::ReferenceMap *refMap;
     P4::TypeMap *typeMap;
-    bool nested(const IR::Node *n) {
-        if (n->is<IR::LAnd>() || n->is<IR::LOr>()) {
-            return true;
-        } else {
-            return false;
-        }
-    }
+    unsigned next_label_id = 0;
+
+    cstring newLabel(cstring base);
 
   public:
     IR::IndexedVector<IR::DpdkAsmStatement> instructions;
     BranchingInstructionGeneration(P4::ReferenceMap *refMap,
                                    P4::TypeMap *typeMap)
         : refMap(refMap), typeMap(typeMap) {}
-    bool generate(const IR::Expression *, cstring, cstring, bool);
+    // Jumps to true_label or false_label according to the value of expr,
+    // except for the outcome which true_is_next says falls through.
+    void generate(const IR::Expression *expr, cstring true_label,
+                  cstring false_label, bool true_is_next);
 };
 
 class ConvertStatementToDpdk : public Inspector {
@@ -137,6 +137,14 @@ int main(int argc, char *const argv[]) {
             out->flush();
         }
     }
+    if (!options.constEntriesDir.isNullOrEmpty())
+        backend->emitConstEntries(options.constEntriesDir);
+    if (!options.mergeActions.isNullOrEmpty())
+        backend->emitMergedActions(options.mergeActions);
+    if (!options.optimizeTableKeys.isNullOrEmpty())
+        backend->emitTableKeys(options.optimizeTableKeys);
+    if (!options.pipelineCostReport.isNullOrEmpty())
+        backend->emitCostReport(options.pipelineCostReport);
 
     return ::errorCount() > 0;
 }
@@ -24,6 +24,23 @@ namespace DPDK {
 
 class PsaSwitchOptions : public BMV2::BMV2Options {
   public:
+    /// Run the instruction-level optimizer on the generated code.
+    bool optimizeInstructions = false;
+    /// Lay out the metadata structure by use rather than declaration order.
+    bool optimizeMetadataLayout = false;
+    /// File of the optimized table keys; match kinds are lowered and table
+    /// keys reordered only if it is not empty.
+    cstring optimizeTableKeys = nullptr;
+    /// File of the names of the merged actions; actions are merged only if
+    /// it is not empty.
+    cstring mergeActions = nullptr;
+    /// Put a cache table in front of the @flow_cache blocks.
+    bool flowCache = false;
+    /// Directory of the table const entries files, none if empty.
+    cstring constEntriesDir = nullptr;
+    /// File of the pipeline cost report, none if empty.
+    cstring pipelineCostReport = nullptr;
+
     PsaSwitchOptions() {
         registerOption(
             "--listMidendPasses", nullptr,
@@ -35,6 +52,73 @@ class PsaSwitchOptions : public BMV2::BMV2Options {
                 return false;
             },
             "[PsaSwitch back-end] Lists exact name of all midend passes.\n");
+        registerOption(
+            "--optimize-instructions", nullptr,
+            [this](const char *) {
+                optimizeInstructions = true;
+                return true;
+            },
+            "[PsaSwitch back-end] Propagate copies and constants, and remove dead "
+            "and redundant instructions from the generated code.\n");
+        registerOption(
+            "--optimize-metadata-layout", nullptr,
+            [this](const char *) {
+                optimizeMetadataLayout = true;
+                return true;
+            },
+            "[PsaSwitch back-end] Order the metadata fields by use, move the unused "
+            "fields to the end and align the fields.\n");
+        registerOption(
+            "--optimize-table-keys", "file",
+            [this](const char *arg) {
+                optimizeTableKeys = arg;
+                return true;
+            },
+            "[PsaSwitch back-end] Lower ternary and lpm match kinds when the const "
+            "entries allow it, and order the key fields as in memory with the lpm "
+            "field last. Write to file a line '<table> <P4Info match field> "
+            "<key field> <P4Info match kind> <match kind>' per key field of each "
+            "changed table, in the new key order. The P4Info still lists the P4 "
+            "key: the control plane must build the entries in the new order.\n");
+        registerOption(
+            "--merge-actions", "file",
+            [this](const char *arg) {
+                mergeActions = arg;
+                return true;
+            },
+            "[PsaSwitch back-end] Merge the actions with the same instructions and "
+            "arguments, e.g. the copies of an action used by several tables, and "
+            "write to file a line '<removed action> <kept action>' per removed "
+            "action. The P4Info still lists the removed actions: the control "
+            "plane must use the kept action instead.\n");
+        registerOption(
+            "--flow-cache", nullptr,
+            [this](const char *) {
+                flowCache = true;
+                return true;
+            },
+            "[PsaSwitch back-end] Put an exact match table in front of each block "
+            "annotated with @flow_cache, keyed on the fields the block reads. The "
+            "control plane adds the entries, and clears them when the tables of "
+            "the block change.\n");
+        registerOption(
+            "--const-entries-dir", "dir",
+            [this](const char *arg) {
+                constEntriesDir = arg;
+                return true;
+            },
+            "[PsaSwitch back-end] Write the const entries of each table to "
+            "dir/<table>.txt, in the table entry format of the DPDK pipeline, "
+            "to be loaded with the table add command.\n");
+        registerOption(
+            "--pipeline-cost-report", "file",
+            [this](const char *arg) {
+                pipelineCostReport = arg;
+                return true;
+            },
+            "[PsaSwitch back-end] Write to file, as JSON, the instructions, table "
+            "lookups and metadata bytes of each action, of the apply block and of "
+            "the worst-case path per packet, and print them as a table.\n");
     }
 
     /// Process the command line arguments and set options accordingly.
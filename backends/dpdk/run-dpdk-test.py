@@ -45,6 +45,10 @@ class Options(object):
         self.runDebugger = False
         self.runDebugger_skip = 0
         self.generateP4Runtime = False
+        self.mergeActions = False       # write the merged actions to file.p4.merged-actions
+        self.tableKeys = False          # write the optimized table keys to file.p4.table-keys
+        self.constEntries = False       # write the const entries to file.p4.<table>.txt
+        self.costReport = False         # write the cost report to file.p4.cost.json
 
 def usage(options):
     name = options.binary
@@ -58,6 +62,10 @@ def usage(options):
     print("          -f: replace reference outputs with newly generated ones")
     print("          -a \"args\": pass args to the compiler")
     print("          --p4runtime: generate P4Info message in text format")
+    print("          --merge-actions: merge actions and check the merged action names")
+    print("          --optimize-table-keys: optimize table keys and check the new keys")
+    print("          --const-entries: check the const entries of each table")
+    print("          --pipeline-cost-report: check the pipeline cost report")
 
 def isError(p4filename):
     # True if the filename represents a p4 program that should fail
@@ -204,6 +212,16 @@ def process_file(options, argv):
     if not os.path.isfile(options.p4filename):
         raise Exception("No such file " + options.p4filename)
     args = ["./p4c-dpdk", "--dump", tmpdir, "-o", spec] + options.compilerOptions
+    if options.mergeActions:
+        args.extend(["--merge-actions", os.path.join(tmpdir, basename + ".merged-actions")])
+    if options.tableKeys:
+        args.extend(["--optimize-table-keys", os.path.join(tmpdir, basename + ".table-keys")])
+    entriesdir = os.path.join(tmpdir, "entries")
+    if options.constEntries:
+        os.makedirs(entriesdir)
+        args.extend(["--const-entries-dir", entriesdir])
+    if options.costReport:
+        args.extend(["--pipeline-cost-report", os.path.join(tmpdir, basename + ".cost.json")])
     arch = getArch(options.p4filename)
     if arch is not None:
         args.extend(["--arch", arch])
@@ -228,6 +246,13 @@ def process_file(options, argv):
     if expected_error and result == SUCCESS:
         result = FAILURE
 
+    if options.constEntries:
+        # one file per table, named after the program
+        for file in os.listdir(entriesdir):
+            os.rename(os.path.join(entriesdir, file),
+                      os.path.join(tmpdir, basename + "." + file))
+        os.rmdir(entriesdir)
+
     if result == SUCCESS:
         result = check_generated_files(options, tmpdir, expected_dirname)
 
@@ -285,6 +310,14 @@ def main(argv):
                 options.runDebugger_skip = int(argv[0][4:]) - 1
         elif argv[0] == "--p4runtime":
             options.generateP4Runtime = True
+        elif argv[0] == "--merge-actions":
+            options.mergeActions = True
+        elif argv[0] == "--optimize-table-keys":
+            options.tableKeys = True
+        elif argv[0] == "--const-entries":
+            options.constEntries = True
+        elif argv[0] == "--pipeline-cost-report":
+            options.costReport = True
         else:
             print("Unknown option ", argv[0], file=sys.stderr)
             usage(options)
@@ -1,6 +1,7 @@
 #include "dpdkHelpers.h"
 #include "ir/dbprint.h"
 #include <iostream>
+#include <map>
 
 using namespace DBPrint;
 
@@ -9,87 +10,62 @@ void add_space(std::ostream &out, int size) {
 }
 
 namespace DPDK {
-// this function takes different subclass of Expression and translate it into
-// string in desired format. For example, for PathExpression, it returns
-// PathExpression->path->name For Member, it returns
+// this function takes different subclass of Expression and writes it to out
+// in desired format. For example, for PathExpression, it writes
+// PathExpression->path->name For Member, it writes
 // toStr(Member->expr).Member->member
-cstring toStr(const IR::Expression *const);
-
-// this function takes different subclass of Type and translate it into string
-// in desired format. For example, for Type_Boolean, it returns bool For
-// Type_Bits, it returns bit_<bit_width>
-cstring toStr(const IR::Type *const);
-
-// this function takes different subclass of PropertyValue and translate it into
-// string in desired format. For example, for ExpressionValue, it returns
-// toStr(ExpressionValue->expression)
-cstring toStr(const IR::PropertyValue *const);
-
-cstring toStr(const IR::Constant *const c) {
-    std::ostringstream out;
-    out << "0x" << std::hex << c->value;
-    return out.str();
-}
-
-cstring toDecimal(const IR::Constant*const c) {
-    std::ostringstream out;
-    out << c->value;
-    return out.str();
+// The operands are written straight to the output: the spec of a large
+// program has hundreds of thousands of them, each printed once.
+std::ostream &toStr(std::ostream &out, const IR::Expression *const exp) {
+    if (auto c = exp->to<IR::Constant>()) {
+        out << "0x" << std::hex << c->value << std::dec;
+    } else if (auto b = exp->to<IR::BoolLiteral>()) {
+        out << b->value;
+    } else if (auto m = exp->to<IR::Member>()) {
+        toStr(out, m->expr) << "." << m->member.originalName;
+    } else if (auto p = exp->to<IR::PathExpression>()) {
+        out << p->path->name.name;
+    } else if (auto t = exp->to<IR::TypeNameExpression>()) {
+        out << t->typeName->path->name.name;
+    } else if (auto m = exp->to<IR::MethodCallExpression>()) {
+        if (auto path = m->method->to<IR::PathExpression>())
+            out << path->path->name.toString();
+        else
+            ::error("%1% is not a PathExpression", m->toString());
+    } else if (auto c = exp->to<IR::Cast>()) {
+        toStr(out, c->expr);
+    } else if (auto a = exp->to<IR::ArrayIndex>()) {
+        if (auto cst = a->right->to<IR::Constant>())
+            toStr(out, a->left) << "_" << cst->value;
+        else
+            ::error("%1% is not a constant", a->right);
+    } else {
+        BUG("%1% not implemented", exp);
+    }
+    return out;
 }
 
-cstring toStr(const IR::BoolLiteral *const b) {
+// Same as above, for the passes which need the operand as a string.
+cstring toStr(const IR::Expression *const exp) {
+    if (auto p = exp->to<IR::PathExpression>())
+        return p->path->name.name;
     std::ostringstream out;
-    out << b->value;
+    toStr(out, exp);
     return out.str();
 }
 
-cstring toStr(const IR::Member *const m) {
-    std::ostringstream out;
-    out << m->member.originalName;
-    return toStr(m->expr) + "." + out.str();
-}
-
-cstring toStr(const IR::PathExpression *const p) { return p->path->name; }
-
-cstring toStr(const IR::TypeNameExpression *const p) {
-    return p->typeName->path->name;
-}
-
-cstring toStr(const IR::MethodCallExpression *const m) {
-    if (auto path = m->method->to<IR::PathExpression>()) {
-        return path->path->name.toString();
-    } else {
-        ::error("%1% is not a PathExpression", m->toString());
-    }
-    return "";
-}
-
-cstring toStr(const IR::Expression *const exp) {
-    if (auto e = exp->to<IR::Constant>())
-        return toStr(e);
-    else if (auto e = exp->to<IR::BoolLiteral>())
-        return toStr(e);
-    else if (auto e = exp->to<IR::Member>())
-        return toStr(e);
-    else if (auto e = exp->to<IR::PathExpression>())
-        return toStr(e);
-    else if (auto e = exp->to<IR::TypeNameExpression>())
-        return toStr(e);
-    else if (auto e = exp->to<IR::MethodCallExpression>())
-        return toStr(e);
-    else if (auto e = exp->to<IR::Cast>())
-        return toStr(e->expr);
-    else if (auto e = exp->to<IR::ArrayIndex>()) {
-        if (auto cst = e->right->to<IR::Constant>()) {
-            return toStr(e->left) + "_" + toDecimal(cst);
-        } else {
-            ::error("%1% is not a constant", e->right);
-        }
-    } else
-        BUG("%1% not implemented", exp);
-    return "";
+// Writes an operand with out << operand(expr).
+struct Operand {
+    const IR::Expression *expr;
+};
+static Operand operand(const IR::Expression *expr) { return Operand{expr}; }
+static std::ostream &operator<<(std::ostream &out, const Operand &op) {
+    return toStr(out, op.expr);
 }
 
+// this function takes different subclass of Type and translate it into string
+// in desired format. For example, for Type_Boolean, it returns bool For
+// Type_Bits, it returns bit_<bit_width>
 cstring toStr(const IR::Type *const type) {
     if (type->is<IR::Type_Boolean>())
         return "bool";
@@ -106,6 +82,10 @@ cstring toStr(const IR::Type *const type) {
         BUG("not implemented type");
     }
 }
+
+// this function takes different subclass of PropertyValue and translate it into
+// string in desired format. For example, for ExpressionValue, it returns
+// toStr(ExpressionValue->expression)
 cstring toStr(const IR::PropertyValue *const property) {
     if (auto expr_value = property->to<IR::ExpressionValue>()) {
         return toStr(expr_value->expression);
@@ -119,26 +99,26 @@ cstring toStr(const IR::PropertyValue *const property) {
 
 std::ostream &IR::DpdkAsmProgram::toSpec(std::ostream &out) const {
     for (auto l : globals) {
-        l->toSpec(out) << std::endl;
+        l->toSpec(out) << "\n";
     }
-    out << std::endl;
+    out << "\n";
     for (auto h : headerType)
-        h->toSpec(out) << std::endl;
+        h->toSpec(out) << "\n";
     for (auto s : structType)
-        s->toSpec(out) << std::endl;
+        s->toSpec(out) << "\n";
     for (auto s : externDeclarations)
-        s->toSpec(out) << std::endl;
+        s->toSpec(out) << "\n";
     for (auto a : actions) {
-        a->toSpec(out) << std::endl << std::endl;
+        a->toSpec(out) << "\n\n";
     }
     for (auto t : tables) {
-        t->toSpec(out) << std::endl << std::endl;
+        t->toSpec(out) << "\n\n";
     }
     for (auto s : selectors) {
-        s->toSpec(out) << std::endl;
+        s->toSpec(out) << "\n";
     }
     for (auto s : statements) {
-        s->toSpec(out) << std::endl;
+        s->toSpec(out) << "\n";
     }
     return out;
 }
@@ -162,7 +142,7 @@ std::ostream &IR::DpdkExternDeclaration::toSpec(std::ostream &out) const {
             auto size = args->at(0)->expression;
             auto init_val = args->size() == 2? args->at(1)->expression: nullptr;
             auto regDecl = new IR::DpdkRegisterDeclStatement(this->Name(), size, init_val);
-            regDecl->toSpec(out) << std::endl;
+            regDecl->toSpec(out) << "\n";
         }
     }
     else if ( DPDK::toStr(this->getType()) == "Counter") {
@@ -180,14 +160,14 @@ std::ostream &IR::DpdkExternDeclaration::toSpec(std::ostream &out) const {
                    the counter name is suffixed with _packets and _bytes */
                 auto regDecl = new IR::DpdkRegisterDeclStatement(this->Name()+"_packets", n_counters,
                                                                  new IR::Constant(0));
-                regDecl->toSpec(out) << std::endl << std::endl;
+                regDecl->toSpec(out) << "\n\n";
                 regDecl = new IR::DpdkRegisterDeclStatement(this->Name()+"_bytes", n_counters,
                                                             new IR::Constant(0));
-                regDecl->toSpec(out) << std::endl;
+                regDecl->toSpec(out) << "\n";
             } else {
                 auto regDecl = new IR::DpdkRegisterDeclStatement(this->Name(), n_counters,
                                                                  new IR::Constant(0));
-                regDecl->toSpec(out) << std::endl;
+                regDecl->toSpec(out) << "\n";
             }
         }
     }
@@ -199,14 +179,14 @@ std::ostream &IR::DpdkExternDeclaration::toSpec(std::ostream &out) const {
         } else {
             auto n_meters = args->at(0)->expression;
             auto metDecl = new IR::DpdkMeterDeclStatement(this->Name(), n_meters);
-            metDecl->toSpec(out) << std::endl;
+            metDecl->toSpec(out) << "\n";
         }
     }
     return out;
 }
 
 std::ostream &IR::DpdkHeaderType::toSpec(std::ostream &out) const {
-    out << "struct " << name << " {" << std::endl;
+    out << "struct " << name << " {\n";
     for (auto it = fields.begin(); it != fields.end(); ++it) {
         if (auto t = (*it)->type->to<IR::Type_Bits>())
             out << "\tbit<" << t->width_bits() << ">";
@@ -220,9 +200,9 @@ std::ostream &IR::DpdkHeaderType::toSpec(std::ostream &out) const {
             BUG("Unsupported type: %1% ", *it);
         }
         out << " " << (*it)->externalName();
-        out << std::endl;
+        out << "\n";
     }
-    out << "}" << std::endl;
+    out << "}\n";
     return out;
 }
 
@@ -241,15 +221,15 @@ std::ostream &IR::DpdkStructType::toSpec(std::ostream &out) const {
                 }
                 for (auto i = 0; i < t->size->to<IR::Constant>()->value; i++) {
                     out << "header " << (*it)->name << "_" << i << " instanceof "
-                        << type_name << std::endl;
+                        << type_name << "\n";
                 }
             } else {
                 BUG("Unsupported type %1%", *it);
             }
-            out << std::endl;
+            out << "\n";
         }
     } else {
-        out << "struct " << name << " {" << std::endl;
+        out << "struct " << name << " {\n";
         for (auto it = fields.begin(); it != fields.end(); ++it) {
             if (auto t = (*it)->type->to<IR::Type_Bits>())
                 out << "\tbit<" << t->width_bits() << ">";
@@ -270,29 +250,29 @@ std::ostream &IR::DpdkStructType::toSpec(std::ostream &out) const {
                 BUG("Unsupported type");
             }
             out << " " << (*it)->externalName();
-            out << std::endl;
+            out << "\n";
         }
-        out << "}" << std::endl;
+        out << "}\n";
         if (getAnnotations()->getSingle("__metadata__")) {
-            out << "metadata instanceof " << name << std::endl;
+            out << "metadata instanceof " << name << "\n";
         }
     }
     return out;
 }
 
 std::ostream &IR::DpdkListStatement::toSpec(std::ostream &out) const {
-    out << "apply {" << std::endl;
-    out << "\trx m.psa_ingress_input_metadata_ingress_port" << std::endl;
-    out << "\tmov m.psa_ingress_output_metadata_drop 0x0" << std::endl;
+    out << "apply {\n";
+    out << "\trx m.psa_ingress_input_metadata_ingress_port\n";
+    out << "\tmov m.psa_ingress_output_metadata_drop 0x0\n";
     for (auto s : statements) {
         out << "\t";
         s->toSpec(out);
         if (!s->to<IR::DpdkLabelStatement>())
-            out << std::endl;
+            out << "\n";
     }
-    out << "\ttx m.psa_ingress_output_metadata_egress_port" << std::endl;
-    out << "\tLABEL_DROP : drop" << std::endl;
-    out << "}" << std::endl;
+    out << "\ttx m.psa_ingress_output_metadata_egress_port\n";
+    out << "\tLABEL_DROP : drop\n";
+    out << "}\n";
     return out;
 }
 
@@ -302,12 +282,12 @@ std::ostream &IR::DpdkApplyStatement::toSpec(std::ostream &out) const {
 }
 
 std::ostream &IR::DpdkEmitStatement::toSpec(std::ostream &out) const {
-    out << "emit " << DPDK::toStr(header);
+    out << "emit " << DPDK::operand(header);
     return out;
 }
 
 std::ostream &IR::DpdkExtractStatement::toSpec(std::ostream &out) const {
-    out << "extract " << DPDK::toStr(header);
+    out << "extract " << DPDK::operand(header);
     return out;
 }
 
@@ -317,13 +297,13 @@ std::ostream &IR::DpdkJmpStatement::toSpec(std::ostream &out) const {
 }
 
 std::ostream& IR::DpdkJmpHeaderStatement::toSpec(std::ostream& out) const {
-    out << instruction << " " << label << " " << DPDK::toStr(header);
+    out << instruction << " " << label << " " << DPDK::operand(header);
     return out;
 }
 
 std::ostream& IR::DpdkJmpCondStatement::toSpec(std::ostream& out) const {
-    out << instruction << " " << label << " " << DPDK::toStr(src1)
-        << " " << DPDK::toStr(src2);
+    out << instruction << " " << label << " " << DPDK::operand(src1)
+        << " " << DPDK::operand(src2);
     return out;
 }
 
@@ -331,13 +311,13 @@ std::ostream& IR::DpdkBinaryStatement::toSpec(std::ostream& out) const {
     BUG_CHECK(dst->equiv(*src1), "The first source field %1% in a binary operation"
             "must be the same as the destination field %2% to be supported by DPDK",
             src1, dst);
-    out << instruction << " " << DPDK::toStr(dst)
-        << " " << DPDK::toStr(src2);
+    out << instruction << " " << DPDK::operand(dst)
+        << " " << DPDK::operand(src2);
     return out;
 }
 
 std::ostream& IR::DpdkUnaryStatement::toSpec(std::ostream& out) const {
-    out << instruction << " " << DPDK::toStr(dst) << " " << DPDK::toStr(src);
+    out << instruction << " " << DPDK::operand(dst) << " " << DPDK::operand(src);
     return out;
 }
 
@@ -372,61 +352,162 @@ std::ostream &IR::DpdkLabelStatement::toSpec(std::ostream &out) const {
 }
 
 std::ostream &IR::DpdkTable::toSpec(std::ostream &out) const {
-    out << "table " << name << " {" << std::endl;
+    out << "table " << name << " {\n";
     if (match_keys) {
-        out << "\tkey {" << std::endl;
+        out << "\tkey {\n";
         for (auto key : match_keys->keyElements) {
-            out << "\t\t" << DPDK::toStr(key->expression) << " ";
+            out << "\t\t" << DPDK::operand(key->expression) << " ";
             if ((key->matchType)->toString() == "ternary") {
-                out << "wildcard" << std::endl;
+                out << "wildcard\n";
             } else {
-                out << DPDK::toStr(key->matchType) << std::endl;
+                out << DPDK::operand(key->matchType) << "\n";
             }
         }
-        out << "\t}" << std::endl;
+        out << "\t}\n";
     }
-    out << "\tactions {" << std::endl;
+    out << "\tactions {\n";
     for (auto action : actions->actionList) {
-        out << "\t\t" << DPDK::toStr(action->expression) << std::endl;
+        out << "\t\t" << DPDK::operand(action->expression) << "\n";
     }
-    out << "\t}" << std::endl;
+    out << "\t}\n";
 
-    out << "\tdefault_action " << DPDK::toStr(default_action);
+    out << "\tdefault_action " << DPDK::operand(default_action);
     if (default_action->to<IR::MethodCallExpression>()->arguments->size() ==
         0) {
         out << " args none ";
     } else {
         BUG("non-zero default action arguments not supported yet");
     }
-    out << std::endl;
+    out << "\n";
     if (auto psa_implementation =
             properties->getProperty("psa_implementation")) {
         out << "\taction_selector " << DPDK::toStr(psa_implementation->value)
-            << std::endl;
+            << "\n";
     }
     if (auto size = properties->getProperty("size")) {
-        out << "\tsize " << DPDK::toStr(size->value) << "" << std::endl;
+        out << "\tsize " << DPDK::toStr(size->value) << "\n";
     } else {
-        out << "\tsize 0x10000" << std::endl;
+        out << "\tsize 0x10000\n";
+    }
+    out << "}\n";
+    return out;
+}
+
+// One line per entry, e.g. "match 0x0a000000/0xff000000 priority 0x0 action
+// forward port 0x1". Wildcard tables need a priority, where 0 is the highest;
+// the entries keep the priority of their order.
+std::ostream &IR::DpdkTable::entriesToSpec(std::ostream &out,
+                                           const IR::IndexedVector<IR::DpdkAction> &actions,
+                                           const IR::IndexedVector<IR::DpdkStructType> &structs)
+                                           const {
+    auto entries = properties->getProperty(IR::TableProperties::entriesPropertyName);
+    if (entries == nullptr || !entries->isConstant)
+        return out;
+    auto list = entries->value->to<IR::EntriesList>();
+    if (list == nullptr)
+        return out;
+    bool wildcard = false;
+    if (match_keys) {
+        for (auto key : match_keys->keyElements) {
+            auto kind = key->matchType->toString();
+            if (kind != "exact" && kind != "lpm")
+                wildcard = true;
+        }
+    }
+    std::map<cstring, const IR::DpdkAction *> actionsByName;
+    for (auto a : actions)
+        actionsByName.emplace(a->name.toString(), a);
+
+    unsigned priority = 0;
+    for (auto e : list->entries) {
+        if (e->getAnnotations()->getSingle("priority")) {
+            ::error(ErrorType::ERR_UNSUPPORTED_ON_TARGET,
+                    "%1%: entry priorities are not supported", e);
+            return out;
+        }
+        out << "match";
+        for (auto k : e->keys->components) {
+            out << " ";
+            if (auto m = k->to<IR::Mask>()) {
+                out << DPDK::operand(m->left) << "/" << DPDK::operand(m->right);
+            } else if (k->is<IR::DefaultExpression>()) {
+                out << "0x0/0x0";
+            } else if (k->is<IR::Constant>() || k->is<IR::BoolLiteral>()) {
+                out << DPDK::operand(k);
+            } else {
+                ::error(ErrorType::ERR_UNSUPPORTED_ON_TARGET,
+                        "%1%: unsupported key set in the entries of table %2%", k, name);
+                return out;
+            }
+        }
+        if (wildcard)
+            out << " priority 0x" << std::hex << priority++ << std::dec;
+
+        auto call = e->action->to<IR::MethodCallExpression>();
+        auto action = call ? actionsByName.find(DPDK::toStr(call)) : actionsByName.end();
+        if (action == actionsByName.end()) {
+            ::error(ErrorType::ERR_NOT_FOUND, "%1%: action not found", e->action);
+            return out;
+        }
+        out << " action " << action->first;
+        // The only parameter of an action with arguments is t, of type
+        // <action>_arg_t, whose fields are the arguments.
+        const IR::IndexedVector<IR::StructField> *fields = nullptr;
+        auto &params = action->second->para.parameters;
+        if (!params.empty()) {
+            auto argType = params.at(0)->type->to<IR::Type_Name>();
+            auto args = argType ? structs.getDeclaration<IR::DpdkStructType>(
+                                      argType->path->name.name)
+                                : nullptr;
+            if (args == nullptr) {
+                ::error(ErrorType::ERR_NOT_FOUND, "%1%: argument structure not found",
+                        params.at(0));
+                return out;
+            }
+            fields = &args->fields;
+        }
+        if (fields != nullptr) {
+            // PrependPDotToActionArgs packs the arguments into one struct.
+            auto arg = call->arguments->size() == 1
+                           ? call->arguments->at(0)->expression->to<IR::StructExpression>()
+                           : nullptr;
+            if (arg == nullptr) {
+                ::error(ErrorType::ERR_EXPECTED, "%1%: expected the arguments of %2% in a struct",
+                        call, action->first);
+                return out;
+            }
+            for (auto f : *fields) {
+                auto value = arg->components.getDeclaration<IR::NamedExpression>(f->name);
+                if (value == nullptr) {
+                    ::error(ErrorType::ERR_NOT_FOUND, "%1%: no value for argument %2%", call,
+                            f->name);
+                    return out;
+                }
+                out << " " << f->name << " " << DPDK::operand(value->expression);
+            }
+        } else if (call->arguments->size() != 0) {
+            ::error(ErrorType::ERR_EXPECTED, "%1%: expected no arguments", call);
+            return out;
+        }
+        out << "\n";
     }
-    out << "}" << std::endl;
     return out;
 }
 
 std::ostream &IR::DpdkSelector::toSpec(std::ostream &out) const {
-    out << "selector " << name << " {" << std::endl;
-    out << "\tgroup_id " << group_id << std::endl;
+    out << "selector " << name << " {\n";
+    out << "\tgroup_id " << group_id << "\n";
     if (selectors) {
-        out << "\tselector {" << std::endl;
+        out << "\tselector {\n";
         for (auto key : selectors->keyElements) {
-            out << "\t\t" << DPDK::toStr(key->expression) << std::endl;
+            out << "\t\t" << DPDK::operand(key->expression) << "\n";
         }
-        out << "\t}" << std::endl;
+        out << "\t}\n";
     }
-    out << "\tmember_id " << member_id << std::endl;
-    out << "\tn_groups_max " << n_groups_max << std::endl;
-    out << "\tn_members_per_group_max " << n_members_per_group_max << std::endl;
-    out << "}" << std::endl;
+    out << "\tmember_id " << member_id << "\n";
+    out << "\tn_groups_max " << n_groups_max << "\n";
+    out << "\tn_members_per_group_max " << n_members_per_group_max << "\n";
+    out << "}\n";
     return out;
 }
 
@@ -441,14 +522,14 @@ std::ostream &IR::DpdkAction::toSpec(std::ostream &out) const {
         if (p != para.parameters.back())
             out << " ";
     }
-    out << "{" << std::endl;
+    out << "{\n";
     for (auto i : statements) {
         out << "\t";
         i->toSpec(out);
         if (!i->to<IR::DpdkLabelStatement>())
-            out << std::endl;
+            out << "\n";
     }
-    out << "\treturn" << std::endl;
+    out << "\treturn\n";
     out << "}";
 
     return out;
@@ -456,13 +537,13 @@ std::ostream &IR::DpdkAction::toSpec(std::ostream &out) const {
 
 std::ostream &IR::DpdkChecksumAddStatement::toSpec(std::ostream &out) const {
     out << "ckadd "
-        << "h.cksum_state." << intermediate_value << " " << DPDK::toStr(field);
+        << "h.cksum_state." << intermediate_value << " " << DPDK::operand(field);
     return out;
 }
 
 std::ostream &IR::DpdkChecksumSubStatement::toSpec(std::ostream &out) const {
     out << "cksub "
-        << "h.cksum_state." << intermediate_value << " " << DPDK::toStr(field);
+        << "h.cksum_state." << intermediate_value << " " << DPDK::operand(field);
     return out;
 }
 
@@ -473,10 +554,10 @@ std::ostream &IR::DpdkChecksumClearStatement::toSpec(std::ostream &out) const {
 }
 
 std::ostream &IR::DpdkGetHashStatement::toSpec(std::ostream &out) const {
-    out << "hash_get " << DPDK::toStr(dst) << " " << hash << " (";
+    out << "hash_get " << DPDK::operand(dst) << " " << hash << " (";
     if (auto l = fields->to<IR::ListExpression>()) {
         for (auto c : l->components) {
-            out << " " << DPDK::toStr(c);
+            out << " " << DPDK::operand(c);
         }
     } else {
         ::error("get_hash's arg is not a ListExpression.");
@@ -486,31 +567,31 @@ std::ostream &IR::DpdkGetHashStatement::toSpec(std::ostream &out) const {
 }
 
 std::ostream &IR::DpdkGetChecksumStatement::toSpec(std::ostream &out) const {
-    out << "mov " << DPDK::toStr(dst) << " "
+    out << "mov " << DPDK::operand(dst) << " "
         << "h.cksum_state." << intermediate_value;
     return out;
 }
 
 std::ostream &IR::DpdkCastStatement::toSpec(std::ostream &out) const {
     out << "cast "
-        << " " << DPDK::toStr(dst) << " " << DPDK::toStr(type) << " "
-        << DPDK::toStr(src);
+        << " " << DPDK::operand(dst) << " " << DPDK::toStr(type) << " "
+        << DPDK::operand(src);
     return out;
 }
 
 std::ostream &IR::DpdkVerifyStatement::toSpec(std::ostream &out) const {
-    out << "verify " << DPDK::toStr(condition) << " " << DPDK::toStr(error);
+    out << "verify " << DPDK::operand(condition) << " " << DPDK::operand(error);
     return out;
 }
 
 std::ostream &IR::DpdkMeterDeclStatement::toSpec(std::ostream &out) const {
-    out << "metarray " << meter << " size " << DPDK::toStr(size);
+    out << "metarray " << meter << " size " << DPDK::operand(size);
     return out;
 }
 
 std::ostream &IR::DpdkMeterExecuteStatement::toSpec(std::ostream &out) const {
-    out << "meter " << meter << " " << DPDK::toStr(index) << " " << DPDK::toStr(length);
-    out << " " << DPDK::toStr(color_in) << " " << DPDK::toStr(color_out);
+    out << "meter " << meter << " " << DPDK::operand(index) << " " << DPDK::operand(length);
+    out << " " << DPDK::operand(color_in) << " " << DPDK::operand(color_out);
     return out;
 }
 
@@ -518,42 +599,42 @@ std::ostream &IR::DpdkMeterExecuteStatement::toSpec(std::ostream &out) const {
    is used for incrementing the counter. Packet counters are incremented by packet length
    specified as parameter and byte counters are incremente by 1 */
 std::ostream &IR::DpdkCounterCountStatement::toSpec(std::ostream &out) const {
-    out << "regadd " << counter << " " << DPDK::toStr(index) << " ";
+    out << "regadd " << counter << " " << DPDK::operand(index) << " ";
     if (incr)
-        out << DPDK::toStr(incr);
+        out << DPDK::operand(incr);
     else
         out << "1";
     return out;
 }
 
 std::ostream &IR::DpdkRegisterDeclStatement::toSpec(std::ostream &out) const {
-    out << "regarray " << reg << " size " << DPDK::toStr(size) << " initval ";
+    out << "regarray " << reg << " size " << DPDK::operand(size) << " initval ";
     if (init_val)
-        out << DPDK::toStr(init_val);
+        out << DPDK::operand(init_val);
     else
         out << "0";
     return out;
 }
 
 std::ostream &IR::DpdkRegisterReadStatement::toSpec(std::ostream &out) const {
-    out << "regrd " << DPDK::toStr(dst) << " " << reg << " "
-        << DPDK::toStr(index);
+    out << "regrd " << DPDK::operand(dst) << " " << reg << " "
+        << DPDK::operand(index);
     return out;
 }
 
 std::ostream &IR::DpdkRegisterWriteStatement::toSpec(std::ostream &out) const {
-    out << "regwr " << reg << " " << DPDK::toStr(index) << " "
-        << DPDK::toStr(src);
+    out << "regwr " << reg << " " << DPDK::operand(index) << " "
+        << DPDK::operand(src);
     return out;
 }
 
 std::ostream& IR::DpdkValidateStatement::toSpec(std::ostream& out) const {
-    out << "validate " << DPDK::toStr(header);
+    out << "validate " << DPDK::operand(header);
     return out;
 }
 
 std::ostream& IR::DpdkInvalidateStatement::toSpec(std::ostream& out) const {
-    out << "invalidate " << DPDK::toStr(header);
+    out << "invalidate " << DPDK::operand(header);
     return out;
 }
 
@@ -17,6 +17,7 @@ limitations under the License.
 #include "ebpfControl.h"
 #include "ebpfType.h"
 #include "ebpfTable.h"
+#include "ebpfProfile.h"
 #include "lib/error.h"
 #include "frontends/p4/tableApply.h"
 #include "frontends/p4/typeMap.h"
@@ -305,6 +306,10 @@ void ControlBodyTranslator::processApply(const P4::ApplyMethod* method) {
     }
     builder->blockStart();
 
+    auto profile = control->program->profile;
+    if (profile != nullptr)
+        profile->emitProbe(builder, ProfileCounters::tableLookup(table->instanceName));
+
     BUG_CHECK(method->expr->arguments->size() == 0, "%1%: table apply with arguments", method);
     cstring keyname = "key";
     if (table->keyGenerator != nullptr) {
@@ -325,9 +330,7 @@ void ControlBodyTranslator::processApply(const P4::ApplyMethod* method) {
     if (table->keyGenerator != nullptr) {
         builder->emitIndent();
         builder->appendLine("/* perform lookup */");
-        builder->emitIndent();
-        builder->target->emitTableLookup(builder, table->dataMapName, keyname, valueName);
-        builder->endOfStatement(true);
+        table->emitLookup(builder, keyname, valueName);
     }
 
     builder->emitIndent();
@@ -371,6 +374,8 @@ void ControlBodyTranslator::processApply(const P4::ApplyMethod* method) {
     builder->appendFormat("else return %s", builder->target->abortReturnCode().c_str());
     builder->endOfStatement(true);
 
+    if (profile != nullptr)
+        profile->emitProbe(builder, "control");
     builder->blockEnd(true);
 }
 
@@ -461,6 +466,51 @@ bool ControlBodyTranslator::preorder(const IR::SwitchStatement* statement) {
     return false;
 }
 
+// A block with a flow cache runs on a miss only:
+// {
+//     struct flow_cache_key cache_key = {};
+//     cache_key.key0 = ...;
+//     struct flow_cache_value *cache_value = lookup(flow_cache, &cache_key);
+//     if (cache_value != NULL) {
+//         ... = cache_value->field0;
+//     } else {
+//         <block>
+//         <insert the fields it wrote>
+//     }
+// }
+bool ControlBodyTranslator::preorder(const IR::BlockStatement* statement) {
+    auto cache = control->getFlowCache(statement);
+    if (cache == nullptr)
+        return CodeGenInspector::preorder(statement);
+
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendLine("/* flow cache lookup */");
+    cache->emitKey(builder, this);
+    builder->emitIndent();
+    builder->appendFormat("struct %s *%s = NULL",
+                          cache->valueTypeName.c_str(), cache->valueVar.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->target->emitTableLookup(builder, cache->mapName, cache->keyVar, cache->valueVar);
+    builder->endOfStatement(true);
+
+    builder->emitIndent();
+    builder->appendFormat("if (%s != NULL) ", cache->valueVar.c_str());
+    builder->blockStart();
+    cache->emitRestore(builder, this);
+    builder->blockEnd(false);
+    builder->append(" else ");
+    builder->blockStart();
+    builder->emitIndent();
+    (void)CodeGenInspector::preorder(statement);
+    builder->newline();
+    cache->emitInsert(builder, this);
+    builder->blockEnd(true);
+    builder->blockEnd(false);
+    return false;
+}
+
 /////////////////////////////////////////////////
 
 EBPFControl::EBPFControl(const EBPFProgram* program, const IR::ControlBlock* block,
@@ -511,9 +561,20 @@ bool EBPFControl::build() {
     codeGen->substitute(headers, parserHeaders);
 
     scanConstants();
+    if (program->options.emitFlowCache)
+        buildFlowCaches();
     return ::errorCount() == 0;
 }
 
+void EBPFControl::buildFlowCaches() {
+    // The table implementation is a map; it keeps no state.
+    P4::FindFlowCacheRegions find(program->refMap, program->typeMap,
+                                  { program->model.tableImplProperty.name });
+    (void)controlBlock->container->apply(find);
+    for (auto r : find.regions)
+        flowCaches.emplace(r.first, new EBPFFlowCache(program, r.second));
+}
+
 void EBPFControl::emitDeclaration(CodeBuilder* builder, const IR::Declaration* decl) {
     if (decl->is<IR::Declaration_Variable>()) {
         auto vd = decl->to<IR::Declaration_Variable>();
@@ -550,6 +611,8 @@ void EBPFControl::emitTableTypes(CodeBuilder* builder) {
         it.second->emitTypes(builder);
     for (auto it : counters)
         it.second->emitTypes(builder);
+    for (auto it : flowCaches)
+        it.second->emitTypes(builder);
 }
 
 void EBPFControl::emitTableInstances(CodeBuilder* builder) {
@@ -557,6 +620,8 @@ void EBPFControl::emitTableInstances(CodeBuilder* builder) {
         it.second->emitInstance(builder);
     for (auto it : counters)
         it.second->emitInstance(builder);
+    for (auto it : flowCaches)
+        it.second->emitInstance(builder);
 }
 
 void EBPFControl::emitTableInitializers(CodeBuilder* builder) {
@@ -18,6 +18,7 @@ limitations under the License.
 #define _BACKENDS_EBPF_EBPFCONTROL_H_
 
 #include "ebpfObject.h"
+#include "ebpfFlowCache.h"
 #include "ebpfTable.h"
 #include "ebpfType.h"
 
@@ -49,6 +50,7 @@ class ControlBodyTranslator : public CodeGenInspector {
     bool preorder(const IR::ReturnStatement*) override;
     bool preorder(const IR::IfStatement* statement) override;
     bool preorder(const IR::SwitchStatement* statement) override;
+    bool preorder(const IR::BlockStatement* statement) override;
 };
 
 class EBPFControl : public EBPFObject {
@@ -66,6 +68,7 @@ class EBPFControl : public EBPFObject {
     std::set<const IR::Parameter*> toDereference;
     std::map<cstring, EBPFTable*>  tables;
     std::map<cstring, EBPFCounterTable*>  counters;
+    std::map<const IR::BlockStatement*, EBPFFlowCache*>  flowCaches;
 
     EBPFControl(const EBPFProgram* program, const IR::ControlBlock* block,
                 const IR::Parameter* parserHeaders);
@@ -83,9 +86,12 @@ class EBPFControl : public EBPFObject {
         auto result = ::get(counters, name);
         BUG_CHECK(result != nullptr, "No counter named %1%", name);
         return result; }
+    EBPFFlowCache* getFlowCache(const IR::BlockStatement* block) const
+    { return ::get(flowCaches, block); }
 
  protected:
     void scanConstants();
+    void buildFlowCaches();
 };
 
 }  // namespace EBPF
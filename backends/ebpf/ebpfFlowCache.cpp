@@ -0,0 +1,184 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "ebpfFlowCache.h"
+#include "ebpfType.h"
+
+namespace EBPF {
+
+EBPFFlowCache::EBPFFlowCache(const EBPFProgram* program, const P4::FlowCacheRegion* region) :
+        program(program), region(region) {
+    CHECK_NULL(program); CHECK_NULL(region);
+    mapName = program->refMap->newName(EBPFModel::reserved("flow_cache"));
+    keyTypeName = program->refMap->newName(mapName + "_key");
+    valueTypeName = program->refMap->newName(mapName + "_value");
+    keyVar = program->refMap->newName("cache_key");
+    valueVar = program->refMap->newName("cache_value");
+    entryVar = program->refMap->newName("cache_entry");
+    errorMapName = program->refMap->newName(mapName + "_insert_errors");
+    keyFields = layout(region->key, "key");
+    valueFields = layout(region->value, "field");
+}
+
+// Fields in decreasing order of size, as in the table keys, so that the
+// structures have no gaps.
+std::vector<EBPFFlowCache::Field>
+EBPFFlowCache::layout(const std::vector<const IR::Expression*> &fields, cstring prefix) const {
+    std::multimap<unsigned, Field> ordered;
+    unsigned fieldNumber = 0;
+    for (auto f : fields) {
+        auto type = EBPFTypeFactory::instance->create(program->typeMap->getType(f, true));
+        BUG_CHECK(type->is<IHasWidth>(), "%1%: unexpected flow cache field type", f);
+        cstring name = prefix + Util::toString(fieldNumber++);
+        ordered.emplace(type->to<IHasWidth>()->widthInBits(), Field{ f, name, type });
+    }
+    std::vector<Field> result;
+    for (auto it = ordered.rbegin(); it != ordered.rend(); ++it)
+        result.push_back(it->second);
+    return result;
+}
+
+void EBPFFlowCache::emitStruct(CodeBuilder* builder, cstring typeName,
+                               const std::vector<Field> &fields) const {
+    CodeGenInspector commentGen(program->refMap, program->typeMap);
+    commentGen.setBuilder(builder);
+
+    builder->emitIndent();
+    builder->appendFormat("struct %s ", typeName.c_str());
+    builder->blockStart();
+    for (auto &f : fields) {
+        builder->emitIndent();
+        f.type->declare(builder, f.name, false);
+        builder->append("; /* ");
+        f.expression->apply(commentGen);
+        builder->append(" */");
+        builder->newline();
+    }
+    builder->blockEnd(false);
+    builder->endOfStatement(true);
+}
+
+void EBPFFlowCache::emitTypes(CodeBuilder* builder) const {
+    builder->emitIndent();
+    builder->append("/* Flow cache");
+    if (!region->tables.empty()) {
+        builder->append("; clear it when these tables change:");
+        for (auto t : region->tables)
+            builder->appendFormat(" %s", EBPFObject::externalName(t).c_str());
+    }
+    builder->append(" */");
+    builder->newline();
+    emitStruct(builder, keyTypeName, keyFields);
+    emitStruct(builder, valueTypeName, valueFields);
+}
+
+void EBPFFlowCache::emitInstance(CodeBuilder* builder) const {
+    builder->target->emitTableDecl(builder, mapName, TableLRUHash,
+                                   cstring("struct ") + keyTypeName,
+                                   cstring("struct ") + valueTypeName, region->size);
+    builder->target->emitTableDecl(builder, errorMapName, TablePerCPUArray,
+                                   "u32", "u64", 1);
+}
+
+void EBPFFlowCache::emitCopy(CodeBuilder* builder, CodeGenInspector* codeGen,
+                             const Field &field, cstring prefix, bool toStruct) const {
+    auto scalar = field.type->to<EBPFScalarType>();
+    builder->emitIndent();
+    if (scalar != nullptr &&
+        !EBPFScalarType::generatesScalar(scalar->implementationWidthInBits())) {
+        builder->append("memcpy(&");
+        if (toStruct) {
+            builder->appendFormat("%s%s, &", prefix.c_str(), field.name.c_str());
+            codeGen->visit(field.expression);
+        } else {
+            codeGen->visit(field.expression);
+            builder->appendFormat(", &%s%s", prefix.c_str(), field.name.c_str());
+        }
+        builder->appendFormat(", %d)", scalar->bytesRequired());
+    } else if (toStruct) {
+        builder->appendFormat("%s%s = ", prefix.c_str(), field.name.c_str());
+        codeGen->visit(field.expression);
+    } else {
+        codeGen->visit(field.expression);
+        builder->appendFormat(" = %s%s", prefix.c_str(), field.name.c_str());
+    }
+    builder->endOfStatement(true);
+}
+
+void EBPFFlowCache::emitKey(CodeBuilder* builder, CodeGenInspector* codeGen) const {
+    builder->emitIndent();
+    builder->appendFormat("struct %s %s = {}", keyTypeName.c_str(), keyVar.c_str());
+    builder->endOfStatement(true);
+    for (auto &f : keyFields)
+        emitCopy(builder, codeGen, f, keyVar + ".", true);
+}
+
+void EBPFFlowCache::emitRestore(CodeBuilder* builder, CodeGenInspector* codeGen) const {
+    for (auto &f : valueFields)
+        emitCopy(builder, codeGen, f, valueVar + "->", false);
+}
+
+void EBPFFlowCache::emitInsert(CodeBuilder* builder, CodeGenInspector* codeGen) const {
+    cstring ret = program->refMap->newName("cache_ret");
+    cstring errorKey = program->refMap->newName("cache_error_key");
+    cstring errors = program->refMap->newName("cache_errors");
+    cstring firstError = program->refMap->newName("cache_first_error");
+
+    builder->emitIndent();
+    builder->appendFormat("struct %s %s = {}", valueTypeName.c_str(), entryVar.c_str());
+    builder->endOfStatement(true);
+    for (auto &f : valueFields)
+        emitCopy(builder, codeGen, f, entryVar + ".", true);
+    builder->emitIndent();
+    builder->appendFormat("int %s = ", ret.c_str());
+    builder->target->emitTableUpdate(builder, mapName, keyVar, entryVar);
+    builder->newline();
+
+    // The packet was processed; count the failure so that the control
+    // plane can see that the cache does not work.
+    builder->emitIndent();
+    builder->appendFormat("if (%s != 0) ", ret.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendFormat("u32 %s = 0", errorKey.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendFormat("u64 *%s = NULL", errors.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->target->emitTableLookup(builder, errorMapName, errorKey, errors);
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendFormat("if (%s != NULL)", errors.c_str());
+    builder->newline();
+    builder->increaseIndent();
+    builder->emitIndent();
+    // No other CPU writes to a per-CPU value
+    builder->appendFormat("*%s += 1", errors.c_str());
+    builder->endOfStatement(true);
+    builder->decreaseIndent();
+    builder->emitIndent();
+    builder->append("else ");
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendFormat("u64 %s = 1", firstError.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->target->emitTableUpdate(builder, errorMapName, errorKey, firstError);
+    builder->newline();
+    builder->blockEnd(true);
+    builder->blockEnd(true);
+}
+
+}  // namespace EBPF
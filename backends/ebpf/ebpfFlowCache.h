@@ -0,0 +1,79 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef _BACKENDS_EBPF_EBPFFLOWCACHE_H_
+#define _BACKENDS_EBPF_EBPFFLOWCACHE_H_
+
+#include "ebpfObject.h"
+#include "ebpfProgram.h"
+#include "midend/flowCache.h"
+
+namespace EBPF {
+
+/**
+ * LRU hash map in front of a block annotated with @flow_cache, emitted
+ * with --emit-flow-cache.  The key holds the key fields of the region and
+ * the value the fields it writes.  On a hit the generated code copies the
+ * value to the fields instead of running the block; on a miss it runs
+ * the block and inserts the fields it wrote, evicting the least recently
+ * used flow when the map is full.  Inserts which fail anyway are counted
+ * in a per-CPU array of one element.  The control plane must clear the
+ * map when it changes the tables of the block; they are listed in a
+ * comment next to the map types.
+ */
+class EBPFFlowCache : public EBPFObject {
+    /// Field name and type of each key or value field, in declaration order.
+    struct Field {
+        const IR::Expression* expression;
+        cstring name;
+        EBPFType* type;
+    };
+    std::vector<Field> keyFields;
+    std::vector<Field> valueFields;
+
+    std::vector<Field> layout(const std::vector<const IR::Expression*> &fields,
+                              cstring prefix) const;
+    void emitStruct(CodeBuilder* builder, cstring typeName,
+                    const std::vector<Field> &fields) const;
+    /// Copy a field to or from prefix + field.name, with memcpy for wide fields.
+    void emitCopy(CodeBuilder* builder, CodeGenInspector* codeGen, const Field &field,
+                  cstring prefix, bool toStruct) const;
+
+ public:
+    const EBPFProgram* program;
+    const P4::FlowCacheRegion* region;
+    cstring mapName;
+    cstring keyTypeName;
+    cstring valueTypeName;
+    cstring keyVar;
+    cstring valueVar;
+    cstring entryVar;
+    cstring errorMapName;
+
+    EBPFFlowCache(const EBPFProgram* program, const P4::FlowCacheRegion* region);
+
+    void emitTypes(CodeBuilder* builder) const;
+    void emitInstance(CodeBuilder* builder) const;
+    /// Declare keyVar and fill it with the key fields.
+    void emitKey(CodeBuilder* builder, CodeGenInspector* codeGen) const;
+    /// Copy the fields stored in *valueVar to the fields.
+    void emitRestore(CodeBuilder* builder, CodeGenInspector* codeGen) const;
+    /// Declare entryVar, fill it with the fields and insert it under keyVar;
+    /// count the insert in errorMapName if it fails.
+    void emitInsert(CodeBuilder* builder, CodeGenInspector* codeGen) const;
+};
+
+}  // namespace EBPF
+
+#endif /* _BACKENDS_EBPF_EBPFFLOWCACHE_H_ */
@@ -55,6 +55,7 @@ class EBPFModel : public ::Model::Model {
                   array_table("array_table"),
                   hash_table("hash_table"),
                   tableImplProperty("implementation"),
+                  rangeMatch("range"),
                   CPacketName("skb"),
                   packet("packet", P4::P4CoreLibrary::instance.packetIn, 0),
                   filter(), counterIndexType("u32"), counterValueType("u32")
@@ -68,6 +69,7 @@ class EBPFModel : public ::Model::Model {
     TableImpl_Model        array_table;
     TableImpl_Model        hash_table;
     ::Model::Elem          tableImplProperty;
+    ::Model::Elem          rangeMatch;
     ::Model::Elem          CPacketName;
     ::Model::Param_Model   packet;
     Filter_Model           filter;
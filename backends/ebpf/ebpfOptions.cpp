@@ -23,4 +23,16 @@ EbpfOptions::EbpfOptions() {
         registerOption("--emit-externs", nullptr,
                 [this](const char*) { emitExterns = true; return true; },
                 "[ebpf back-end] Allow for user-provided implementation of extern functions.");
+        registerOption("--emit-profile-counters", nullptr,
+                [this](const char*) { emitProfileCounters = true; return true; },
+                "[ebpf back-end] Count the calls and the time spent in each parser state,\n"
+                "table lookup and action in a per-CPU array map.");
+        registerOption("--emit-percpu-counters", nullptr,
+                [this](const char*) { emitPerCPUCounters = true; return true; },
+                "[ebpf back-end] Implement counters with per-CPU maps incremented without\n"
+                "atomic operations; the control plane reads them with <counter>_read.");
+        registerOption("--emit-flow-cache", nullptr,
+                [this](const char*) { emitFlowCache = true; return true; },
+                "[ebpf back-end] Put a hash map in front of each block annotated with\n"
+                "@flow_cache, which stores the fields the block writes for the fields it reads.");
 }
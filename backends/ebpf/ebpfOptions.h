@@ -29,6 +29,12 @@ class EbpfOptions : public CompilerOptions {
     bool loadIRFromJson = false;
     // Externs generation
     bool emitExterns = false;
+    // Instrument the generated code with per-region time counters
+    bool emitProfileCounters = false;
+    // Keep one copy of each counter per CPU
+    bool emitPerCPUCounters = false;
+    // Put a hash map in front of the @flow_cache blocks
+    bool emitFlowCache = false;
     EbpfOptions();
 };
 
@@ -16,6 +16,7 @@ limitations under the License.
 
 #include "ebpfModel.h"
 #include "ebpfParser.h"
+#include "ebpfProfile.h"
 #include "ebpfType.h"
 #include "frontends/p4/coreLibrary.h"
 #include "frontends/p4/methodInstance.h"
@@ -30,6 +31,10 @@ class StateTranslationVisitor : public CodeGenInspector {
 
     void compileExtractField(const IR::Expression* expr, cstring name,
                              unsigned alignment, EBPFType* type);
+    void compileExtractFields(const IR::Expression* expr,
+                              const std::vector<const IR::StructField*>& fields,
+                              const std::vector<EBPFType*>& types,
+                              unsigned alignment, unsigned loadBytes);
     void compileExtract(const IR::Expression* destination);
     void compileLookahead(const IR::Expression* destination);
 
@@ -98,6 +103,10 @@ bool StateTranslationVisitor::preorder(const IR::ParserState* parserState) {
     builder->spc();
     builder->blockStart();
 
+    auto profile = state->parser->program->profile;
+    if (profile != nullptr)
+        profile->emitProbe(builder, ProfileCounters::parserState(parserState->name.name));
+
     visit(parserState->components, "components");
     if (parserState->selectExpression == nullptr) {
         builder->emitIndent();
@@ -252,6 +261,70 @@ StateTranslationVisitor::compileExtractField(
     builder->newline();
 }
 
+/// Extract consecutive fields which fit together in a single load of
+/// loadBytes bytes: the packet is read once, and each field is shifted
+/// and masked out of the loaded value.
+void
+StateTranslationVisitor::compileExtractFields(
+    const IR::Expression* expr, const std::vector<const IR::StructField*>& fields,
+    const std::vector<EBPFType*>& types, unsigned alignment, unsigned loadBytes) {
+    auto program = state->parser->program;
+    cstring word = EBPFModel::reserved("word");
+    const char* helper;
+    const char* wordType;
+    switch (loadBytes) {
+        case 1: helper = "load_byte"; wordType = "u8"; break;
+        case 2: helper = "load_half"; wordType = "u16"; break;
+        case 4: helper = "load_word"; wordType = "u32"; break;
+        case 8: helper = "load_dword"; wordType = "u64"; break;
+        default: BUG("Unexpected load size %d", loadBytes);
+    }
+
+    builder->emitIndent();
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendFormat("%s %s = %s(%s, BYTES(%s))", wordType, word.c_str(), helper,
+                          program->packetStartVar.c_str(), program->offsetVar.c_str());
+    builder->endOfStatement(true);
+
+    unsigned bitOffset = alignment;
+    for (size_t i = 0; i < fields.size(); i++) {
+        auto et = dynamic_cast<IHasWidth*>(types[i]);
+        unsigned width = et->widthInBits();
+        unsigned shift = loadBytes * 8 - bitOffset - width;
+        builder->emitIndent();
+        visit(expr);
+        builder->appendFormat(".%s = (", fields[i]->name.name.c_str());
+        types[i]->emit(builder);
+        builder->append(")(");
+        if (shift != 0)
+            builder->appendFormat("(%s >> %d)", word.c_str(), shift);
+        else
+            builder->append(word);
+        // the cast truncates fields which fill their C type
+        if (width < et->implementationWidthInBits()) {
+            builder->appendFormat(" & EBPF_MASK(%s, %d)", wordType, width);
+        }
+        builder->append(")");
+        builder->endOfStatement(true);
+        bitOffset += width;
+    }
+    builder->blockEnd(true);
+
+    builder->emitIndent();
+    builder->appendFormat("%s += %d", program->offsetVar.c_str(), bitOffset - alignment);
+    builder->endOfStatement(true);
+    builder->newline();
+}
+
+/// Smallest load helper size in bytes covering 'bytes' bytes; 0 if none.
+static unsigned loadSizeFor(unsigned bytes) {
+    for (unsigned size = 1; size <= 8; size *= 2)
+        if (bytes <= size)
+            return size;
+    return 0;
+}
+
 void
 StateTranslationVisitor::compileExtract(const IR::Expression* destination) {
     auto type = state->parser->typeMap->getType(destination);
@@ -281,7 +354,9 @@ StateTranslationVisitor::compileExtract(const IR::Expression* destination) {
     builder->newline();
     builder->blockEnd(true);
 
-    unsigned alignment = 0;
+    std::vector<const IR::StructField*> fields;
+    std::vector<EBPFType*> types;
+    std::vector<unsigned> widths;
     for (auto f : ht->fields) {
         auto ftype = state->parser->typeMap->getType(f);
         auto etype = EBPFTypeFactory::instance->create(ftype);
@@ -291,9 +366,42 @@ StateTranslationVisitor::compileExtract(const IR::Expression* destination) {
                     "Only headers with fixed widths supported %1%", f);
             return;
         }
-        compileExtractField(destination, f->name, alignment, etype);
-        alignment += et->widthInBits();
-        alignment %= 8;
+        fields.push_back(f);
+        types.push_back(etype);
+        widths.push_back(et->widthInBits());
+    }
+
+    // Group consecutive fields into runs read by one aligned-size load.
+    // A load never extends past the end of the header, so the bounds
+    // check above covers it.
+    unsigned headerBytes = ROUNDUP(width, 8);
+    unsigned bitOffset = 0;
+    for (size_t i = 0; i < fields.size(); ) {
+        unsigned start = bitOffset;
+        unsigned firstByte = start / 8;
+        unsigned end = start;
+        unsigned loadBytes = 0;
+        size_t next = i;
+        while (next < fields.size() && widths[next] <= 64) {
+            unsigned bytes = loadSizeFor(ROUNDUP(end + widths[next], 8) - firstByte);
+            if (bytes == 0 || firstByte + bytes > headerBytes)
+                break;
+            end += widths[next];
+            loadBytes = bytes;
+            next++;
+        }
+
+        if (next - i > 1) {
+            std::vector<const IR::StructField*> run(fields.begin() + i, fields.begin() + next);
+            std::vector<EBPFType*> runTypes(types.begin() + i, types.begin() + next);
+            compileExtractFields(destination, run, runTypes, start % 8, loadBytes);
+            bitOffset = end;
+            i = next;
+        } else {
+            compileExtractField(destination, fields[i]->name, start % 8, types[i]);
+            bitOffset += widths[i];
+            i++;
+        }
     }
 
     if (ht->is<IR::Type_Header>()) {
@@ -411,10 +519,21 @@ void EBPFParser::emit(CodeBuilder* builder) {
 
     // Create a synthetic reject state
     builder->emitIndent();
-    builder->appendFormat("%s: { return %s; }",
-                          IR::ParserState::reject.c_str(),
-                          builder->target->abortReturnCode().c_str());
-    builder->newline();
+    if (program->profile != nullptr) {
+        // charge the last parser state before leaving
+        builder->appendFormat("%s: ", IR::ParserState::reject.c_str());
+        builder->blockStart();
+        program->profile->emitProbe(builder, "other");
+        builder->emitIndent();
+        builder->appendFormat("return %s;", builder->target->abortReturnCode().c_str());
+        builder->newline();
+        builder->blockEnd(true);
+    } else {
+        builder->appendFormat("%s: { return %s; }",
+                              IR::ParserState::reject.c_str(),
+                              builder->target->abortReturnCode().c_str());
+        builder->newline();
+    }
     builder->newline();
 }
 
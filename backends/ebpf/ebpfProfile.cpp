@@ -0,0 +1,145 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "ebpfProfile.h"
+
+namespace EBPF {
+
+ProfileCounters::ProfileCounters(cstring prefix) {
+    mapName = prefix + "profile_counters";
+    counterTypeName = prefix + "profile_counter";
+    helperName = prefix + "profile_enter";
+    currentVar = prefix + "profile_current";
+    startVar = prefix + "profile_start";
+    add("other");
+}
+
+unsigned ProfileCounters::add(cstring region) {
+    auto it = ids.find(region);
+    if (it != ids.end())
+        return it->second;
+    unsigned id = names.size();
+    ids.emplace(region, id);
+    names.push_back(region);
+    return id;
+}
+
+void ProfileCounters::emitTypes(CodeBuilder* builder) const {
+    builder->emitIndent();
+    builder->appendFormat("struct %s ", counterTypeName.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendFormat("%s calls;", u64Type.c_str());
+    builder->newline();
+    builder->emitIndent();
+    builder->appendFormat("%s ns;", u64Type.c_str());
+    builder->newline();
+    builder->blockEnd(false);
+    builder->endOfStatement(true);
+
+    builder->appendFormat("#define PROFILE_COUNTER_TYPE struct %s", counterTypeName.c_str());
+    builder->newline();
+    builder->appendFormat("#define PROFILE_COUNTER_MAP \"%s\"", mapName.c_str());
+    builder->newline();
+    builder->appendFormat("#define PROFILE_COUNTERS %u", (unsigned)names.size());
+    builder->newline();
+    builder->append("#define PROFILE_COUNTER_NAMES {");
+    for (auto name : names)
+        builder->appendFormat(" \\\n    \"%s\",", name.c_str());
+    builder->append(" \\\n}");
+    builder->newline();
+}
+
+void ProfileCounters::emitInstance(CodeBuilder* builder) const {
+    builder->target->emitTableDecl(builder, mapName, TablePerCPUArray, u32Type,
+                                   cstring("struct ") + counterTypeName, names.size());
+}
+
+void ProfileCounters::emitHelper(CodeBuilder* builder) const {
+    cstring counter = "counter";
+    // The helper runs at every probe; make sure the BPF compiler inlines it
+    // even where the runtime headers do not define __always_inline.
+    builder->appendLine("#ifndef __always_inline");
+    builder->appendLine("#define __always_inline inline __attribute__((always_inline))");
+    builder->appendLine("#endif");
+    builder->appendFormat("static __always_inline void %s(%s *current, %s *start, %s next) ",
+                          helperName.c_str(), u32Type.c_str(), u64Type.c_str(),
+                          u32Type.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendFormat("%s now = %s", u64Type.c_str(), timeCall.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendFormat("%s id = *current", u32Type.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendFormat("struct %s *%s = NULL", counterTypeName.c_str(), counter.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    emitLookup(builder, "id", counter);
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendFormat("if (%s != NULL) ", counter.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendFormat("%s->calls++", counter.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendFormat("%s->ns += now - *start", counter.c_str());
+    builder->endOfStatement(true);
+    builder->blockEnd(false);
+    builder->append(" else ");
+    builder->blockStart();
+    // Kernel arrays are preallocated; the userspace emulations are not.
+    builder->emitIndent();
+    builder->appendFormat("struct %s init = { 1, now - *start }", counterTypeName.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    emitUpdate(builder, "id", "init");
+    builder->endOfStatement(true);
+    builder->blockEnd(true);
+    builder->emitIndent();
+    builder->appendLine("*current = next;");
+    builder->emitIndent();
+    builder->appendLine("*start = now;");
+    builder->blockEnd(true);
+}
+
+void ProfileCounters::emitLookup(CodeBuilder* builder, cstring key, cstring value) const {
+    builder->target->emitTableLookup(builder, mapName, key, value);
+}
+
+void ProfileCounters::emitUpdate(CodeBuilder* builder, cstring key, cstring value) const {
+    builder->target->emitTableUpdate(builder, mapName, key, value);
+}
+
+void ProfileCounters::emitLocalVariables(CodeBuilder* builder) const {
+    builder->emitIndent();
+    builder->appendFormat("%s %s = %u;", u32Type.c_str(), currentVar.c_str(), otherId);
+    builder->newline();
+    builder->emitIndent();
+    builder->appendFormat("%s %s = %s;", u64Type.c_str(), startVar.c_str(), timeCall.c_str());
+    builder->newline();
+}
+
+void ProfileCounters::emitProbe(CodeBuilder* builder, cstring region) const {
+    auto it = ids.find(region);
+    BUG_CHECK(it != ids.end(), "%1%: profiling region not registered", region);
+    builder->emitIndent();
+    builder->appendFormat("%s(&%s, &%s, %u);", helperName.c_str(), currentVar.c_str(),
+                          startVar.c_str(), it->second);
+    builder->newline();
+}
+
+}  // namespace EBPF
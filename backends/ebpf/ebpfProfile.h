@@ -0,0 +1,78 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef _BACKENDS_EBPF_EBPFPROFILE_H_
+#define _BACKENDS_EBPF_EBPFPROFILE_H_
+
+#include "ebpfObject.h"
+
+namespace EBPF {
+
+/**
+ * Profiling instrumentation, emitted with --emit-profile-counters.
+ *
+ * The generated program is split into regions: the parser states, the
+ * lookup of each table, each action of each table, and the remaining
+ * control code.  The program keeps the id of the region it is executing
+ * and the time it entered it; a probe charges the elapsed time to the
+ * current region and switches to the next one.  Calls and nanoseconds
+ * accumulate in a per-CPU array map indexed by region id, which the
+ * runtimes dump after a run.  The region names are emitted in the
+ * generated header as the PROFILE_COUNTER_NAMES initializer, next to
+ * the PROFILE_COUNTER_MAP name and the PROFILE_COUNTER_TYPE.
+ */
+class ProfileCounters : public EBPFObject {
+    std::map<cstring, unsigned> ids;
+    std::vector<cstring> names;
+
+ public:
+    /// Region of the code outside of all other regions.
+    static const unsigned otherId = 0;
+
+    cstring mapName;
+    cstring counterTypeName;
+    cstring helperName;
+    cstring currentVar;
+    cstring startVar;
+    /// C expression reading the current time in nanoseconds.
+    cstring timeCall = "bpf_ktime_get_ns()";
+    cstring u32Type = "u32";
+    cstring u64Type = "u64";
+
+    explicit ProfileCounters(cstring prefix);
+
+    /// Register a region; returns its id.  Registering twice is harmless.
+    unsigned add(cstring region);
+    static cstring parserState(cstring state) { return "parser." + state; }
+    static cstring tableLookup(cstring table) { return "table." + table; }
+    static cstring action(cstring table, cstring action)
+    { return "action." + table + "." + action; }
+
+    void emitTypes(CodeBuilder* builder) const;
+    void emitInstance(CodeBuilder* builder) const;
+    void emitHelper(CodeBuilder* builder) const;
+    void emitLocalVariables(CodeBuilder* builder) const;
+    /// Charge the time since the previous probe and enter region.
+    void emitProbe(CodeBuilder* builder, cstring region) const;
+
+ protected:
+    /// Emit 'value = lookup(&key)' for the counters map.
+    virtual void emitLookup(CodeBuilder* builder, cstring key, cstring value) const;
+    /// Emit 'update(&key, &value)' for the counters map.
+    virtual void emitUpdate(CodeBuilder* builder, cstring key, cstring value) const;
+};
+
+}  // namespace EBPF
+
+#endif /* _BACKENDS_EBPF_EBPFPROFILE_H_ */
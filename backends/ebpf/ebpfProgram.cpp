@@ -22,6 +22,7 @@ limitations under the License.
 #include "ebpfControl.h"
 #include "ebpfParser.h"
 #include "ebpfTable.h"
+#include "ebpfProfile.h"
 #include "frontends/p4/coreLibrary.h"
 #include "frontends/common/options.h"
 
@@ -55,9 +56,28 @@ bool EBPFProgram::build() {
     if (!success)
         return success;
 
+    if (options.emitProfileCounters)
+        buildProfileCounters();
     return true;
 }
 
+void EBPFProgram::buildProfileCounters() {
+    profile = new ProfileCounters(EBPFModel::reserved(""));
+    for (auto s : parser->states)
+        profile->add(ProfileCounters::parserState(s->state->name.name));
+    profile->add("control");
+    for (auto it : control->tables) {
+        auto table = it.second;
+        profile->add(ProfileCounters::tableLookup(table->instanceName));
+        for (auto a : table->actionList->actionList) {
+            auto adecl = refMap->getDeclaration(a->getPath(), true);
+            auto action = adecl->getNode()->to<IR::P4Action>();
+            profile->add(ProfileCounters::action(table->instanceName,
+                                                 EBPFObject::externalName(action)));
+        }
+    }
+}
+
 void EBPFProgram::emitC(CodeBuilder* builder, cstring header) {
     emitGeneratedComment(builder);
 
@@ -75,8 +95,14 @@ void EBPFProgram::emitC(CodeBuilder* builder, cstring header) {
     emitPreamble(builder);
     builder->append("REGISTER_START()\n");
     control->emitTableInstances(builder);
+    if (profile != nullptr)
+        profile->emitInstance(builder);
     builder->append("REGISTER_END()\n");
     builder->newline();
+    if (profile != nullptr) {
+        profile->emitHelper(builder);
+        builder->newline();
+    }
     builder->emitIndent();
     builder->target->emitCodeSection(builder, functionName);
     builder->emitIndent();
@@ -99,6 +125,8 @@ void EBPFProgram::emitC(CodeBuilder* builder, cstring header) {
 
     builder->emitIndent();
     builder->appendFormat("%s:\n", endLabel.c_str());
+    if (profile != nullptr)
+        profile->emitProbe(builder, "other");
     builder->emitIndent();
     builder->appendFormat("if (%s)\n", control->accept->name.name.c_str());
     builder->increaseIndent();
@@ -138,6 +166,8 @@ void EBPFProgram::emitH(CodeBuilder* builder, cstring) {
     builder->newline();
     emitTypes(builder);
     control->emitTableTypes(builder);
+    if (profile != nullptr)
+        profile->emitTypes(builder);
     builder->appendLine("#if CONTROL_PLANE");
     builder->appendLine("static void init_tables() ");
     builder->blockStart();
@@ -239,6 +269,9 @@ void EBPFProgram::emitLocalVariables(CodeBuilder* builder) {
     builder->emitIndent();
     builder->appendFormat("unsigned char %s;", byteVar.c_str());
     builder->newline();
+
+    if (profile != nullptr)
+        profile->emitLocalVariables(builder);
 }
 
 void EBPFProgram::emitHeaderInstances(CodeBuilder* builder) {
@@ -253,6 +286,8 @@ void EBPFProgram::emitPipeline(CodeBuilder* builder) {
     builder->newline();
     builder->emitIndent();
     builder->blockStart();
+    if (profile != nullptr)
+        profile->emitProbe(builder, "control");
     control->emit(builder);
     builder->blockEnd(true);
 }
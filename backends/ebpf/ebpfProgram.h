@@ -34,6 +34,7 @@ class EBPFParser;
 class EBPFControl;
 class EBPFTable;
 class EBPFType;
+class ProfileCounters;
 
 class EBPFProgram : public EBPFObject {
  public:
@@ -45,6 +46,7 @@ class EBPFProgram : public EBPFObject {
     EBPFParser*          parser;
     EBPFControl*         control;
     EBPFModel           &model;
+    ProfileCounters*     profile;  // nullptr unless profiling
 
     cstring endLabel, offsetVar, lengthVar;
     cstring zeroKey, functionName, errorVar;
@@ -59,7 +61,7 @@ class EBPFProgram : public EBPFObject {
                 P4::ReferenceMap* refMap, P4::TypeMap* typeMap, const IR::ToplevelBlock* toplevel) :
             options(options), program(program), toplevel(toplevel),
             refMap(refMap), typeMap(typeMap),
-            parser(nullptr), control(nullptr), model(EBPFModel::instance) {
+            parser(nullptr), control(nullptr), model(EBPFModel::instance), profile(nullptr) {
         offsetVar = EBPFModel::reserved("packetOffsetInBits");
         zeroKey = EBPFModel::reserved("zero");
         functionName = EBPFModel::reserved("filter");
@@ -78,6 +80,7 @@ class EBPFProgram : public EBPFObject {
     virtual void emitHeaderInstances(CodeBuilder* builder);
     virtual void emitLocalVariables(CodeBuilder* builder);
     virtual void emitPipeline(CodeBuilder* builder);
+    virtual void buildProfileCounters();
 
  public:
     virtual void emitH(CodeBuilder* builder, cstring headerFile);  // emits C headers
@@ -15,10 +15,12 @@ limitations under the License.
 */
 
 #include "ebpfTable.h"
+#include "ebpfProfile.h"
 #include "ebpfType.h"
 #include "ir/ir.h"
 #include "frontends/p4/coreLibrary.h"
 #include "frontends/p4/methodInstance.h"
+#include "lib/gmputil.h"
 
 namespace EBPF {
 
@@ -60,6 +62,37 @@ class ActionTranslationVisitor : public CodeGenInspector {
         return false;
     }
 };  // ActionTranslationVisitor
+
+/// Size and alignment in bytes of a key field of type @type.
+void keyFieldLayout(EBPFType* type, unsigned &size, unsigned &align) {
+    if (auto scalar = type->to<EBPFScalarType>()) {
+        bool isScalar = EBPFScalarType::generatesScalar(scalar->width);
+        size = isScalar ? scalar->alignment() : scalar->bytesRequired();
+        align = scalar->alignment();
+    } else {
+        size = ROUNDUP(type->to<IHasWidth>()->implementationWidthInBits(), 8);
+        align = size;
+    }
+}
+
+/// A masked key value: (value, mask).
+typedef std::pair<big_int, big_int> MaskedValue;
+
+/// Split the interval [low, high] of a @width bit field into the
+/// minimal list of prefixes covering it.
+void rangeToMaskedValues(big_int low, big_int high, unsigned width,
+                         std::vector<MaskedValue>& result) {
+    big_int all = Util::mask(width);
+    while (low <= high) {
+        // grow the block while low stays aligned to it and it fits in the range
+        unsigned bits = 0;
+        while (bits < width && (low & Util::mask(bits + 1)) == 0 &&
+               low + Util::mask(bits + 1) <= high)
+            bits++;
+        result.emplace_back(low, all ^ Util::mask(bits));
+        low += Util::mask(bits) + 1;
+    }
+}
 }  // namespace
 
 ////////////////////////////////////////////////////////////////
@@ -75,6 +108,62 @@ EBPFTable::EBPFTable(const EBPFProgram* program, const IR::TableBlock* table,
 
     keyGenerator = table->container->getKey();
     actionList = table->container->getActionList();
+
+    isTernary = false;
+    if (keyGenerator != nullptr) {
+        for (auto it : keyGenerator->keyElements) {
+            cstring matchType = matchTypeName(it);
+            if (matchType == P4::P4CoreLibrary::instance.ternaryMatch.name ||
+                matchType == program->model.rangeMatch.name)
+                isTernary = true;
+        }
+    }
+    lpmKey = nullptr;
+    lpmPrefixBase = 0;
+    lpmKeyWidth = 0;
+    if (keyGenerator != nullptr && !isTernary) {
+        for (auto it : keyGenerator->keyElements) {
+            if (matchTypeName(it) == P4::P4CoreLibrary::instance.lpmMatch.name) {
+                lpmKey = it;
+                break;
+            }
+        }
+    }
+    if (isTernary) {
+        masksMapName = program->refMap->newName(instanceName + "_masks");
+        maskTypeName = program->refMap->newName(instanceName + "_mask");
+        tupleKeyTypeName = program->refMap->newName(instanceName + "_tuple_key");
+        entryTypeName = program->refMap->newName(instanceName + "_entry");
+        addTernaryName = program->refMap->newName(instanceName + "_add_ternary");
+    }
+
+    isDirect = keyGenerator != nullptr && !isTernary && !keyGenerator->keyElements.empty();
+    directKeyWidth = 0;
+    if (isDirect) {
+        for (auto it : keyGenerator->keyElements) {
+            auto type = EBPFTypeFactory::instance->create(
+                program->typeMap->getType(it->expression));
+            if (matchTypeName(it) != P4::P4CoreLibrary::instance.exactMatch.name ||
+                !type->is<IHasWidth>()) {
+                isDirect = false;
+                break;
+            }
+            directKeyWidth += type->to<IHasWidth>()->widthInBits();
+        }
+        if (directKeyWidth > maxDirectKeyWidth)
+            isDirect = false;
+    }
+    if (isDirect) {
+        entryTypeName = program->refMap->newName(instanceName + "_entry");
+        indexName = program->refMap->newName(instanceName + "_index");
+    }
+    if (keyGenerator != nullptr && !isTernary)
+        addName = program->refMap->newName(instanceName + "_add");
+}
+
+cstring EBPFTable::matchTypeName(const IR::KeyElement* element) const {
+    auto mtdecl = program->refMap->getDeclaration(element->matchType->path, true);
+    return mtdecl->getNode()->to<IR::Declaration_ID>()->name.name;
 }
 
 void EBPFTable::emitKeyType(CodeBuilder* builder) {
@@ -99,16 +188,21 @@ void EBPFTable::emitKeyType(CodeBuilder* builder) {
                 return;
             }
             unsigned width = ebpfType->to<IHasWidth>()->widthInBits();
-            ordered.emplace(width, c);
+            if (c != lpmKey)
+                ordered.emplace(width, c);
             keyTypes.emplace(c, ebpfType);
             keyFieldNames.emplace(c, fieldName);
             fieldNumber++;
         }
 
-        // Emit key in decreasing order size - this way there will be no gaps
-        for (auto it = ordered.rbegin(); it != ordered.rend(); ++it) {
-            auto c = it->second;
-
+        // Offset in bytes of the next field in the structure
+        unsigned offset = 0;
+        if (lpmKey != nullptr) {
+            builder->emitIndent();
+            builder->appendLine("u32 prefixlen;");
+            offset = 4;
+        }
+        auto emitField = [&](const IR::KeyElement* c) {
             auto ebpfType = ::get(keyTypes, c);
             builder->emitIndent();
             cstring fieldName = ::get(keyFieldNames, c);
@@ -118,13 +212,37 @@ void EBPFTable::emitKeyType(CodeBuilder* builder) {
             builder->append(" */");
             builder->newline();
 
-            auto mtdecl = program->refMap->getDeclaration(c->matchType->path, true);
-            auto matchType = mtdecl->getNode()->to<IR::Declaration_ID>();
-            if (matchType->name.name != P4::P4CoreLibrary::instance.exactMatch.name &&
-                matchType->name.name != P4::P4CoreLibrary::instance.lpmMatch.name)
+            unsigned size, align;
+            keyFieldLayout(ebpfType, size, align);
+            offset = ROUNDUP(offset, align) * align;
+            if (c == lpmKey) {
+                // Scalars are right-aligned in their bytes once swapped;
+                // wide fields are left-aligned.
+                unsigned width = ebpfType->to<IHasWidth>()->widthInBits();
+                unsigned padding = 0;
+                auto scalar = ebpfType->to<EBPFScalarType>();
+                if (scalar == nullptr || EBPFScalarType::generatesScalar(scalar->width))
+                    padding = size * 8 - width;
+                lpmPrefixBase = (offset - 4) * 8 + padding;
+                lpmKeyWidth = (offset - 4 + size) * 8;
+            }
+            offset += size;
+
+            cstring matchType = matchTypeName(c);
+            if (matchType != P4::P4CoreLibrary::instance.exactMatch.name &&
+                matchType != P4::P4CoreLibrary::instance.lpmMatch.name &&
+                matchType != P4::P4CoreLibrary::instance.ternaryMatch.name &&
+                matchType != program->model.rangeMatch.name)
                 ::error(ErrorType::ERR_UNSUPPORTED,
                         "Match of type %1% not supported", c->matchType);
-        }
+        };
+
+        // Emit key in decreasing order size - this way there will be no gaps;
+        // the lpm field comes last.
+        for (auto it = ordered.rbegin(); it != ordered.rend(); ++it)
+            emitField(it->second);
+        if (lpmKey != nullptr)
+            emitField(lpmKey);
     }
 
     builder->blockEnd(false);
@@ -201,6 +319,267 @@ void EBPFTable::emitValueType(CodeBuilder* builder) {
 void EBPFTable::emitTypes(CodeBuilder* builder) {
     emitKeyType(builder);
     emitValueType(builder);
+    // The test harness picks the control-plane function from the kind.
+    if (keyGenerator != nullptr) {
+        builder->appendFormat("#define %s_MATCH_KIND \"%s\"", instanceName.c_str(),
+                              isTernary ? "ternary" : lpmKey != nullptr ? "lpm" : "exact");
+        builder->newline();
+        if (lpmKey != nullptr) {
+            builder->appendFormat("#define %s_LPM_WIDTH %u", instanceName.c_str(),
+                                  ::get(keyTypes, lpmKey)->to<IHasWidth>()->widthInBits());
+            builder->newline();
+        }
+    }
+    if (isTernary)
+        emitTernaryTypes(builder);
+    else if (isDirect)
+        emitDirectTypes(builder);
+    if (!addName.isNullOrEmpty())
+        emitAddFunction(builder);
+}
+
+void EBPFTable::emitDirectTypes(CodeBuilder* builder) {
+    builder->emitIndent();
+    builder->appendFormat("struct %s ", entryTypeName.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendLine("u8 valid; /* 0 if the index has no entry */");
+    builder->emitIndent();
+    builder->appendFormat("struct %s value;", valueTypeName.c_str());
+    builder->newline();
+    builder->blockEnd(false);
+    builder->endOfStatement(true);
+
+    // The index concatenates the key fields, the first one in the most
+    // significant bits.
+    builder->appendFormat("static inline u32 %s(const struct %s *key) ",
+                          indexName.c_str(), keyTypeName.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    builder->append("return ");
+    unsigned shift = directKeyWidth;
+    bool first = true;
+    for (auto it : keyGenerator->keyElements) {
+        unsigned width = ::get(keyTypes, it)->to<IHasWidth>()->widthInBits();
+        shift -= width;
+        if (!first) {
+            builder->append(" |");
+            builder->newline();
+            builder->emitIndent();
+            builder->append("    ");
+        }
+        builder->appendFormat("(((u32)key->%s & 0x%x) << %u)",
+                              ::get(keyFieldNames, it).c_str(), (1u << width) - 1, shift);
+        first = false;
+    }
+    builder->endOfStatement(true);
+    builder->blockEnd(true);
+}
+
+void EBPFTable::emitAddFunction(CodeBuilder* builder) {
+    builder->appendLine("#if CONTROL_PLANE");
+    builder->appendFormat("static inline int %s(struct %s *key, struct %s *value) ",
+                          addName.c_str(), keyTypeName.c_str(), valueTypeName.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendFormat("int fd = BPF_OBJ_GET(MAP_PATH \"/%s\");", dataMapName.c_str());
+    builder->newline();
+    builder->emitIndent();
+    builder->appendLine("if (fd < 0)");
+    builder->emitIndent();
+    builder->appendLine("    return fd;");
+    if (lpmKey != nullptr) {
+        // The caller gives the prefix length of the lpm field, and the
+        // fields in host byte order.
+        builder->emitIndent();
+        builder->appendFormat("struct %s lpm_key = *key;", keyTypeName.c_str());
+        builder->newline();
+        builder->emitIndent();
+        builder->appendFormat("lpm_key.prefixlen = key->prefixlen + %u;", lpmPrefixBase);
+        builder->newline();
+        emitLPMFieldSwap(builder, "lpm_key", false);
+        builder->emitIndent();
+        builder->appendLine("return BPF_USER_MAP_UPDATE_ELEM(fd, &lpm_key, value, BPF_ANY);");
+    } else if (isDirect) {
+        builder->emitIndent();
+        builder->appendFormat("u32 index = %s(key);", indexName.c_str());
+        builder->newline();
+        builder->emitIndent();
+        builder->appendFormat("struct %s entry = {};", entryTypeName.c_str());
+        builder->newline();
+        builder->emitIndent();
+        builder->appendLine("entry.valid = 1;");
+        builder->emitIndent();
+        builder->appendLine("entry.value = *value;");
+        builder->emitIndent();
+        builder->appendLine("return BPF_USER_MAP_UPDATE_ELEM(fd, &index, &entry, BPF_ANY);");
+    } else {
+        builder->emitIndent();
+        builder->appendLine("return BPF_USER_MAP_UPDATE_ELEM(fd, key, value, BPF_ANY);");
+    }
+    builder->blockEnd(true);
+    builder->appendLine("#endif");
+}
+
+void EBPFTable::emitTernaryTypes(CodeBuilder* builder) {
+    builder->emitIndent();
+    builder->appendFormat("struct %s ", maskTypeName.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendLine("u32 tuple_id;");
+    builder->emitIndent();
+    builder->appendLine("u32 max_priority; /* highest priority of its entries, 0 if unused */");
+    builder->emitIndent();
+    builder->appendFormat("struct %s mask;", keyTypeName.c_str());
+    builder->newline();
+    builder->blockEnd(false);
+    builder->endOfStatement(true);
+
+    builder->emitIndent();
+    builder->appendFormat("struct %s ", tupleKeyTypeName.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendLine("u32 tuple_id;");
+    builder->emitIndent();
+    builder->appendFormat("struct %s key; /* masked */", keyTypeName.c_str());
+    builder->newline();
+    builder->blockEnd(false);
+    builder->endOfStatement(true);
+
+    builder->emitIndent();
+    builder->appendFormat("struct %s ", entryTypeName.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendLine("u32 priority; /* higher wins */");
+    builder->emitIndent();
+    builder->appendFormat("struct %s value;", valueTypeName.c_str());
+    builder->newline();
+    builder->blockEnd(false);
+    builder->endOfStatement(true);
+
+    // The control plane keeps its own copy of the masks, so that it only
+    // ever writes to the maps.
+    cstring key = keyTypeName;
+    builder->appendLine("#if CONTROL_PLANE");
+    builder->appendFormat("static inline int %s(struct %s *key, struct %s *mask, "
+                          "u32 priority, struct %s *value) ",
+                          addTernaryName.c_str(), key.c_str(), key.c_str(),
+                          valueTypeName.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendFormat("static struct %s masks[%d];", maskTypeName.c_str(), maxTernaryMasks);
+    builder->newline();
+    builder->emitIndent();
+    builder->appendLine("static u32 count = 0;");
+    builder->emitIndent();
+    builder->appendFormat("struct %s tuple = {};", tupleKeyTypeName.c_str());
+    builder->newline();
+    builder->emitIndent();
+    builder->appendFormat("struct %s entry = {}, existing;", entryTypeName.c_str());
+    builder->newline();
+    builder->emitIndent();
+    builder->appendLine("u32 i, j;");
+    builder->emitIndent();
+    builder->appendLine("int fd, ok;");
+    builder->emitIndent();
+    builder->appendLine("if (priority == 0)");
+    builder->emitIndent();
+    builder->appendLine("    return -1;");
+    builder->emitIndent();
+    builder->appendLine("for (i = 0; i < count; i++)");
+    builder->emitIndent();
+    builder->appendLine("    if (memcmp(&masks[i].mask, mask, sizeof(*mask)) == 0)");
+    builder->emitIndent();
+    builder->appendLine("        break;");
+    builder->emitIndent();
+    builder->append("if (i == count) ");
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendFormat("if (count == %d)", maxTernaryMasks);
+    builder->newline();
+    builder->emitIndent();
+    builder->appendLine("    return -1;");
+    builder->emitIndent();
+    builder->appendLine("masks[i].tuple_id = count++;");
+    builder->emitIndent();
+    builder->appendLine("masks[i].max_priority = 0;");
+    builder->emitIndent();
+    builder->appendLine("masks[i].mask = *mask;");
+    builder->blockEnd(true);
+    builder->emitIndent();
+    builder->appendLine("tuple.tuple_id = masks[i].tuple_id;");
+    builder->emitIndent();
+    builder->appendLine("for (j = 0; j < sizeof(*key); j++)");
+    builder->emitIndent();
+    builder->appendLine("    ((u8 *)&tuple.key)[j] = ((u8 *)key)[j] & ((u8 *)mask)[j];");
+    builder->emitIndent();
+    builder->appendLine("entry.priority = priority;");
+    builder->emitIndent();
+    builder->appendLine("entry.value = *value;");
+    builder->emitIndent();
+    builder->appendFormat("fd = BPF_OBJ_GET(MAP_PATH \"/%s\");", dataMapName.c_str());
+    builder->newline();
+    builder->emitIndent();
+    builder->appendLine("if (fd < 0)");
+    builder->emitIndent();
+    builder->appendLine("    return fd;");
+    // Entries with the same mask and masked key share an element of the
+    // data map; as in P4, the earlier entry, added with a higher priority,
+    // wins.
+    builder->emitIndent();
+    builder->appendLine("if (BPF_USER_MAP_LOOKUP_ELEM(fd, &tuple, &existing) == 0 &&");
+    builder->emitIndent();
+    builder->appendLine("    existing.priority >= priority)");
+    builder->emitIndent();
+    builder->appendLine("    return 0;");
+    builder->emitIndent();
+    builder->appendLine("ok = BPF_USER_MAP_UPDATE_ELEM(fd, &tuple, &entry, BPF_ANY);");
+    builder->emitIndent();
+    builder->appendLine("if (ok != 0)");
+    builder->emitIndent();
+    builder->appendLine("    return ok;");
+    builder->emitIndent();
+    builder->append("if (priority > masks[i].max_priority) ");
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendFormat("struct %s moved;", maskTypeName.c_str());
+    builder->newline();
+    builder->emitIndent();
+    builder->appendLine("masks[i].max_priority = priority;");
+    builder->emitIndent();
+    builder->appendLine("/* keep the masks sorted by decreasing maximum priority */");
+    builder->emitIndent();
+    builder->append("for (; i > 0 && masks[i - 1].max_priority < masks[i].max_priority; i--) ");
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendLine("moved = masks[i - 1];");
+    builder->emitIndent();
+    builder->appendLine("masks[i - 1] = masks[i];");
+    builder->emitIndent();
+    builder->appendLine("masks[i] = moved;");
+    builder->blockEnd(true);
+    builder->blockEnd(true);
+    builder->emitIndent();
+    builder->appendFormat("fd = BPF_OBJ_GET(MAP_PATH \"/%s\");", masksMapName.c_str());
+    builder->newline();
+    builder->emitIndent();
+    builder->appendLine("if (fd < 0)");
+    builder->emitIndent();
+    builder->appendLine("    return fd;");
+    builder->emitIndent();
+    builder->append("for (j = 0; j < count; j++) ");
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendLine("ok = BPF_USER_MAP_UPDATE_ELEM(fd, &j, &masks[j], BPF_ANY);");
+    builder->emitIndent();
+    builder->appendLine("if (ok != 0)");
+    builder->emitIndent();
+    builder->appendLine("    return ok;");
+    builder->blockEnd(true);
+    builder->emitIndent();
+    builder->appendLine("return 0;");
+    builder->blockEnd(true);
+    builder->appendLine("#endif");
 }
 
 void EBPFTable::emitInstance(CodeBuilder* builder) {
@@ -247,11 +626,11 @@ void EBPFTable::emitInstance(CodeBuilder* builder) {
             return;
         }
 
-        // If any key field is LPM we will generate an LPM table
+        // If any key field is LPM we will generate an LPM table;
+        // ternary tables match LPM fields with a mask instead.
         for (auto it : keyGenerator->keyElements) {
-            auto mtdecl = program->refMap->getDeclaration(it->matchType->path, true);
-            auto matchType = mtdecl->getNode()->to<IR::Declaration_ID>();
-            if (matchType->name.name == P4::P4CoreLibrary::instance.lpmMatch.name) {
+            if (!isTernary &&
+                matchTypeName(it) == P4::P4CoreLibrary::instance.lpmMatch.name) {
                 if (tableKind == TableLPMTrie) {
                     ::error(ErrorType::ERR_UNSUPPORTED,
                             "%1%: only one LPM field allowed", it->matchType);
@@ -279,9 +658,23 @@ void EBPFTable::emitInstance(CodeBuilder* builder) {
         }
 
         cstring name = EBPFObject::externalName(table->container);
-        builder->target->emitTableDecl(builder, name, tableKind,
-                                       cstring("struct ") + keyTypeName,
-                                       cstring("struct ") + valueTypeName, size);
+        if (isTernary) {
+            builder->target->emitTableDecl(builder, name, TableHash,
+                                           cstring("struct ") + tupleKeyTypeName,
+                                           cstring("struct ") + entryTypeName, size);
+            builder->target->emitTableDecl(builder, masksMapName, TableArray,
+                                           program->arrayIndexType,
+                                           cstring("struct ") + maskTypeName, maxTernaryMasks);
+        } else if (isDirect) {
+            builder->target->emitTableDecl(builder, name, TableArray,
+                                           program->arrayIndexType,
+                                           cstring("struct ") + entryTypeName,
+                                           1u << directKeyWidth);
+        } else {
+            builder->target->emitTableDecl(builder, name, tableKind,
+                                           cstring("struct ") + keyTypeName,
+                                           cstring("struct ") + valueTypeName, size);
+        }
     }
     builder->target->emitTableDecl(builder, defaultActionMapName, TableArray,
                                    program->arrayIndexType,
@@ -315,6 +708,146 @@ void EBPFTable::emitKey(CodeBuilder* builder, cstring keyName) {
         }
         builder->endOfStatement(true);
     }
+    if (lpmKey != nullptr) {
+        builder->emitIndent();
+        builder->appendFormat("%s.prefixlen = %u", keyName.c_str(), lpmKeyWidth);
+        builder->endOfStatement(true);
+        emitLPMFieldSwap(builder, keyName, false);
+    }
+}
+
+void EBPFTable::emitLPMFieldSwap(CodeBuilder* builder, cstring keyName, bool isPointer) {
+    // Wide fields are already stored in network byte order.
+    auto scalar = ::get(keyTypes, lpmKey)->to<EBPFScalarType>();
+    if (scalar == nullptr || !EBPFScalarType::generatesScalar(scalar->width))
+        return;
+    cstring swap;
+    switch (scalar->alignment()) {
+        case 2: swap = "bpf_htons"; break;
+        case 4: swap = "bpf_htonl"; break;
+        case 8: swap = "bpf_cpu_to_be64"; break;
+        default: return;
+    }
+    cstring field = keyName + (isPointer ? "->" : ".") + ::get(keyFieldNames, lpmKey);
+    builder->emitIndent();
+    builder->appendFormat("%s = %s(%s)", field.c_str(), swap.c_str(), field.c_str());
+    builder->endOfStatement(true);
+}
+
+void EBPFTable::emitLookup(CodeBuilder* builder, cstring keyName, cstring valueName) {
+    if (isDirect) {
+        cstring index = "index";
+        cstring entry = "entry";
+        builder->emitIndent();
+        builder->blockStart();
+        builder->emitIndent();
+        builder->appendFormat("u32 %s = %s(&%s)", index.c_str(), indexName.c_str(),
+                              keyName.c_str());
+        builder->endOfStatement(true);
+        builder->emitIndent();
+        builder->appendFormat("struct %s *%s = NULL", entryTypeName.c_str(), entry.c_str());
+        builder->endOfStatement(true);
+        builder->emitIndent();
+        builder->target->emitTableLookup(builder, dataMapName, index, entry);
+        builder->endOfStatement(true);
+        builder->emitIndent();
+        builder->appendFormat("if (%s != NULL && %s->valid)", entry.c_str(), entry.c_str());
+        builder->newline();
+        builder->increaseIndent();
+        builder->emitIndent();
+        builder->appendFormat("%s = &%s->value", valueName.c_str(), entry.c_str());
+        builder->endOfStatement(true);
+        builder->decreaseIndent();
+        builder->blockEnd(true);
+        return;
+    }
+    if (!isTernary) {
+        builder->emitIndent();
+        builder->target->emitTableLookup(builder, dataMapName, keyName, valueName);
+        builder->endOfStatement(true);
+        return;
+    }
+
+    // Tuple-space search: probe one masked key per mask, in order of
+    // decreasing maximum priority, and stop as soon as no remaining mask
+    // can hold an entry better than the best match found so far.
+    cstring mask = "mask";
+    cstring entry = "entry";
+    cstring tuple = "tuple";
+    cstring best = "best_priority";
+    builder->emitIndent();
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendFormat("struct %s *%s = NULL", maskTypeName.c_str(), mask.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendFormat("struct %s *%s = NULL", entryTypeName.c_str(), entry.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendFormat("struct %s %s = {}", tupleKeyTypeName.c_str(), tuple.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendFormat("u32 %s = 0", best.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendFormat("for (u32 i = 0; i < %d; i++) ", maxTernaryMasks);
+    builder->blockStart();
+
+    builder->emitIndent();
+    builder->target->emitTableLookup(builder, masksMapName, "i", mask);
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendFormat("if (%s == NULL || %s->max_priority <= %s)",
+                          mask.c_str(), mask.c_str(), best.c_str());
+    builder->newline();
+    builder->increaseIndent();
+    builder->emitIndent();
+    builder->appendLine("break;");
+    builder->decreaseIndent();
+
+    builder->emitIndent();
+    builder->appendFormat("%s.tuple_id = %s->tuple_id", tuple.c_str(), mask.c_str());
+    builder->endOfStatement(true);
+    for (auto c : keyGenerator->keyElements) {
+        auto ebpfType = ::get(keyTypes, c);
+        cstring fieldName = ::get(keyFieldNames, c);
+        builder->emitIndent();
+        auto scalar = ebpfType->to<EBPFScalarType>();
+        if (scalar != nullptr &&
+            !EBPFScalarType::generatesScalar(scalar->implementationWidthInBits())) {
+            builder->appendFormat("for (u32 j = 0; j < %d; j++)", scalar->bytesRequired());
+            builder->newline();
+            builder->increaseIndent();
+            builder->emitIndent();
+            builder->appendFormat("%s.key.%s[j] = %s.%s[j] & %s->mask.%s[j]",
+                                  tuple.c_str(), fieldName.c_str(), keyName.c_str(),
+                                  fieldName.c_str(), mask.c_str(), fieldName.c_str());
+            builder->decreaseIndent();
+        } else {
+            builder->appendFormat("%s.key.%s = %s.%s & %s->mask.%s",
+                                  tuple.c_str(), fieldName.c_str(), keyName.c_str(),
+                                  fieldName.c_str(), mask.c_str(), fieldName.c_str());
+        }
+        builder->endOfStatement(true);
+    }
+
+    builder->emitIndent();
+    builder->target->emitTableLookup(builder, dataMapName, tuple, entry);
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendFormat("if (%s != NULL && %s->priority > %s) ",
+                          entry.c_str(), entry.c_str(), best.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendFormat("%s = &%s->value", valueName.c_str(), entry.c_str());
+    builder->endOfStatement(true);
+    builder->emitIndent();
+    builder->appendFormat("%s = %s->priority", best.c_str(), entry.c_str());
+    builder->endOfStatement(true);
+    builder->blockEnd(true);
+
+    builder->blockEnd(true);  // for
+    builder->blockEnd(true);
 }
 
 void EBPFTable::emitAction(CodeBuilder* builder, cstring valueName) {
@@ -329,6 +862,8 @@ void EBPFTable::emitAction(CodeBuilder* builder, cstring valueName) {
         cstring name = EBPFObject::externalName(action);
         builder->appendFormat("case %s: ", name.c_str());
         builder->newline();
+        if (program->profile != nullptr)
+            program->profile->emitProbe(builder, ProfileCounters::action(instanceName, name));
         builder->emitIndent();
 
         ActionTranslationVisitor visitor(valueName, program);
@@ -427,16 +962,22 @@ void EBPFTable::emitInitializer(CodeBuilder* builder) {
                           fd.c_str(), dataMapName.c_str());
     builder->newline();
 
+    // Earlier entries take precedence in ternary tables.
+    unsigned priority = entries->size();
     for (auto e : entries->entries) {
         builder->emitIndent();
         builder->blockStart();
 
         auto entryAction = e->getAction();
-        builder->emitIndent();
-        builder->appendFormat("struct %s %s = {", keyTypeName.c_str(), key.c_str());
-        e->getKeys()->apply(cg);
-        builder->append("}");
-        builder->endOfStatement(true);
+        if (lpmKey != nullptr) {
+            emitLPMEntryKey(builder, e, key);
+        } else if (!isTernary) {
+            builder->emitIndent();
+            builder->appendFormat("struct %s %s = {", keyTypeName.c_str(), key.c_str());
+            e->getKeys()->apply(cg);
+            builder->append("}");
+            builder->endOfStatement(true);
+        }
 
         BUG_CHECK(entryAction->is<IR::MethodCallExpression>(),
                   "%1%: expected an action call", defaultAction);
@@ -471,10 +1012,22 @@ void EBPFTable::emitInitializer(CodeBuilder* builder) {
         builder->blockEnd(false);
         builder->endOfStatement(true);
 
+        if (isTernary) {
+            emitTernaryEntry(builder, e, value, priority--);
+            builder->blockEnd(true);
+            continue;
+        }
+
         builder->emitIndent();
-        builder->append("int ok = ");
-        builder->target->emitUserTableUpdate(builder, fd, key, value);
-        builder->newline();
+        if (isDirect || lpmKey != nullptr) {
+            builder->appendFormat("int ok = %s(&%s, &%s)", addName.c_str(),
+                                  key.c_str(), value.c_str());
+            builder->endOfStatement(true);
+        } else {
+            builder->append("int ok = ");
+            builder->target->emitUserTableUpdate(builder, fd, key, value);
+            builder->newline();
+        }
 
         builder->emitIndent();
         builder->appendFormat("if (ok != 0) { "
@@ -486,11 +1039,160 @@ void EBPFTable::emitInitializer(CodeBuilder* builder) {
     builder->blockEnd(true);
 }
 
+void EBPFTable::emitTernaryEntry(CodeBuilder* builder, const IR::Entry* entry,
+                                 cstring valueName, unsigned priority) {
+    // Each key element matches a list of masked values (several for a
+    // range); the entry is inserted once per combination.
+    std::vector<std::vector<MaskedValue>> keyValues;
+    auto keys = entry->getKeys()->components;
+    for (size_t i = 0; i < keyGenerator->keyElements.size(); i++) {
+        auto element = keyGenerator->keyElements.at(i);
+        auto expr = keys.at(i);
+        unsigned width = ::get(keyTypes, element)->to<IHasWidth>()->widthInBits();
+        if (width > 64) {
+            ::error(ErrorType::ERR_UNSUPPORTED_ON_TARGET,
+                    "%1%: entries of ternary tables with keys wider than 64 bits", expr);
+            return;
+        }
+        big_int all = Util::mask(width);
+        std::vector<MaskedValue> values;
+        if (expr->is<IR::DefaultExpression>()) {
+            values.emplace_back(0, 0);
+        } else if (auto cst = expr->to<IR::Constant>()) {
+            values.emplace_back(cst->value & all, all);
+        } else if (auto b = expr->to<IR::BoolLiteral>()) {
+            values.emplace_back(b->value ? 1 : 0, all);
+        } else if (expr->is<IR::Mask>() && expr->to<IR::Mask>()->left->is<IR::Constant>() &&
+                   expr->to<IR::Mask>()->right->is<IR::Constant>()) {
+            auto mask = expr->to<IR::Mask>()->right->to<IR::Constant>()->value & all;
+            auto value = expr->to<IR::Mask>()->left->to<IR::Constant>()->value & mask;
+            values.emplace_back(value, mask);
+        } else if (expr->is<IR::Range>() && expr->to<IR::Range>()->left->is<IR::Constant>() &&
+                   expr->to<IR::Range>()->right->is<IR::Constant>()) {
+            rangeToMaskedValues(expr->to<IR::Range>()->left->to<IR::Constant>()->value & all,
+                                expr->to<IR::Range>()->right->to<IR::Constant>()->value & all,
+                                width, values);
+        } else {
+            ::error(ErrorType::ERR_UNSUPPORTED_ON_TARGET,
+                    "%1%: unsupported key expression in table entry", expr);
+            return;
+        }
+        keyValues.push_back(values);
+    }
+
+    std::vector<size_t> index(keyValues.size(), 0);
+    for (auto& v : keyValues)
+        if (v.empty())
+            return;  // empty range
+    while (true) {
+        builder->emitIndent();
+        builder->blockStart();
+        builder->emitIndent();
+        builder->appendFormat("struct %s key = {}", keyTypeName.c_str());
+        builder->endOfStatement(true);
+        builder->emitIndent();
+        builder->appendFormat("struct %s mask = {}", keyTypeName.c_str());
+        builder->endOfStatement(true);
+        for (size_t i = 0; i < keyValues.size(); i++) {
+            cstring fieldName = ::get(keyFieldNames, keyGenerator->keyElements.at(i));
+            auto& mv = keyValues.at(i).at(index.at(i));
+            builder->emitIndent();
+            builder->appendFormat("key.%s = %s", fieldName.c_str(),
+                                  Util::toString(mv.first, 0, false, 16).c_str());
+            builder->endOfStatement(true);
+            builder->emitIndent();
+            builder->appendFormat("mask.%s = %s", fieldName.c_str(),
+                                  Util::toString(mv.second, 0, false, 16).c_str());
+            builder->endOfStatement(true);
+        }
+        builder->emitIndent();
+        builder->appendFormat("int ok = %s(&key, &mask, %d, &%s)",
+                              addTernaryName.c_str(), priority, valueName.c_str());
+        builder->endOfStatement(true);
+        builder->emitIndent();
+        builder->appendFormat("if (ok != 0) { "
+                              "perror(\"Could not write in %s\"); exit(1); }",
+                              table->container->name.name.c_str());
+        builder->newline();
+        builder->blockEnd(true);
+
+        // next combination
+        size_t i = 0;
+        for (; i < index.size(); i++) {
+            if (++index.at(i) < keyValues.at(i).size())
+                break;
+            index.at(i) = 0;
+        }
+        if (i == index.size())
+            break;
+    }
+}
+
+void EBPFTable::emitLPMEntryKey(CodeBuilder* builder, const IR::Entry* entry,
+                                cstring keyName) {
+    builder->emitIndent();
+    builder->appendFormat("struct %s %s = {}", keyTypeName.c_str(), keyName.c_str());
+    builder->endOfStatement(true);
+    auto keys = entry->getKeys()->components;
+    for (size_t i = 0; i < keyGenerator->keyElements.size(); i++) {
+        auto element = keyGenerator->keyElements.at(i);
+        auto expr = keys.at(i);
+        unsigned width = ::get(keyTypes, element)->to<IHasWidth>()->widthInBits();
+        if (width > 64) {
+            ::error(ErrorType::ERR_UNSUPPORTED_ON_TARGET,
+                    "%1%: entries of LPM tables with keys wider than 64 bits", expr);
+            return;
+        }
+        big_int all = Util::mask(width);
+        big_int value;
+        unsigned prefixLength = width;
+        if (expr->is<IR::DefaultExpression>() && element == lpmKey) {
+            value = 0;
+            prefixLength = 0;
+        } else if (auto cst = expr->to<IR::Constant>()) {
+            value = cst->value & all;
+        } else if (auto b = expr->to<IR::BoolLiteral>()) {
+            value = b->value ? 1 : 0;
+        } else if (element == lpmKey && expr->is<IR::Mask>() &&
+                   expr->to<IR::Mask>()->left->is<IR::Constant>() &&
+                   expr->to<IR::Mask>()->right->is<IR::Constant>()) {
+            auto mask = expr->to<IR::Mask>()->right->to<IR::Constant>()->value & all;
+            value = expr->to<IR::Mask>()->left->to<IR::Constant>()->value & mask;
+            prefixLength = 0;
+            while (prefixLength < width && boost::multiprecision::bit_test(
+                       mask, width - 1 - prefixLength))
+                prefixLength++;
+            if (mask != (all ^ Util::mask(width - prefixLength))) {
+                ::error(ErrorType::ERR_INVALID, "%1%: the mask of an lpm key is not a prefix",
+                        expr);
+                return;
+            }
+        } else {
+            ::error(ErrorType::ERR_UNSUPPORTED_ON_TARGET,
+                    "%1%: unsupported key expression in table entry", expr);
+            return;
+        }
+        builder->emitIndent();
+        builder->appendFormat("%s.%s = %s", keyName.c_str(),
+                              ::get(keyFieldNames, element).c_str(),
+                              Util::toString(value, 0, false, 16).c_str());
+        builder->endOfStatement(true);
+        if (element == lpmKey) {
+            builder->emitIndent();
+            builder->appendFormat("%s.prefixlen = %u", keyName.c_str(), prefixLength);
+            builder->endOfStatement(true);
+        }
+    }
+}
+
 ////////////////////////////////////////////////////////////////
 
 EBPFCounterTable::EBPFCounterTable(const EBPFProgram* program, const IR::ExternBlock* block,
                                    cstring name, CodeGenInspector* codeGen) :
         EBPFTableBase(program, name, codeGen) {
+    isPerCPU = program->options.emitPerCPUCounters;
+    if (isPerCPU)
+        readName = program->refMap->newName(name + "_read");
     auto sz = block->getParameterValue(program->model.counterArray.max_index.name);
     if (sz == nullptr || !sz->is<IR::Constant>()) {
         ::error(ErrorType::ERR_INVALID,
@@ -521,7 +1223,11 @@ EBPFCounterTable::EBPFCounterTable(const EBPFProgram* program, const IR::ExternB
 }
 
 void EBPFCounterTable::emitInstance(CodeBuilder* builder) {
-    TableKind kind = isHash ? TableHash : TableArray;
+    TableKind kind;
+    if (isPerCPU)
+        kind = isHash ? TablePerCPUHash : TablePerCPUArray;
+    else
+        kind = isHash ? TableHash : TableArray;
     builder->target->emitTableDecl(
         builder, dataMapName, kind, keyTypeName, valueTypeName, size);
 }
@@ -559,14 +1265,7 @@ void EBPFCounterTable::emitCounterIncrement(CodeBuilder* builder,
     builder->target->emitTableLookup(builder, dataMapName, keyName, valueName);
     builder->endOfStatement(true);
 
-    builder->emitIndent();
-    builder->appendFormat("if (%s != NULL)", valueName.c_str());
-    builder->newline();
-    builder->increaseIndent();
-    builder->emitIndent();
-    builder->appendFormat("__sync_fetch_and_add(%s, 1);", valueName.c_str());
-    builder->newline();
-    builder->decreaseIndent();
+    emitIncrement(builder, valueName, "1");
 
     builder->emitIndent();
     builder->appendLine("else");
@@ -622,20 +1321,28 @@ void EBPFCounterTable::emitCounterAdd(CodeBuilder* builder,
     builder->target->emitTableLookup(builder, dataMapName, keyName, valueName);
     builder->endOfStatement(true);
 
+    emitIncrement(builder, valueName, incName);
+
     builder->emitIndent();
-    builder->appendFormat("if (%s != NULL)", valueName.c_str());
-    builder->newline();
+    builder->appendLine("else");
     builder->increaseIndent();
     builder->emitIndent();
-    builder->appendFormat("__sync_fetch_and_add(%s, %s);", valueName.c_str(), incName.c_str());
+    builder->target->emitTableUpdate(builder, dataMapName, keyName, "init_val");
     builder->newline();
     builder->decreaseIndent();
+}
 
+void EBPFCounterTable::emitIncrement(CodeBuilder* builder, cstring valueName, cstring inc) {
     builder->emitIndent();
-    builder->appendLine("else");
+    builder->appendFormat("if (%s != NULL)", valueName.c_str());
+    builder->newline();
     builder->increaseIndent();
     builder->emitIndent();
-    builder->target->emitTableUpdate(builder, dataMapName, keyName, "init_val");
+    // No other CPU writes to a per-CPU value
+    if (isPerCPU)
+        builder->appendFormat("*%s += %s;", valueName.c_str(), inc.c_str());
+    else
+        builder->appendFormat("__sync_fetch_and_add(%s, %s);", valueName.c_str(), inc.c_str());
     builder->newline();
     builder->decreaseIndent();
 }
@@ -663,6 +1370,26 @@ void EBPFCounterTable::emitTypes(CodeBuilder* builder) {
     builder->appendFormat("typedef %s %s",
                           EBPFModel::instance.counterValueType.c_str(), valueTypeName.c_str());
     builder->endOfStatement(true);
+    if (!isPerCPU)
+        return;
+
+    builder->appendLine("#if CONTROL_PLANE");
+    builder->appendFormat("static inline int %s(%s index, u64 *total) ",
+                          readName.c_str(), keyTypeName.c_str());
+    builder->blockStart();
+    builder->emitIndent();
+    builder->appendFormat("int fd = BPF_OBJ_GET(MAP_PATH \"/%s\");", dataMapName.c_str());
+    builder->newline();
+    builder->emitIndent();
+    builder->appendLine("if (fd < 0)");
+    builder->emitIndent();
+    builder->appendLine("    return fd;");
+    builder->emitIndent();
+    builder->appendFormat("return BPF_USER_MAP_LOOKUP_PERCPU_SUM(fd, &index, total, sizeof(%s));",
+                          valueTypeName.c_str());
+    builder->newline();
+    builder->blockEnd(true);
+    builder->appendLine("#endif");
 }
 
 }  // namespace EBPF
@@ -54,6 +54,43 @@ class EBPFTable final : public EBPFTableBase {
     std::map<const IR::KeyElement*, cstring> keyFieldNames;
     std::map<const IR::KeyElement*, EBPFType*> keyTypes;
 
+    /// Tables with a ternary or range key are implemented using tuple-space
+    /// search: the data map is a hash map keyed by (tuple id, masked key),
+    /// i.e. one logical hash table per distinct mask, and masksMapName is an
+    /// array of the masks sorted by decreasing maximum entry priority.
+    bool                  isTernary;
+    cstring               masksMapName;
+    cstring               maskTypeName;
+    cstring               tupleKeyTypeName;
+    cstring               entryTypeName;
+    /// Control-plane function inserting a (key, mask, priority, value) entry.
+    cstring               addTernaryName;
+    /// Upper bound on the distinct masks of a ternary table; also bounds
+    /// the lookup loop.
+    static const unsigned maxTernaryMasks = 128;
+
+    /// Exact tables whose concatenated key is at most maxDirectKeyWidth
+    /// bits wide are direct-indexed: the data map is an array indexed by
+    /// the concatenated key, and each element carries a validity bit.
+    bool                  isDirect;
+    unsigned              directKeyWidth;
+    /// Function computing the array index of a key of a direct table.
+    cstring               indexName;
+    static const unsigned maxDirectKeyWidth = 16;
+    /// Control-plane function inserting a (key, value) entry in a table
+    /// that is not ternary; it translates the key of direct and LPM tables.
+    cstring               addName;
+
+    /// The lpm field of a table which is not ternary, nullptr if none.  The
+    /// data map of such a table is an LPM trie: as the kernel requires, the
+    /// key starts with u32 prefixlen, the number of leading bits of the key
+    /// data to match, and the lpm field comes last, in network byte order.
+    const IR::KeyElement* lpmKey;
+    /// Bits of the key data before the first bit of the lpm field value.
+    unsigned              lpmPrefixBase;
+    /// Bits of the key data up to the end of the lpm field.
+    unsigned              lpmKeyWidth;
+
     EBPFTable(const EBPFProgram* program, const IR::TableBlock* table, CodeGenInspector* codeGen);
     void emitTypes(CodeBuilder* builder);
     void emitInstance(CodeBuilder* builder);
@@ -61,13 +98,36 @@ class EBPFTable final : public EBPFTableBase {
     void emitKeyType(CodeBuilder* builder);
     void emitValueType(CodeBuilder* builder);
     void emitKey(CodeBuilder* builder, cstring keyName);
+    /// Look up keyName in the table, leaving a pointer to the value (or NULL)
+    /// in valueName.
+    void emitLookup(CodeBuilder* builder, cstring keyName, cstring valueName);
     void emitAction(CodeBuilder* builder, cstring valueName);
     void emitInitializer(CodeBuilder* builder);
+
+ private:
+    cstring matchTypeName(const IR::KeyElement* element) const;
+    void emitTernaryTypes(CodeBuilder* builder);
+    void emitDirectTypes(CodeBuilder* builder);
+    void emitAddFunction(CodeBuilder* builder);
+    /// Convert the lpm field of keyName (a struct or a pointer to one) to
+    /// network byte order.
+    void emitLPMFieldSwap(CodeBuilder* builder, cstring keyName, bool isPointer);
+    void emitLPMEntryKey(CodeBuilder* builder, const IR::Entry* entry, cstring keyName);
+    void emitTernaryEntry(CodeBuilder* builder, const IR::Entry* entry,
+                          cstring valueName, unsigned priority);
 };
 
 class EBPFCounterTable final : public EBPFTableBase {
     size_t    size;
     bool      isHash;
+    /// With --emit-percpu-counters each CPU increments its own copy of the
+    /// counters without atomic operations; the control plane reads their
+    /// sum with readName.
+    bool      isPerCPU;
+    cstring   readName;
+
+    void emitIncrement(CodeBuilder* builder, cstring valueName, cstring inc);
+
  public:
     EBPFCounterTable(const EBPFProgram* program, const IR::ExternBlock* block,
                      cstring name, CodeGenInspector* codeGen);
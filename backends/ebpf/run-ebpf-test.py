@@ -51,6 +51,9 @@ PARSER.add_argument("-t", "--target", dest="target", default="test",
                     "default is test")
 PARSER.add_argument("-e", "--extern-file", dest="extern", default="",
                     help="Specify path additional file with C extern function definition")
+PARSER.add_argument("-a", dest="compiler_options", default=[], action="append",
+                    nargs="?", help="Pass this option string to the compiler; "
+                    "use -a=\"--compiler-arg\"")
 
 
 def import_from(module, name):
@@ -183,6 +186,8 @@ if __name__ == '__main__':
 
     # All args after '--' are intended for the p4 compiler
     argv = argv[1:]
+    for compiler_option in args.compiler_options:
+        argv.extend(compiler_option.split())
     # Run the test with the extracted options and modified argv
     result = run_test(options, argv)
     sys.exit(result)
@@ -47,10 +47,37 @@ limitations under the License.
  */
 #ifdef CONTROL_PLANE // BEGIN EBPF USER SPACE DEFINITIONS
 
+#include <string.h>  // memcpy()
 #include "bpf.h" // bpf_obj_get/pin, bpf_map_update_elem
+#include "libbpf.h" // libbpf_num_possible_cpus
+
+/* Sum the copies of an element of a per-CPU map over all the CPUs.
+ * The values are unsigned integers of at most 8 bytes; the kernel returns
+ * one value per possible CPU, each padded to 8 bytes. */
+static inline int bpf_user_map_lookup_percpu_sum(int fd, const void *key, __u64 *sum,
+                                                 unsigned int value_size) {
+    int ncpus = libbpf_num_possible_cpus();
+    if (ncpus <= 0 || value_size > 8)
+        return -1;
+    __u64 values[ncpus];
+    int ok = bpf_map_lookup_elem(fd, key, values);
+    if (ok != 0)
+        return ok;
+    *sum = 0;
+    for (int i = 0; i < ncpus; i++) {
+        __u64 value = 0;
+        memcpy(&value, &values[i], value_size);
+        *sum += value;
+    }
+    return 0;
+}
 
 #define BPF_USER_MAP_UPDATE_ELEM(index, key, value, flags)\
     bpf_map_update_elem(index, key, value, flags)
+#define BPF_USER_MAP_LOOKUP_ELEM(index, key, value)\
+    bpf_map_lookup_elem(index, key, value)
+#define BPF_USER_MAP_LOOKUP_PERCPU_SUM(index, key, sum, value_size)\
+    bpf_user_map_lookup_percpu_sum(index, key, sum, value_size)
 #define BPF_OBJ_PIN(table, name) bpf_obj_pin(table, name)
 #define BPF_OBJ_GET(name) bpf_obj_get(name)
 
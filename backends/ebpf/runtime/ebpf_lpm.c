@@ -0,0 +1,433 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/*
+Implementation of the userlevel longest-prefix-match map. Emulates the linux kernel
+BPF_MAP_TYPE_LPM_TRIE using a multibit trie with a stride of 8 bits.
+
+A prefix of length L is stored in the node at depth (L - 1) / 8, as an entry
+covering the remaining 1..8 bits of its last byte (the /0 prefix lives in the root).
+Each node keeps the list of its entries and derives a prefix-expanded leaf array
+from them: slot i holds the longest entry covering byte value i. Runs of equal
+slots are collapsed and located with a bit vector, as in poptrie.
+Also as in poptrie, the first two levels are bypassed by a direct-pointing array
+indexed by the first 16 bits of the key.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ebpf_lpm.h"
+
+#define LPM_STRIDE 8
+#define LPM_FANOUT (1 << LPM_STRIDE)
+#define LPM_VEC_WORDS (LPM_FANOUT / 64)
+#define LPM_DIRECT_BITS (2 * LPM_STRIDE)
+#define LPM_DIRECT_SIZE (1 << LPM_DIRECT_BITS)
+
+enum bpf_flags {
+    USER_BPF_ANY,  // create new element or update existing
+    USER_BPF_NOEXIST,  // create new element only if it didn't exist
+    USER_BPF_EXIST  // only update existing element
+};
+
+/* A prefix ending in a node, relative to the bytes consumed by its ancestors */
+struct bpf_lpm_entry {
+    uint8_t len;   // number of significant bits in this node's byte, 0..8
+    uint8_t bits;  // the byte, masked to len bits
+    void *value;
+};
+
+/* The best entry for a run of byte values in a node */
+struct bpf_lpm_leaf {
+    void *value;
+    uint32_t prefixlen;
+};
+
+/* The best prefix of up to 16 bits and the node at depth 2 for a 16-bit value */
+struct bpf_lpm_direct {
+    void *value;
+    struct bpf_lpm_node *node;
+};
+
+struct bpf_lpm_node {
+    uint64_t child_vec[LPM_VEC_WORDS];  // bit i is set if byte value i has a child
+    struct bpf_lpm_node **children;     // dense, in byte order
+    uint64_t leaf_vec[LPM_VEC_WORDS];   // bit i is set if a new run starts at i
+    struct bpf_lpm_leaf *leaves;        // dense, one per run
+    struct bpf_lpm_entry *entries;
+    unsigned int num_entries;
+    unsigned int depth;
+};
+
+static int check_flags(void *elem, unsigned long long map_flags) {
+    if (map_flags > USER_BPF_EXIST)
+        /* unknown flags */
+        return EXIT_FAILURE;
+    if (elem && map_flags == USER_BPF_NOEXIST)
+        /* elem already exists */
+        return EXIT_FAILURE;
+    if (!elem && map_flags == USER_BPF_EXIST)
+        /* elem doesn't exist, cannot update it */
+        return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
+
+static inline uint8_t prefix_mask(unsigned int len) {
+    return len == 0 ? 0 : (uint8_t) (0xff << (LPM_STRIDE - len));
+}
+
+static inline int vec_test(const uint64_t *vec, unsigned int i) {
+    return (vec[i / 64] >> (i % 64)) & 1;
+}
+
+/* Number of bits set in vec at positions <= i */
+static inline unsigned int vec_rank(const uint64_t *vec, unsigned int i) {
+    unsigned int word = i / 64;
+    unsigned int bit = i % 64;
+    unsigned int rank = 0;
+    for (unsigned int w = 0; w < word; w++)
+        rank += __builtin_popcountll(vec[w]);
+    uint64_t mask = bit == 63 ? ~0ULL : ((1ULL << (bit + 1)) - 1);
+    return rank + __builtin_popcountll(vec[word] & mask);
+}
+
+static unsigned int vec_count(const uint64_t *vec) {
+    unsigned int count = 0;
+    for (unsigned int w = 0; w < LPM_VEC_WORDS; w++)
+        count += __builtin_popcountll(vec[w]);
+    return count;
+}
+
+static struct bpf_lpm_node *node_alloc(unsigned int depth) {
+    struct bpf_lpm_node *node = calloc(1, sizeof(struct bpf_lpm_node));
+    if (!node) {
+        perror("Fatal: Could not allocate memory\n");
+        exit(EXIT_FAILURE);
+    }
+    node->depth = depth;
+    return node;
+}
+
+static struct bpf_lpm_node *node_child(const struct bpf_lpm_node *node, uint8_t byte) {
+    if (!vec_test(node->child_vec, byte))
+        return NULL;
+    return node->children[vec_rank(node->child_vec, byte) - 1];
+}
+
+static struct bpf_lpm_node *node_add_child(struct bpf_lpm_node *node, uint8_t byte) {
+    unsigned int count = vec_count(node->child_vec);
+    /* rank of the bits below byte, i.e. the insertion point */
+    unsigned int pos = byte == 0 ? 0 : vec_rank(node->child_vec, byte - 1);
+    node->children = realloc(node->children, (count + 1) * sizeof(struct bpf_lpm_node *));
+    if (!node->children) {
+        perror("Fatal: Could not allocate memory\n");
+        exit(EXIT_FAILURE);
+    }
+    memmove(&node->children[pos + 1], &node->children[pos],
+            (count - pos) * sizeof(struct bpf_lpm_node *));
+    struct bpf_lpm_node *child = node_alloc(node->depth + 1);
+    node->children[pos] = child;
+    node->child_vec[byte / 64] |= 1ULL << (byte % 64);
+    return child;
+}
+
+static void node_remove_child(struct bpf_lpm_node *node, uint8_t byte) {
+    unsigned int count = vec_count(node->child_vec);
+    unsigned int pos = vec_rank(node->child_vec, byte) - 1;
+    memmove(&node->children[pos], &node->children[pos + 1],
+            (count - pos - 1) * sizeof(struct bpf_lpm_node *));
+    node->child_vec[byte / 64] &= ~(1ULL << (byte % 64));
+    if (count == 1) {
+        free(node->children);
+        node->children = NULL;
+    }
+}
+
+static int node_is_empty(const struct bpf_lpm_node *node) {
+    return node->num_entries == 0 && node->children == NULL;
+}
+
+/* Recompute the prefix-expanded leaves of a node from its entries. */
+static void node_rebuild_leaves(struct bpf_lpm_node *node) {
+    struct bpf_lpm_leaf best[LPM_FANOUT];
+    memset(best, 0, sizeof(best));
+    for (unsigned int i = 0; i < node->num_entries; i++) {
+        struct bpf_lpm_entry *e = &node->entries[i];
+        uint32_t prefixlen = node->depth * LPM_STRIDE + e->len;
+        unsigned int end = e->bits + (1U << (LPM_STRIDE - e->len));
+        for (unsigned int s = e->bits; s < end; s++) {
+            if (best[s].value == NULL || best[s].prefixlen < prefixlen) {
+                best[s].value = e->value;
+                best[s].prefixlen = prefixlen;
+            }
+        }
+    }
+
+    free(node->leaves);
+    node->leaves = NULL;
+    memset(node->leaf_vec, 0, sizeof(node->leaf_vec));
+    if (node->num_entries == 0)
+        return;
+
+    unsigned int runs = 1;
+    for (unsigned int s = 1; s < LPM_FANOUT; s++)
+        if (best[s].value != best[s - 1].value)
+            runs++;
+    node->leaves = malloc(runs * sizeof(struct bpf_lpm_leaf));
+    if (!node->leaves) {
+        perror("Fatal: Could not allocate memory\n");
+        exit(EXIT_FAILURE);
+    }
+    unsigned int run = 0;
+    for (unsigned int s = 0; s < LPM_FANOUT; s++) {
+        if (s == 0 || best[s].value != best[s - 1].value) {
+            node->leaf_vec[s / 64] |= 1ULL << (s % 64);
+            node->leaves[run++] = best[s];
+        }
+    }
+}
+
+static struct bpf_lpm_entry *node_find_entry(struct bpf_lpm_node *node, uint8_t len, uint8_t bits) {
+    for (unsigned int i = 0; i < node->num_entries; i++)
+        if (node->entries[i].len == len && node->entries[i].bits == bits)
+            return &node->entries[i];
+    return NULL;
+}
+
+static void node_delete(struct bpf_lpm_node *node) {
+    unsigned int count = vec_count(node->child_vec);
+    for (unsigned int i = 0; i < count; i++)
+        node_delete(node->children[i]);
+    for (unsigned int i = 0; i < node->num_entries; i++)
+        free(node->entries[i].value);
+    free(node->children);
+    free(node->leaves);
+    free(node->entries);
+    free(node);
+}
+
+/* Recompute a direct-pointing entry from the first two levels of the trie. */
+static void direct_refresh(struct bpf_lpm_trie *trie, unsigned int index) {
+    struct bpf_lpm_direct *direct = &trie->direct[index];
+    uint8_t bytes[2] = { index >> LPM_STRIDE, index & (LPM_FANOUT - 1) };
+    struct bpf_lpm_node *node = trie->root;
+    direct->value = NULL;
+    for (unsigned int d = 0; d < 2 && node != NULL; d++) {
+        if (node->leaves != NULL) {
+            struct bpf_lpm_leaf *leaf = &node->leaves[vec_rank(node->leaf_vec, bytes[d]) - 1];
+            if (leaf->value != NULL)
+                direct->value = leaf->value;
+        }
+        node = node_child(node, bytes[d]);
+    }
+    direct->node = node;
+}
+
+/* Refresh the direct-pointing entries affected by a change to a prefix. */
+static void direct_update(struct bpf_lpm_trie *trie, const struct bpf_lpm_key *key) {
+    if (trie->direct == NULL)
+        return;
+    unsigned int index = (key->data[0] << LPM_STRIDE) | key->data[1];
+    unsigned int count = 1;
+    if (key->prefixlen < LPM_DIRECT_BITS) {
+        count = 1U << (LPM_DIRECT_BITS - key->prefixlen);
+        index &= ~(count - 1);
+    }
+    for (unsigned int i = index; i < index + count; i++)
+        direct_refresh(trie, i);
+}
+
+/* Split a prefix length into the depth of its node and the bits used there. */
+static void split_prefix(uint32_t prefixlen, unsigned int *depth, uint8_t *len) {
+    *depth = prefixlen == 0 ? 0 : (prefixlen - 1) / LPM_STRIDE;
+    *len = prefixlen - *depth * LPM_STRIDE;
+}
+
+int bpf_lpm_update_elem(struct bpf_lpm_trie **trie, void *key, unsigned int key_size,
+                        void *value, unsigned int value_size, unsigned long long flags) {
+    if (key_size <= sizeof(struct bpf_lpm_key))
+        return EXIT_FAILURE;
+    struct bpf_lpm_key *lpm_key = key;
+    unsigned int data_size = key_size - sizeof(struct bpf_lpm_key);
+    if (lpm_key->prefixlen > data_size * LPM_STRIDE)
+        return EXIT_FAILURE;
+    if (*trie == NULL) {
+        *trie = calloc(1, sizeof(struct bpf_lpm_trie));
+        if (!*trie) {
+            perror("Fatal: Could not allocate memory\n");
+            exit(EXIT_FAILURE);
+        }
+        (*trie)->root = node_alloc(0);
+        (*trie)->data_size = data_size;
+        (*trie)->value_size = value_size;
+        if (data_size * LPM_STRIDE >= LPM_DIRECT_BITS) {
+            (*trie)->direct = calloc(LPM_DIRECT_SIZE, sizeof(struct bpf_lpm_direct));
+            if (!(*trie)->direct) {
+                perror("Fatal: Could not allocate memory\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    unsigned int depth;
+    uint8_t len;
+    split_prefix(lpm_key->prefixlen, &depth, &len);
+    uint8_t bits = lpm_key->data[depth] & prefix_mask(len);
+
+    /* Find the node holding the prefix without creating the path yet,
+     * so that rejected updates leave no empty nodes behind. */
+    struct bpf_lpm_node *node = (*trie)->root;
+    for (unsigned int d = 0; d < depth && node != NULL; d++)
+        node = node_child(node, lpm_key->data[d]);
+    struct bpf_lpm_entry *entry = node ? node_find_entry(node, len, bits) : NULL;
+    int ret = check_flags(entry, flags);
+    if (ret)
+        return ret;
+    if (entry != NULL) {
+        /* Values are updated in place, pointers returned by lookups stay valid */
+        memcpy(entry->value, value, value_size);
+        return EXIT_SUCCESS;
+    }
+
+    node = (*trie)->root;
+    for (unsigned int d = 0; d < depth; d++) {
+        struct bpf_lpm_node *child = node_child(node, lpm_key->data[d]);
+        node = child ? child : node_add_child(node, lpm_key->data[d]);
+    }
+    node->entries = realloc(node->entries, (node->num_entries + 1) * sizeof(struct bpf_lpm_entry));
+    if (!node->entries) {
+        perror("Fatal: Could not allocate memory\n");
+        exit(EXIT_FAILURE);
+    }
+    entry = &node->entries[node->num_entries++];
+    entry->len = len;
+    entry->bits = bits;
+    entry->value = malloc(value_size);
+    if (!entry->value) {
+        perror("Fatal: Could not allocate memory\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(entry->value, value, value_size);
+    node_rebuild_leaves(node);
+    direct_update(*trie, lpm_key);
+    (*trie)->num_entries++;
+    return EXIT_SUCCESS;
+}
+
+void *bpf_lpm_lookup_elem(struct bpf_lpm_trie *trie, void *key, unsigned int key_size) {
+    if (trie == NULL || key_size <= sizeof(struct bpf_lpm_key))
+        return NULL;
+    struct bpf_lpm_key *lpm_key = key;
+    unsigned int data_size = key_size - sizeof(struct bpf_lpm_key);
+    uint32_t max_len = lpm_key->prefixlen;
+    if (max_len > data_size * LPM_STRIDE)
+        max_len = data_size * LPM_STRIDE;
+
+    void *best = NULL;
+    struct bpf_lpm_node *node = trie->root;
+    unsigned int d = 0;
+    if (trie->direct != NULL && max_len >= LPM_DIRECT_BITS) {
+        struct bpf_lpm_direct *direct =
+            &trie->direct[(lpm_key->data[0] << LPM_STRIDE) | lpm_key->data[1]];
+        best = direct->value;
+        if (max_len == LPM_DIRECT_BITS)
+            return best;
+        node = direct->node;
+        d = 2;
+    }
+    for (; node != NULL; d++) {
+        uint8_t byte = lpm_key->data[d];
+        if (max_len < (d + 1) * LPM_STRIDE) {
+            /* The key ends inside this byte: the expanded leaves may hold a
+             * prefix longer than the key, so fall back to the entry list. */
+            uint8_t max_bits = max_len - d * LPM_STRIDE;
+            int best_len = -1;
+            for (unsigned int i = 0; i < node->num_entries; i++) {
+                struct bpf_lpm_entry *e = &node->entries[i];
+                if (e->len <= max_bits && e->len > best_len &&
+                        (byte & prefix_mask(e->len)) == e->bits) {
+                    best = e->value;
+                    best_len = e->len;
+                }
+            }
+            break;
+        }
+        if (node->leaves != NULL) {
+            struct bpf_lpm_leaf *leaf = &node->leaves[vec_rank(node->leaf_vec, byte) - 1];
+            if (leaf->value != NULL)
+                best = leaf->value;
+        }
+        if (max_len == (d + 1) * LPM_STRIDE)
+            break;
+        node = node_child(node, byte);
+    }
+    return best;
+}
+
+/* Returns true if node became empty and can be removed by its parent. */
+static int node_delete_prefix(struct bpf_lpm_node *node, const uint8_t *data,
+                              unsigned int depth, uint8_t len, uint8_t bits, int *found) {
+    if (node->depth < depth) {
+        struct bpf_lpm_node *child = node_child(node, data[node->depth]);
+        if (child == NULL)
+            return 0;
+        if (node_delete_prefix(child, data, depth, len, bits, found)) {
+            node_remove_child(node, data[node->depth]);
+            free(child);
+        }
+        return node_is_empty(node);
+    }
+    struct bpf_lpm_entry *entry = node_find_entry(node, len, bits);
+    if (entry == NULL)
+        return 0;
+    free(entry->value);
+    *entry = node->entries[--node->num_entries];
+    if (node->num_entries == 0) {
+        free(node->entries);
+        node->entries = NULL;
+    }
+    node_rebuild_leaves(node);
+    *found = 1;
+    return node_is_empty(node);
+}
+
+int bpf_lpm_delete_elem(struct bpf_lpm_trie *trie, void *key, unsigned int key_size) {
+    if (trie == NULL || key_size <= sizeof(struct bpf_lpm_key))
+        return EXIT_SUCCESS;
+    struct bpf_lpm_key *lpm_key = key;
+    if (lpm_key->prefixlen > trie->data_size * LPM_STRIDE)
+        return EXIT_FAILURE;
+    unsigned int depth;
+    uint8_t len;
+    split_prefix(lpm_key->prefixlen, &depth, &len);
+    uint8_t bits = lpm_key->data[depth] & prefix_mask(len);
+    int found = 0;
+    /* The root is never freed, even when it becomes empty */
+    node_delete_prefix(trie->root, lpm_key->data, depth, len, bits, &found);
+    if (found) {
+        direct_update(trie, lpm_key);
+        trie->num_entries--;
+    }
+    return EXIT_SUCCESS;
+}
+
+int bpf_lpm_delete_trie(struct bpf_lpm_trie *trie) {
+    if (trie == NULL)
+        return EXIT_SUCCESS;
+    node_delete(trie->root);
+    free(trie->direct);
+    free(trie);
+    return EXIT_SUCCESS;
+}
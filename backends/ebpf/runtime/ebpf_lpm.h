@@ -0,0 +1,90 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/*
+ * This file defines a longest-prefix-match map which emulates the behavior of the
+ * kernel BPF_MAP_TYPE_LPM_TRIE. Keys use the kernel layout: a 32-bit prefix length
+ * in host byte order followed by the key data, which is matched most significant
+ * bit first. This library is currently not thread-safe.
+ */
+
+#ifndef BACKENDS_EBPF_RUNTIME_EBPF_LPM_H_
+#define BACKENDS_EBPF_RUNTIME_EBPF_LPM_H_
+
+#include <stdint.h>
+
+/* Mirrors struct bpf_lpm_trie_key from "linux/bpf.h" */
+struct bpf_lpm_key {
+    uint32_t prefixlen;  // up to (key_size - 4) * 8
+    uint8_t data[0];     // key data, network byte order
+};
+
+struct bpf_lpm_node;
+struct bpf_lpm_direct;
+
+/**
+ * @brief A multibit trie with poptrie-style compressed nodes.
+ * @details Every node consumes one byte of the key. The children and the
+ * prefix-expanded leaves of a node are stored in dense arrays which are
+ * indexed by counting the bits set in a 256-bit vector, so a lookup costs
+ * one popcount and one memory access per key byte. The first 16 bits of
+ * the key are resolved by a single direct-pointing array.
+ */
+struct bpf_lpm_trie {
+    struct bpf_lpm_node *root;
+    struct bpf_lpm_direct *direct;  // NULL for keys shorter than 16 bits
+    unsigned int data_size;    // key_size without the prefix length
+    unsigned int value_size;
+    unsigned int num_entries;
+};
+
+/**
+ * @brief Add/Update a value in the trie.
+ * @details Inserts the prefix described by key. Bits past the prefix length
+ * are ignored. If the prefix does not exist, it depends the provided flags
+ * if the element is added or the operation is rejected.
+ *
+ * @return EXIT_FAILURE if update operation fails
+ */
+int bpf_lpm_update_elem(struct bpf_lpm_trie **trie, void *key, unsigned int key_size,
+                        void *value, unsigned int value_size, unsigned long long flags);
+
+/**
+ * @brief Find the value of the longest prefix matching a key.
+ * @details Only prefixes no longer than the prefix length of the key
+ * are considered, as in the kernel.
+ *
+ * @return NULL if no prefix matches
+ */
+void *bpf_lpm_lookup_elem(struct bpf_lpm_trie *trie, void *key, unsigned int key_size);
+
+/**
+ * @brief Delete a prefix from the trie.
+ * @details Deletes exactly the prefix described by key; shorter
+ * prefixes covering it become visible again.
+ * If the prefix does not exist, no operation is performed.
+ *
+ * @return EXIT_FAILURE if operation fails.
+ */
+int bpf_lpm_delete_elem(struct bpf_lpm_trie *trie, void *key, unsigned int key_size);
+
+/**
+ * @brief Delete the entire trie at once.
+ * @details Deletes all the prefixes and frees all the values.
+ *
+ * @return EXIT_FAILURE if operation fails.
+ */
+int bpf_lpm_delete_trie(struct bpf_lpm_trie *trie);
+
+#endif  // BACKENDS_EBPF_RUNTIME_EBPF_LPM_H_
@@ -0,0 +1,181 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/*
+Lookup microbenchmark for the userlevel LPM trie. Inserts random IPv4 and IPv6
+prefixes with a routing-table-like length distribution, cross-checks a sample of
+lookups against a linear scan, and reports the lookup rate.
+Build with "make -f runtime.mk lpm_bench".
+Usage: lpm_bench [number of prefixes] [number of lookups]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ebpf_lpm.h"
+
+#define MAX_DATA_SIZE 16
+#define CHECK_SAMPLES 1000
+#define CHECK_PREFIXES 2000
+
+struct lpm_bench_key {
+    uint32_t prefixlen;
+    uint8_t data[MAX_DATA_SIZE];
+};
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+
+static uint64_t next_random() {
+    /* xorshift64*, deterministic across runs */
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545f4914f6cdd1dULL;
+}
+
+static void random_bytes(uint8_t *data, unsigned int size) {
+    for (unsigned int i = 0; i < size; i += 8) {
+        uint64_t r = next_random();
+        memcpy(data + i, &r, size - i < 8 ? size - i : 8);
+    }
+}
+
+/* Roughly the shape of a BGP table: mostly /24 (IPv4) or /48 (IPv6). */
+static uint32_t random_prefixlen(unsigned int data_size) {
+    unsigned int r = next_random() % 100;
+    if (data_size == 4)
+        return r < 60 ? 24 : 8 + next_random() % 25;
+    return r < 45 ? 48 : 16 + next_random() % 49;
+}
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int prefix_matches(const struct lpm_bench_key *prefix, const uint8_t *addr) {
+    uint32_t len = prefix->prefixlen;
+    unsigned int bytes = len / 8;
+    if (memcmp(prefix->data, addr, bytes) != 0)
+        return 0;
+    if (len % 8 == 0)
+        return 1;
+    uint8_t mask = 0xff << (8 - len % 8);
+    return (prefix->data[bytes] & mask) == (addr[bytes] & mask);
+}
+
+static int is_duplicate(const struct lpm_bench_key *prefixes, unsigned int count) {
+    const struct lpm_bench_key *prefix = &prefixes[count];
+    for (unsigned int i = 0; i < count; i++)
+        if (prefixes[i].prefixlen == prefix->prefixlen && prefix_matches(&prefixes[i], prefix->data))
+            return 1;
+    return 0;
+}
+
+/* Compare the trie against a linear scan over a small table. */
+static int check(unsigned int data_size) {
+    unsigned int key_size = sizeof(uint32_t) + data_size;
+    struct lpm_bench_key *prefixes = calloc(CHECK_PREFIXES, sizeof(struct lpm_bench_key));
+    uint32_t *values = calloc(CHECK_PREFIXES, sizeof(uint32_t));
+    struct bpf_lpm_trie *trie = NULL;
+    int errors = 0;
+
+    for (unsigned int i = 0; i < CHECK_PREFIXES; i++) {
+        /* prefixes out of a small pool, so that they nest; no duplicates */
+        do {
+            prefixes[i].prefixlen = next_random() % (data_size * 8 + 1);
+            random_bytes(prefixes[i].data, data_size);
+            prefixes[i].data[0] &= 0x3;
+        } while (is_duplicate(prefixes, i));
+        values[i] = i;
+        bpf_lpm_update_elem(&trie, &prefixes[i], key_size, &values[i], sizeof(uint32_t), 0);
+    }
+    /* delete every fourth prefix again */
+    for (unsigned int i = 0; i < CHECK_PREFIXES; i += 4)
+        bpf_lpm_delete_elem(trie, &prefixes[i], key_size);
+
+    for (unsigned int s = 0; s < CHECK_SAMPLES; s++) {
+        struct lpm_bench_key key = { .prefixlen = data_size * 8 };
+        const struct lpm_bench_key *base = &prefixes[next_random() % CHECK_PREFIXES];
+        memcpy(key.data, base->data, data_size);
+        key.data[data_size - 1] ^= next_random() & 0xff;
+
+        int best = -1;
+        for (unsigned int i = 0; i < CHECK_PREFIXES; i++) {
+            if (i % 4 == 0 || !prefix_matches(&prefixes[i], key.data))
+                continue;
+            if (best < 0 || prefixes[i].prefixlen > prefixes[best].prefixlen)
+                best = i;
+        }
+        uint32_t *value = bpf_lpm_lookup_elem(trie, &key, key_size);
+        uint32_t expected_len = best < 0 ? 0 : prefixes[best].prefixlen;
+        uint32_t found_len = value ? prefixes[*value].prefixlen : 0;
+        if ((value == NULL) != (best < 0) || found_len != expected_len)
+            errors++;
+    }
+    bpf_lpm_delete_trie(trie);
+    free(prefixes);
+    free(values);
+    return errors;
+}
+
+static void bench(unsigned int data_size, unsigned int num_prefixes, unsigned int num_lookups) {
+    unsigned int key_size = sizeof(uint32_t) + data_size;
+    struct bpf_lpm_trie *trie = NULL;
+    struct lpm_bench_key key;
+    uint32_t value = 0;
+
+    double start = now();
+    for (unsigned int i = 0; i < num_prefixes; i++) {
+        key.prefixlen = random_prefixlen(data_size);
+        random_bytes(key.data, data_size);
+        value = i;
+        bpf_lpm_update_elem(&trie, &key, key_size, &value, sizeof(value), 0);
+    }
+    double inserted = now();
+
+    struct lpm_bench_key *keys = malloc(num_lookups * sizeof(struct lpm_bench_key));
+    for (unsigned int i = 0; i < num_lookups; i++) {
+        keys[i].prefixlen = data_size * 8;
+        random_bytes(keys[i].data, data_size);
+    }
+    unsigned int hits = 0;
+    double lookup_start = now();
+    for (unsigned int i = 0; i < num_lookups; i++)
+        hits += bpf_lpm_lookup_elem(trie, &keys[i], key_size) != NULL;
+    double end = now();
+
+    printf("IPv%d: %u prefixes (%u unique) inserted in %.2f s, "
+           "%u lookups (%u hits) at %.2f Mlookups/s\n",
+           data_size == 4 ? 4 : 6, num_prefixes, trie->num_entries, inserted - start,
+           num_lookups, hits, num_lookups / (end - lookup_start) / 1e6);
+    free(keys);
+    bpf_lpm_delete_trie(trie);
+}
+
+int main(int argc, char **argv) {
+    unsigned int num_prefixes = argc > 1 ? strtoul(argv[1], NULL, 0) : 1000000;
+    unsigned int num_lookups = argc > 2 ? strtoul(argv[2], NULL, 0) : 10000000;
+
+    int errors = check(4) + check(16);
+    if (errors) {
+        fprintf(stderr, "Error: %d lookups disagree with the linear scan\n", errors);
+        return EXIT_FAILURE;
+    }
+    bench(4, num_prefixes, num_lookups);
+    bench(16, num_prefixes, num_lookups);
+    return EXIT_SUCCESS;
+}
@@ -66,6 +66,41 @@ int bpf_map_update_elem(struct bpf_map **map, void *key, unsigned int key_size,
     return EXIT_SUCCESS;
 }
 
+/* uthash keeps the elements in insertion order: moving an element to the
+ * end on every use leaves the least recently used one at the head. */
+static void touch_elem(struct bpf_map **map, struct bpf_map *elem) {
+    HASH_DEL(*map, elem);
+    HASH_ADD_KEYPTR(hh, *map, elem->key, elem->hh.keylen, elem);
+}
+
+void *bpf_map_lookup_lru_elem(struct bpf_map **map, void *key, unsigned int key_size) {
+    struct bpf_map *tmp_map;
+    HASH_FIND(hh, *map, key, key_size, tmp_map);
+    if (tmp_map == NULL)
+        return NULL;
+    touch_elem(map, tmp_map);
+    return tmp_map->value;
+}
+
+int bpf_map_update_lru_elem(struct bpf_map **map, void *key, unsigned int key_size, void *value,
+                            unsigned int value_size, unsigned int max_entries, unsigned long long flags) {
+    struct bpf_map *tmp_map;
+    HASH_FIND(hh, *map, key, key_size, tmp_map);
+    int ret = check_flags(tmp_map, flags);
+    if (ret)
+        return ret;
+    if (tmp_map != NULL) {
+        touch_elem(map, tmp_map);
+    } else if (max_entries > 0 && HASH_COUNT(*map) >= max_entries) {
+        struct bpf_map *oldest = *map;
+        HASH_DEL(*map, oldest);
+        free(oldest->value);
+        free(oldest->key);
+        free(oldest);
+    }
+    return bpf_map_update_elem(map, key, key_size, value, value_size, flags);
+}
+
 int bpf_map_delete_elem(struct bpf_map *map, void *key, unsigned int key_size) {
     struct bpf_map *tmp_map;
     HASH_FIND(hh, map, key, key_size, tmp_map);
@@ -49,6 +49,26 @@ int bpf_map_update_elem(struct bpf_map **map, void *key, unsigned int key_size,
  */
 void *bpf_map_lookup_elem(struct bpf_map *map, void *key, unsigned int key_size);
 
+/**
+ * @brief Find a value based on a key and mark it as most recently used.
+ * @details Same as bpf_map_lookup_elem, for maps which evict the least
+ * recently used element when they are full.
+ *
+ * @return NULL if key does not exist
+ */
+void *bpf_map_lookup_lru_elem(struct bpf_map **map, void *key, unsigned int key_size);
+
+/**
+ * @brief Add/Update a value in a map which holds at most max_entries elements.
+ * @details Same as bpf_map_update_elem, except that adding an element to a
+ * full map first deletes the least recently used element, as the kernel
+ * BPF_MAP_TYPE_LRU_HASH does.
+ *
+ * @return EXIT_FAILURE if update operation fails
+ */
+int bpf_map_update_lru_elem(struct bpf_map **map, void *key, unsigned int key_size, void *value,
+                            unsigned int value_size, unsigned int max_entries, unsigned long long flags);
+
 /**
  * @brief Delete key and value from the map.
  * @details Deletes the key and the corresponding value from the map.
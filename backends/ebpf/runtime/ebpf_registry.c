@@ -40,6 +40,37 @@ static int table_indexer = 0;
 static registry_entry *reg_tables_name = NULL;
 static registry_entry *reg_tables_id = NULL;
 
+/* Dispatch the map operations on the type of the table */
+static int table_update_elem(struct bpf_table *tbl, void *key, void *value, unsigned long long flags) {
+    if (tbl->type == BPF_MAP_TYPE_LPM_TRIE)
+        return bpf_lpm_update_elem(&tbl->lpm_trie, key, tbl->key_size, value, tbl->value_size, flags);
+    if (tbl->type == BPF_MAP_TYPE_LRU_HASH)
+        return bpf_map_update_lru_elem(&tbl->bpf_map, key, tbl->key_size, value, tbl->value_size,
+                                       tbl->max_entries, flags);
+    return bpf_map_update_elem(&tbl->bpf_map, key, tbl->key_size, value, tbl->value_size, flags);
+}
+
+static int table_delete_elem(struct bpf_table *tbl, void *key) {
+    if (tbl->type == BPF_MAP_TYPE_LPM_TRIE)
+        return bpf_lpm_delete_elem(tbl->lpm_trie, key, tbl->key_size);
+    return bpf_map_delete_elem(tbl->bpf_map, key, tbl->key_size);
+}
+
+static void *table_lookup_elem(struct bpf_table *tbl, void *key) {
+    if (tbl->type == BPF_MAP_TYPE_LPM_TRIE)
+        return bpf_lpm_lookup_elem(tbl->lpm_trie, key, tbl->key_size);
+    if (tbl->type == BPF_MAP_TYPE_LRU_HASH)
+        return bpf_map_lookup_lru_elem(&tbl->bpf_map, key, tbl->key_size);
+    return bpf_map_lookup_elem(tbl->bpf_map, key, tbl->key_size);
+}
+
+static void table_delete(struct bpf_table *tbl) {
+    if (tbl->type == BPF_MAP_TYPE_LPM_TRIE)
+        bpf_lpm_delete_trie(tbl->lpm_trie);
+    else
+        bpf_map_delete_map(tbl->bpf_map);
+}
+
 static registry_entry *find_register(const char *name) {
     if (strlen(name) > MAX_TABLE_NAME_LENGTH){
         fprintf(stderr, "Error: Key name %s exceeds maximum size %d", name, MAX_TABLE_NAME_LENGTH);
@@ -83,7 +114,7 @@ void registry_delete() {
     registry_entry *curr_tbl, *tmp_tbl;
     HASH_ITER(h_name, reg_tables_name, curr_tbl, tmp_tbl) {
         HASH_DELETE(h_name, reg_tables_name, curr_tbl);
-        bpf_map_delete_map(curr_tbl->tbl->bpf_map);
+        table_delete(curr_tbl->tbl);
         free(curr_tbl);
     }
     curr_tbl = NULL;
@@ -96,7 +127,7 @@ void registry_delete() {
 int registry_delete_tbl(const char *name) {
     registry_entry *tmp_reg = find_register(name);
     if (tmp_reg != NULL) {
-        bpf_map_delete_map(tmp_reg->tbl->bpf_map);
+        table_delete(tmp_reg->tbl);
         HASH_DELETE(h_name, reg_tables_name, tmp_reg);
         HASH_DELETE(h_id, reg_tables_id, tmp_reg);
         free(tmp_reg);
@@ -125,7 +156,7 @@ int registry_update_table(const char *name, void *key, void *value, unsigned lon
     if (tmp_tbl == NULL)
         /* not found, return */
         return EXIT_FAILURE;
-    return bpf_map_update_elem(&tmp_tbl->bpf_map, key, tmp_tbl->key_size, value, tmp_tbl->value_size, flags);
+    return table_update_elem(tmp_tbl, key, value, flags);
 }
 
 int registry_update_table_id(int tbl_id, void *key, void *value, unsigned long long flags) {
@@ -133,7 +164,7 @@ int registry_update_table_id(int tbl_id, void *key, void *value, unsigned long l
     if (tmp_tbl == NULL)
         /* not found, return */
         return EXIT_FAILURE;
-    return bpf_map_update_elem(&tmp_tbl->bpf_map, key, tmp_tbl->key_size, value, tmp_tbl->value_size, flags);
+    return table_update_elem(tmp_tbl, key, value, flags);
 }
 
 int registry_delete_table_elem(const char *name, void *key) {
@@ -141,7 +172,7 @@ int registry_delete_table_elem(const char *name, void *key) {
     if (tmp_tbl == NULL)
         /* not found, return */
         return EXIT_FAILURE;
-    return bpf_map_delete_elem(tmp_tbl->bpf_map, key, tmp_tbl->key_size);;
+    return table_delete_elem(tmp_tbl, key);
 }
 
 int registry_delete_table_elem_id(int tbl_id, void *key) {
@@ -149,7 +180,7 @@ int registry_delete_table_elem_id(int tbl_id, void *key) {
     if (tmp_tbl == NULL)
         /* not found, return */
         return EXIT_FAILURE;
-    return bpf_map_delete_elem(tmp_tbl->bpf_map, key, tmp_tbl->key_size);;
+    return table_delete_elem(tmp_tbl, key);
 }
 
 void *registry_lookup_table_elem(const char *name, void *key) {
@@ -157,7 +188,7 @@ void *registry_lookup_table_elem(const char *name, void *key) {
     if (tmp_tbl == NULL)
         /* not found, return */
         return NULL;
-    return bpf_map_lookup_elem(tmp_tbl->bpf_map, key, tmp_tbl->key_size);
+    return table_lookup_elem(tmp_tbl, key);
 }
 
 void *registry_lookup_table_elem_id(int tbl_id, void *key) {
@@ -165,7 +196,30 @@ void *registry_lookup_table_elem_id(int tbl_id, void *key) {
     if (tmp_tbl == NULL)
         /* not found, return */
         return NULL;
-    return bpf_map_lookup_elem(tmp_tbl->bpf_map, key, tmp_tbl->key_size);
+    return table_lookup_elem(tmp_tbl, key);
+}
+
+int registry_lookup_copy_id(int tbl_id, void *key, void *value) {
+    struct bpf_table *tmp_tbl = registry_lookup_table_id(tbl_id);
+    if (tmp_tbl == NULL)
+        return EXIT_FAILURE;
+    void *found = table_lookup_elem(tmp_tbl, key);
+    if (found == NULL)
+        return EXIT_FAILURE;
+    memcpy(value, found, tmp_tbl->value_size);
+    return EXIT_SUCCESS;
+}
+
+int registry_lookup_percpu_sum_id(int tbl_id, void *key, uint64_t *sum) {
+    struct bpf_table *tmp_tbl = registry_lookup_table_id(tbl_id);
+    if (tmp_tbl == NULL || tmp_tbl->value_size > sizeof(*sum))
+        return EXIT_FAILURE;
+    void *value = table_lookup_elem(tmp_tbl, key);
+    if (value == NULL)
+        return EXIT_FAILURE;
+    *sum = 0;
+    memcpy(sum, value, tmp_tbl->value_size);
+    return EXIT_SUCCESS;
 }
 
 int registry_get_id(const char *name) {
@@ -25,26 +25,40 @@ limitations under the License.
 #define BACKENDS_EBPF_RUNTIME_EBPF_REGISTRY_H_
 
 #include "ebpf_map.h"
+#include "ebpf_lpm.h"
 
 #define MAX_TABLE_NAME_LENGTH 256  // maximum length of the table name
 
+/* Supported bpf map types */
+enum bpf_map_type {
+    BPF_MAP_TYPE_HASH,
+    BPF_MAP_TYPE_ARRAY,
+    BPF_MAP_TYPE_LPM_TRIE,
+    BPF_MAP_TYPE_PERCPU_ARRAY,  // single CPU, same as BPF_MAP_TYPE_ARRAY
+    BPF_MAP_TYPE_PERCPU_HASH,   // single CPU, same as BPF_MAP_TYPE_HASH
+    BPF_MAP_TYPE_LRU_HASH,      // hash which evicts the least recently used entry
+};
+
 /**
  * @brief A helper structure used to describe attributes.
  * @details This structure describes various properties of the ebpf table
  * such as key and value size and the maximum amount of entries possible.
- * In userspace, this space is theoretically unlimited.
- * This table definition points to an actual hashmap managed by uthash,
- * the relation is many-to-one.
+ * In userspace, this space is theoretically unlimited, except for
+ * BPF_MAP_TYPE_LRU_HASH tables, which hold at most max_entries entries.
+ * This table definition points to an actual hashmap managed by uthash or,
+ * for BPF_MAP_TYPE_LPM_TRIE tables, to a longest-prefix-match trie.
+ * The relation is many-to-one.
  * "name" should not exceed VAR_SIZE. Functions using bpf_table also assume
  * that "name" is a conventional null-terminated string.
  */
 struct bpf_table {
     char *name;                 // table name longer than VAR_SIZE is not accessed
-    unsigned int type;          // currently only hashmap is supported
+    unsigned int type;          // enum bpf_map_type, arrays are emulated by hashmaps
     unsigned int key_size;      // size of the key structure
     unsigned int value_size;    // size of the value structure
     unsigned int max_entries;   // Maximum of possible entries
     struct bpf_map *bpf_map;    // Pointer to the actual hash map
+    struct bpf_lpm_trie *lpm_trie;  // Pointer to the trie of LPM tables
 };
 
 /**
@@ -159,4 +173,22 @@ void *registry_lookup_table_elem(const char *name, void *key);
  */
 void *registry_lookup_table_elem_id(int tbl_id, void *key);
 
+/**
+ * @brief Copy a value of a bpf map through the registry.
+ * @details Same as registry_lookup_table_elem_id, but copies the value to
+ * the caller like the kernel bpf_map_lookup_elem syscall wrapper.
+ * This operation uses an integer as the key.
+ * @return EXIT_FAILURE if the map or the value cannot be found.
+ */
+int registry_lookup_copy_id(int tbl_id, void *key, void *value);
+
+/**
+ * @brief Read the sum over all CPUs of an element of a per-CPU map.
+ * @details The userspace maps have a single CPU, so the sum is the value
+ * itself, an unsigned integer of at most 8 bytes.
+ * This operation uses an integer as the key.
+ * @return EXIT_FAILURE if the map or the value cannot be found.
+ */
+int registry_lookup_percpu_sum_id(int tbl_id, void *key, uint64_t *sum);
+
 #endif  // BACKENDS_EBPF_RUNTIME_EBPF_REGISTRY_H_
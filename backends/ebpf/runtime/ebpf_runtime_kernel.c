@@ -14,10 +14,15 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#define _GNU_SOURCE     // sendmmsg(), pthread_setaffinity_np()
 #include <unistd.h>     // getopt()
 #include <ctype.h>      // isprint()
+#include <errno.h>
 #include <string.h>     // memcpy()
 #include <stdlib.h>     // malloc()
+#include <pthread.h>
+#include <sched.h>      // CPU_SET()
+#include <time.h>       // clock_gettime()
 #include <arpa/inet.h>
 #include <linux/if_packet.h>
 #include <netinet/ether.h>
@@ -86,3 +91,183 @@ void run_and_record_output(pcap_list_t *pkt_list, char *pcap_base, uint16_t num_
     /* Sleep a bit to allow the remaining processes to finish */
     sleep(2);
 }
+
+/* Load generation: replays a packet pool from several sender threads */
+
+struct replay_thread {
+    pthread_t thread;
+    int cpu;                    // -1 if not pinned
+    uint32_t first_pass;        // the thread sends passes first_pass,
+    uint32_t pass_step;         // first_pass + pass_step, ...
+    uint32_t iterations;
+    uint32_t burst;
+    double rate;                // packets per second of this thread, 0 for no limit
+    const pcap_pool_t *pool;
+    uint16_t num_ifaces;
+    uint64_t sent;
+    uint64_t send_errors;       // packets the kernel did not accept
+    double elapsed;
+};
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void wait_until(double deadline) {
+    double delay = deadline - now();
+    if (delay <= 0)
+        return;
+    struct timespec ts = { (time_t) delay, (long) ((delay - (time_t) delay) * 1e9) };
+    nanosleep(&ts, NULL);
+}
+
+/* Sends count messages on sockfd, returns the number the kernel accepted */
+static uint32_t send_batch(int sockfd, struct mmsghdr *msgs, uint32_t count) {
+    uint32_t done = 0;
+    while (done < count) {
+        int ret = sendmmsg(sockfd, msgs + done, count - done, 0);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            /* EAGAIN or ENOBUFS: the interface queue is full, drop the rest */
+            break;
+        }
+        done += ret;
+    }
+    return done;
+}
+
+static void *replay_thread_main(void *arg) {
+    struct replay_thread *self = arg;
+    const pcap_pool_t *pool = self->pool;
+    if (self->cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(self->cpu, &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+    /* Each thread has its own sockets so that senders do not share queues */
+    int *sockfds = init_sockets(NULL, self->num_ifaces);
+    struct mmsghdr *msgs = calloc(self->burst, sizeof(struct mmsghdr));
+    struct iovec *iovs = calloc(self->burst, sizeof(struct iovec));
+    for (uint32_t i = 0; i < self->burst; i++) {
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    double start = now();
+    uint64_t queued = 0;
+    for (uint32_t pass = self->first_pass; pass < self->iterations; pass += self->pass_step) {
+        uint32_t count = 0;
+        iface_index ifindex = 0;
+        for (uint32_t i = 0; i <= pool->num_pkts; i++) {
+            /* A batch goes to one socket: flush it when the interface changes */
+            if (count > 0 && (i == pool->num_pkts || count == self->burst ||
+                              pool->ifindex[i] != ifindex)) {
+                if (self->rate > 0)
+                    wait_until(start + queued / self->rate);
+                uint32_t sent = send_batch(sockfds[ifindex], msgs, count);
+                self->sent += sent;
+                self->send_errors += count - sent;
+                queued += count;
+                count = 0;
+            }
+            if (i == pool->num_pkts)
+                break;
+            ifindex = pool->ifindex[i];
+            iovs[count].iov_base = pool->data + pool->offsets[i];
+            iovs[count].iov_len = pool->lens[i];
+            count++;
+        }
+    }
+    self->elapsed = now() - start;
+
+    free(iovs);
+    free(msgs);
+    close_sockets(sockfds, self->num_ifaces);
+    return NULL;
+}
+
+static uint64_t read_iface_stat(uint16_t iface, const char *stat) {
+    char path[64];
+    unsigned long long value = 0;
+    snprintf(path, sizeof(path), "/sys/class/net/%hu/statistics/%s", iface, stat);
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+        return 0;
+    if (fscanf(f, "%llu", &value) != 1)
+        value = 0;
+    fclose(f);
+    return value;
+}
+
+uint64_t replay_packets(pcap_pool_t *pool, uint32_t iterations, uint32_t burst,
+                        uint32_t num_threads, uint64_t rate, int debug) {
+    uint16_t num_ifaces = 0;
+    for (uint32_t i = 0; i < pool->num_pkts; i++)
+        if (pool->ifindex[i] >= num_ifaces)
+            num_ifaces = pool->ifindex[i] + 1;
+    if (num_threads == 0 || num_threads > iterations)
+        num_threads = iterations > 0 ? iterations : 1;
+
+    /* Pin the threads to distinct cores among the ones we may run on */
+    cpu_set_t allowed;
+    int cpus[CPU_SETSIZE];
+    int num_cpus = 0;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            if (CPU_ISSET(cpu, &allowed))
+                cpus[num_cpus++] = cpu;
+
+    uint64_t tx_before[num_ifaces], drop_before[num_ifaces];
+    for (uint16_t i = 0; i < num_ifaces; i++) {
+        tx_before[i] = read_iface_stat(i, "tx_packets");
+        drop_before[i] = read_iface_stat(i, "tx_dropped");
+    }
+
+    struct replay_thread *threads = calloc(num_threads, sizeof(struct replay_thread));
+    for (uint32_t t = 0; t < num_threads; t++) {
+        threads[t].cpu = num_cpus > 0 ? cpus[t % num_cpus] : -1;
+        threads[t].first_pass = t;
+        threads[t].pass_step = num_threads;
+        threads[t].iterations = iterations;
+        threads[t].burst = burst;
+        threads[t].rate = (double) rate / num_threads;
+        threads[t].pool = pool;
+        threads[t].num_ifaces = num_ifaces;
+        if (pthread_create(&threads[t].thread, NULL, replay_thread_main, &threads[t]) != 0) {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    uint64_t sent = 0, send_errors = 0;
+    double elapsed = 0;
+    for (uint32_t t = 0; t < num_threads; t++) {
+        pthread_join(threads[t].thread, NULL);
+        sent += threads[t].sent;
+        send_errors += threads[t].send_errors;
+        if (threads[t].elapsed > elapsed)
+            elapsed = threads[t].elapsed;
+        if (debug)
+            printf("Thread %u on cpu %d: %llu packets sent, %llu send errors, %.3f Mpps\n",
+                   t, threads[t].cpu, (unsigned long long) threads[t].sent,
+                   (unsigned long long) threads[t].send_errors,
+                   threads[t].elapsed > 0 ? threads[t].sent / threads[t].elapsed / 1e6 : 0.0);
+    }
+    free(threads);
+
+    printf("Sent %llu packets from %u threads in %.3f s: %.3f Mpps",
+           (unsigned long long) sent, num_threads, elapsed,
+           elapsed > 0 ? sent / elapsed / 1e6 : 0.0);
+    if (rate > 0)
+        printf(" (target %.3f Mpps)", rate / 1e6);
+    printf(", %llu send errors\n", (unsigned long long) send_errors);
+    for (uint16_t i = 0; i < num_ifaces; i++)
+        printf("Interface %hu: %llu packets transmitted, %llu dropped\n", i,
+               (unsigned long long) (read_iface_stat(i, "tx_packets") - tx_before[i]),
+               (unsigned long long) (read_iface_stat(i, "tx_dropped") - drop_before[i]));
+    return sent;
+}
@@ -18,7 +18,8 @@ limitations under the License.
  * Runtime operations specific to the kernel target. Opens a raw socket per
  * interface, launches a tcpdump packet listener, and writes packets to a
  * virtual interface. The successful output is recorded by tcpdump and written
- * to file.
+ * to file. In throughput mode, the runtime is a multi-threaded load generator
+ * instead.
  */
 
 #ifndef BACKENDS_EBPF_RUNTIME_EBPF_RUNTIME_KERNEL_H_
@@ -28,9 +29,25 @@ limitations under the License.
 #include "ebpf_runtime_kernel.h"
 
 void run_and_record_output(pcap_list_t *pkt_list, char *pcap_base, uint16_t num_pcaps, int debug);
+/**
+ * @brief Replay a packet pool into the interfaces as a load generator.
+ * @details The passes over the pool are spread over num_threads threads, each
+ * pinned to its own core and owning one raw socket per interface. Packets are
+ * sent in batches of up to burst packets with sendmmsg(). With a non-zero
+ * rate, the threads pace themselves to rate packets per second in total.
+ * Packets the interfaces do not accept are dropped, not retried. Prints the
+ * achieved packet rate, the send errors and the transmit and drop counters
+ * of the interfaces.
+ *
+ * @return The number of packets sent.
+ */
+uint64_t replay_packets(pcap_pool_t *pool, uint32_t iterations, uint32_t burst,
+                        uint32_t num_threads, uint64_t rate, int debug);
 
 #define RUN(ebpf_filter, pcap_base, num_pcaps, input_list, debug) \
     run_and_record_output(input_list, pcap_base, num_pcaps, debug)
+#define RUN_THROUGHPUT(pool, iterations, burst, threads, rate, debug) \
+    replay_packets(pool, iterations, burst, threads, rate, debug)
 #define INIT_EBPF_TABLES(debug)
 #define DELETE_EBPF_TABLES(debug)
 
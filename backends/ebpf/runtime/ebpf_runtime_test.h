@@ -29,12 +29,18 @@ limitations under the License.
 typedef int (*packet_filter)(SK_BUFF* s);
 
 void *run_and_record_output(packet_filter ebpf_filter, const char *pcap_base, pcap_list_t *pkt_list, int debug);
+uint64_t run_throughput(pcap_pool_t *pool, uint32_t iterations, uint32_t burst, int debug);
 void init_ebpf_tables(int debug);
 void delete_ebpf_tables(int debug);
 
 #define RUN(ebpf_filter, pcap_base, num_pcaps, input_list, debug) \
     run_and_record_output(ebpf_filter, pcap_base, input_list, debug)
+/* The emulation runs on one thread; threads and rate only apply to the kernel target */
+#define RUN_THROUGHPUT(pool, iterations, burst, threads, rate, debug) \
+    run_throughput(pool, iterations, burst, debug)
 #define INIT_EBPF_TABLES(debug) init_ebpf_tables(debug)
 #define DELETE_EBPF_TABLES(debug) delete_ebpf_tables(debug)
+#define PROFILE_COUNTER_LOOKUP(id) \
+    registry_lookup_table_elem(MAP_PATH "/" PROFILE_COUNTER_MAP, id)
 
 #endif  // BACKENDS_EBPF_RUNTIME_EBPF_RUNTIME_TEST_H_
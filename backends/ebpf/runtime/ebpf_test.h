@@ -29,6 +29,7 @@ limitations under the License.
 #include "ebpf_common.h"
 
 #include <endian.h>
+#include <time.h>
 
 /* define some byte order conversions, these mimic bpf_endian.h */
 #define htonll(x) htobe64(x)
@@ -46,6 +47,13 @@ limitations under the License.
 #define load_word(data, b) bpf_ntohl(*(u32 *)((u8*)(data) + (b)))
 #define load_dword(data, b) bpf_be64_to_cpu(*(u64 *)((u8*)(data) + (b)))
 
+/* mimics the kernel helper, used by the profiling counters */
+static inline u64 bpf_ktime_get_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
 
 
 #define bpf_printk(fmt, ...)                                            \
@@ -75,14 +83,6 @@ struct sk_buff {
 #define BPF_EXIST   2 /* update existing element */
 #define BPF_F_LOCK  4 /* spin_lock-ed map_lookup/map_update */
 
-/* Supported bpf map types */
-enum bpf_map_type {
-    BPF_MAP_TYPE_HASH,
-    BPF_MAP_TYPE_ARRAY,
-};
-
-
-
 #define SK_BUFF struct sk_buff
 #define REGISTER_START() \
 struct bpf_table tables[] = {
@@ -100,6 +100,10 @@ struct bpf_table tables[] = {
     registry_delete_table_elem(MAP_PATH"/"#table, key)
 #define BPF_USER_MAP_UPDATE_ELEM(index, key, value, flags)\
     registry_update_table_id(index, key, value, flags)
+#define BPF_USER_MAP_LOOKUP_ELEM(index, key, value)\
+    registry_lookup_copy_id(index, key, value)
+#define BPF_USER_MAP_LOOKUP_PERCPU_SUM(index, key, sum, value_size)\
+    registry_lookup_percpu_sum_id(index, key, sum)
 #define BPF_OBJ_PIN(table, name) registry_add(table)
 #define BPF_OBJ_GET(name) registry_get_id(name)
 
@@ -229,6 +229,49 @@ pcap_pkt *copy_pkt(pcap_pkt *src_pkt) {
     return new_pkt;
 }
 
+pcap_pool_t *pool_from_list(pcap_list_t *pkt_list) {
+    pcap_pool_t *pool = calloc(1, sizeof(pcap_pool_t));
+    uint64_t data_size = 0;
+    for (uint32_t i = 0; i < pkt_list->len; i++)
+        data_size += pkt_list->pkts[i]->pcap_hdr.len;
+    if (pool == NULL || data_size > UINT32_MAX) {
+        fprintf(stderr, "Fatal: Failed to allocate a pool for %u packets!\n", pkt_list->len);
+        exit(EXIT_FAILURE);
+    }
+    pool->num_pkts = pkt_list->len;
+    pool->data_size = data_size;
+    pool->data = malloc(data_size);
+    pool->offsets = malloc(pool->num_pkts * sizeof(uint32_t));
+    pool->lens = malloc(pool->num_pkts * sizeof(uint32_t));
+    pool->ifindex = malloc(pool->num_pkts * sizeof(iface_index));
+    if ((data_size && !pool->data) || (pool->num_pkts &&
+        (!pool->offsets || !pool->lens || !pool->ifindex))) {
+        fprintf(stderr, "Fatal: Failed to allocate a pool of %llu bytes!\n",
+                (unsigned long long) data_size);
+        exit(EXIT_FAILURE);
+    }
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < pool->num_pkts; i++) {
+        pcap_pkt *pkt = pkt_list->pkts[i];
+        memcpy(pool->data + offset, pkt->data, pkt->pcap_hdr.len);
+        pool->offsets[i] = offset;
+        pool->lens[i] = pkt->pcap_hdr.len;
+        pool->ifindex[i] = pkt->ifindex;
+        if (pkt->pcap_hdr.len > pool->max_len)
+            pool->max_len = pkt->pcap_hdr.len;
+        offset += pkt->pcap_hdr.len;
+    }
+    return pool;
+}
+
+void delete_pool(pcap_pool_t *pool) {
+    free(pool->data);
+    free(pool->offsets);
+    free(pool->lens);
+    free(pool->ifindex);
+    free(pool);
+}
+
 /* Rank packets based on the timestamp of the pcap header */
 static int compare_pkt_time(const void *s1, const void *s2) {
   pcap_pkt *p1 = *(pcap_pkt **)s1;
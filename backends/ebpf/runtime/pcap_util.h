@@ -39,6 +39,27 @@ typedef struct {
     iface_index ifindex;
 } pcap_pkt;
 
+/* A set of packets stored back to back in a single contiguous buffer.
+   Used by the throughput mode of the runtimes, which avoids touching the
+   allocator per packet.
+ */
+typedef struct {
+    char *data;
+    uint32_t *offsets;      // Start of each packet in data
+    uint32_t *lens;
+    iface_index *ifindex;
+    uint32_t num_pkts;
+    uint32_t data_size;
+    uint32_t max_len;       // Length of the largest packet
+} pcap_pool_t;
+
+/* Describes an output packet by its position in a pool instead of a copy */
+typedef struct {
+    uint32_t index;
+    uint32_t len;
+    iface_index ifindex;
+} pkt_desc_t;
+
 struct pcap_list;
 struct pcap_list_array;
 typedef struct pcap_list pcap_list_t;
@@ -214,6 +235,25 @@ void delete_array(pcap_list_array_t *pkt_list_array);
  */
 void sort_pcap_list(pcap_list_t *pkt_list);
 
+/**
+ * @brief Copy a list of packets into a packet pool.
+ * @details Allocates a pool and copies the content of all packets in the list
+ * into its buffer, in list order. The list remains allocated.
+ * A pool allocated by this function should subsequently be freed by
+ * delete_pool().
+ *
+ * @param pkt_list A list.
+ * @return The pool. This function causes an exit if allocation fails.
+ */
+pcap_pool_t *pool_from_list(pcap_list_t *pkt_list);
+
+/**
+ * @brief Deletes a packet pool and the data it is holding.
+ *
+ * @param pool A pool.
+ */
+void delete_pool(pcap_pool_t *pool);
+
 /**
  * @brief Create a pcap file name from a given base name, interface index,
  * and suffix. Return value must be deallocated after usage.
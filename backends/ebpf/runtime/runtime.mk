@@ -24,7 +24,7 @@ BUILDDIR:= $(BPFDIR)build
 override INCLUDES+= -I$(ROOT_DIR) -include $(ROOT_DIR)ebpf_runtime_$(TARGET).h
 # Optimization flags to save space
 override CFLAGS+= -O2 -g # -Wall -Werror
-override LIBS+= -lpcap
+override LIBS+= -lpcap -lpthread
 
 # The base files required to build the runtime
 SOURCE_BASE= $(ROOT_DIR)ebpf_runtime.c $(ROOT_DIR)pcap_util.c
@@ -73,6 +73,10 @@ $(BPFNAME).c: $(P4FILE)
 	fi;
 	$(P4C) --Werror $(P4INCLUDE) --target $(TARGET) -o $@ $< $(P4ARGS)
 
+# Standalone lookup benchmark of the LPM trie, does not need a P4 program
+lpm_bench: $(ROOT_DIR)ebpf_lpm_bench.c $(ROOT_DIR)ebpf_lpm.c
+	$(GCC) $(CFLAGS) -I$(ROOT_DIR) $^ -o $@
+
 .PHONY: clean
 clean:
 	@echo "Deleting build folder"
@@ -54,6 +54,12 @@ void KernelSamplesTarget::emitTableDecl(Util::SourceCodeBuilder* builder,
         kind = "BPF_MAP_TYPE_ARRAY";
     else if (tableKind == TableLPMTrie)
         kind = "BPF_MAP_TYPE_LPM_TRIE";
+    else if (tableKind == TablePerCPUArray)
+        kind = "BPF_MAP_TYPE_PERCPU_ARRAY";
+    else if (tableKind == TablePerCPUHash)
+        kind = "BPF_MAP_TYPE_PERCPU_HASH";
+    else if (tableKind == TableLRUHash)
+        kind = "BPF_MAP_TYPE_LRU_HASH";
     else
         BUG("%1%: unsupported table kind", tableKind);
     builder->appendFormat("REGISTER_TABLE(%s, %s, ", tblName.c_str(), kind.c_str());
@@ -87,16 +93,6 @@ void TestTarget::emitIncludes(Util::SourceCodeBuilder* builder) const {
     builder->newline();
 }
 
-void TestTarget::emitTableDecl(Util::SourceCodeBuilder* builder,
-                               cstring tblName, TableKind,
-                               cstring keyType, cstring valueType,
-                               unsigned size) const {
-    builder->appendFormat("REGISTER_TABLE(%s, 0 /* unused */,", tblName.c_str());
-    builder->appendFormat("sizeof(%s), sizeof(%s), %d)",
-                          keyType.c_str(), valueType.c_str(), size);
-    builder->newline();
-}
-
 //////////////////////////////////////////////////////////////
 
 void BccTarget::emitTableLookup(Util::SourceCodeBuilder* builder, cstring tblName,
@@ -136,6 +132,12 @@ void BccTarget::emitTableDecl(Util::SourceCodeBuilder* builder,
         kind = "array";
     else if (tableKind == TableLPMTrie)
         kind = "lpm_trie";
+    else if (tableKind == TablePerCPUArray)
+        kind = "percpu_array";
+    else if (tableKind == TablePerCPUHash)
+        kind = "percpu_hash";
+    else if (tableKind == TableLRUHash)
+        kind = "lru_hash";
     else
         BUG("%1%: unsupported table kind", tableKind);
 
@@ -29,7 +29,10 @@ namespace EBPF {
 enum TableKind {
     TableHash,
     TableArray,
-    TableLPMTrie  // longest prefix match trie
+    TableLPMTrie,  // longest prefix match trie
+    TablePerCPUArray,  // one copy of each element per CPU
+    TablePerCPUHash,
+    TableLRUHash  // hash which evicts the least recently used entry when full
 };
 
 class Target {
@@ -129,9 +132,6 @@ class TestTarget : public EBPF::KernelSamplesTarget {
  public:
     TestTarget() : KernelSamplesTarget("Userspace Test") {}
     void emitIncludes(Util::SourceCodeBuilder* builder) const override;
-    void emitTableDecl(Util::SourceCodeBuilder* builder,
-                       cstring tblName, TableKind tableKind,
-                       cstring keyType, cstring valueType, unsigned size) const override;
     cstring dataOffset(cstring base) const override
     { return cstring("((void*)(long)")+ base + "->data)"; }
     cstring dataEnd(cstring base) const override
@@ -18,6 +18,7 @@
 
 
 import os
+import re
 import sys
 sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)) + '/../../tools')
 from testutils import *
@@ -36,17 +37,95 @@ class eBPFCommand(object):
         self.extra = extra          # could also be "pcapng"
 
 
-def _generate_control_actions(cmds):
+def _is_ternary_value(value):
+    return isinstance(value, str) and "*" in value
+
+
+def _ternary_value_and_mask(value):
+    """ Splits a hex constant with don't-care digits (0x0a01****) into
+    a value and a mask. Other constants are matched exactly. """
+    if not _is_ternary_value(value):
+        return value, "~0ULL"
+    digits = value[2:]
+    return ("0x" + digits.replace("*", "0"),
+            "0x" + "".join("0" if d == "*" else "f" for d in digits))
+
+
+def _lpm_value_and_prefix(value, width):
+    """ Splits a hex constant with trailing don't-care digits (0x0a01****)
+    into a value and a prefix length. Other constants match all the bits
+    of the field. """
+    if not _is_ternary_value(value):
+        return value, width
+    digits = value[2:]
+    wildcards = len(digits) - len(digits.rstrip("*"))
+    if "*" in digits.rstrip("*"):
+        raise ValueError("%s is not a prefix" % value)
+    return "0x" + digits.replace("*", "0"), width - 4 * wildcards
+
+
+def read_match_kinds(header):
+    """ Reads the match kind and the width of the lpm field of each table
+    from the <table>_MATCH_KIND and <table>_LPM_WIDTH macros of the
+    generated header. Tables without a macro have exact keys. """
+    kinds = {}
+    lpm_widths = {}
+    if not os.path.isfile(header):
+        return kinds, lpm_widths
+    with open(header) as h:
+        for line in h:
+            m = re.match(r'#define (\w+)_MATCH_KIND "(\w+)"', line)
+            if m:
+                kinds[m.group(1)] = m.group(2)
+            m = re.match(r'#define (\w+)_LPM_WIDTH (\d+)', line)
+            if m:
+                lpm_widths[m.group(1)] = int(m.group(2))
+    return kinds, lpm_widths
+
+
+def _generate_control_actions(cmds, kinds, lpm_widths):
     """ Generates the actual control plane commands.
     This function inserts C code for all the "add" commands that have
-    been parsed. """
+    been parsed. Ternary tables are populated through their generated
+    <table>_add_ternary function, the others through <table>_add, which
+    translates the key of direct-indexed and lpm tables. The match kind
+    of each table comes from the generated header. """
     generated = ""
     for index, cmd in enumerate(cmds):
         key_name = "key_%s%d" % (cmd.table, index)
+        mask_name = "mask_%s%d" % (cmd.table, index)
         value_name = "value_%s%d" % (cmd.table, index)
+        kind = kinds.get(cmd.table, "exact")
+        ternary = cmd.a_type != "setdefault" and kind == "ternary"
         if cmd.a_type == "setdefault":
             tbl_name = cmd.table + "_defaultAction"
             generated += "u32 %s = 0;\n\t" % (key_name)
+        elif ternary:
+            generated += "struct %s_key %s = {};\n\t" % (cmd.table, key_name)
+            generated += "struct %s_key %s = {};\n\t" % (cmd.table, mask_name)
+            tbl_name = cmd.table
+            for key_num, key_field in enumerate(cmd.match):
+                field = key_field[0].split('.')[1]
+                value, mask = _ternary_value_and_mask(key_field[1])
+                generated += ("%s.%s = %s;\n\t"
+                              % (key_name, field, value))
+                generated += ("%s.%s = %s;\n\t"
+                              % (mask_name, field, mask))
+        elif kind == "lpm":
+            generated += "struct %s_key %s = {};\n\t" % (cmd.table, key_name)
+            tbl_name = cmd.table
+            width = lpm_widths[cmd.table]
+            # The other fields of the key are exact, so only the lpm
+            # field has don't-care digits.
+            prefix = width
+            for key_num, key_field in enumerate(cmd.match):
+                field = key_field[0].split('.')[1]
+                value = key_field[1]
+                if _is_ternary_value(value):
+                    value, prefix = _lpm_value_and_prefix(value, width)
+                generated += ("%s.%s = %s;\n\t"
+                              % (key_name, field, value))
+            generated += "%s.prefixlen = %d;\n\t" % (key_name, prefix)
         else:
             generated += "struct %s_key %s = {};\n\t" % (cmd.table, key_name)
             tbl_name = cmd.table
@@ -68,17 +147,32 @@ def _generate_control_actions(cmds):
             generated += "%s," % val_field[1]
         generated += "}},\n\t"
         generated += "};\n\t"
-        generated += ("ok = BPF_USER_MAP_UPDATE_ELEM"
-                      "(tableFileDescriptor, &%s, &%s, BPF_ANY);\n\t"
-                      % (key_name, value_name))
+        if ternary:
+            # As in BMv2, lower stf priorities take precedence; without
+            # priorities, earlier entries do.
+            if cmd.priority:
+                priority = "0xffffffff - %s" % cmd.priority
+            else:
+                priority = "%d" % (len(cmds) - index)
+            generated += ("ok = %s_add_ternary(&%s, &%s, %s, &%s);\n\t"
+                          % (cmd.table, key_name, mask_name, priority,
+                             value_name))
+        elif cmd.a_type == "add":
+            generated += ("ok = %s_add(&%s, &%s);\n\t"
+                          % (cmd.table, key_name, value_name))
+        else:
+            generated += ("ok = BPF_USER_MAP_UPDATE_ELEM"
+                          "(tableFileDescriptor, &%s, &%s, BPF_ANY);\n\t"
+                          % (key_name, value_name))
         generated += ("if (ok != 0) { perror(\"Could not write in %s\");"
                       "exit(1); }\n" % tbl_name)
     return generated
 
 
-def create_table_file(actions, tmpdir, file_name):
+def create_table_file(actions, tmpdir, file_name, header):
     """ Create the control plane file.
-    The control commands are provided by the stf parser.
+    The control commands are provided by the stf parser and the match
+    kinds of the tables by the header generated by the compiler.
     This generated file is required by ebpf_runtime.c to initialize
     the control plane. """
     err = ""
@@ -89,10 +183,12 @@ def create_table_file(actions, tmpdir, file_name):
             control_file.write("\n\t")
             control_file.write("int ok;\n\t")
             control_file.write("int tableFileDescriptor;\n\t")
-            generated_cmds = _generate_control_actions(actions)
+            kinds, lpm_widths = read_match_kinds(header)
+            generated_cmds = _generate_control_actions(actions, kinds,
+                                                       lpm_widths)
             control_file.write(generated_cmds)
             control_file.write("}\n")
-    except OSError as e:
+    except (OSError, ValueError) as e:
         err = e
         return FAILURE, err
     return SUCCESS, err
@@ -149,7 +149,8 @@ class EBPFTarget(object):
         with open(stffile) as raw_stf:
             input_pkts, cmds, self.expected = parse_stf_file(
                 raw_stf)
-            result, err = create_table_file(cmds, self.tmpdir, "control.h")
+            result, err = create_table_file(cmds, self.tmpdir, "control.h",
+                                            self.template + ".h")
             if result != SUCCESS:
                 return result
             result = self._write_pcap_files(input_pkts)
@@ -36,6 +36,7 @@ class Target(EBPFTarget):
         # these files are specific to the test target
         args += "SOURCES+=%s/ebpf_registry.c " % self.runtimedir
         args += "SOURCES+=%s/ebpf_map.c " % self.runtimedir
+        args += "SOURCES+=%s/ebpf_lpm.c " % self.runtimedir
         args += "SOURCES+=%s.c " % self.template
         # include the src of libbpf directly, does not require installation
         args += "INCLUDES+=-I%s/contrib/libbpf/src " % self.runtimedir
@@ -40,6 +40,8 @@ if __name__ == "__main__":
 
     # All args after '--' are intended for the p4 compiler
     argv = argv[1:]
+    for compiler_option in args.compiler_options:
+        argv.extend(compiler_option.split())
     # Run the test with the extracted options and modified argv
     result = run_ebpf_test.run_test(options, argv)
     sys.exit(result)
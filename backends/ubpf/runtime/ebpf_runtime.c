@@ -18,6 +18,7 @@ limitations under the License.
 #include <ctype.h>      // isprint()
 #include <string.h>     // memcpy()
 #include <stdlib.h>     // malloc()
+#include <time.h>       // clock_gettime()
 #ifdef CONTROL_PLANE
 #include "control.h"
 #endif
@@ -25,8 +26,14 @@ limitations under the License.
 
 #define PCAPIN  "_in.pcap"
 #define DELIM   '_'
+#define DEFAULT_BURST 32
 
 static int debug = 0;
+/* Throughput mode: number of passes over the input, 0 if disabled */
+static uint32_t iterations = 0;
+static uint32_t burst = DEFAULT_BURST;
+/* Dump the profile counters after the run */
+static int profile = 0;
 
 void usage(char *name) {
     fprintf(stderr, "This program expects a pcap file pattern, "
@@ -34,11 +41,16 @@ void usage(char *name) {
             "in the order given by the packet time,"
             "then feeds the individual packets into a filter function, "
             "and returns the output.\n");
-    fprintf(stderr, "Usage: %s [-d] -f file.pcap -n num_pcaps\n", name);
+    fprintf(stderr, "Usage: %s [-d] [-p] [-t iterations [-b burst]] -f file.pcap -n num_pcaps\n", name);
     fprintf(stderr, "Options:\n");
     fprintf(stderr, "\t-d: Turn on debug messages\n");
     fprintf(stderr, "\t-f: The input pcap file\n");
     fprintf(stderr, "\t-n: Specifies the number of input pcap files\n");
+    fprintf(stderr, "\t-t: Throughput mode, feed the input the given number of times "
+            "and report the packet rate instead of writing output files\n");
+    fprintf(stderr, "\t-b: Burst size of the throughput mode (default %d)\n", DEFAULT_BURST);
+    fprintf(stderr, "\t-p: Print the profile counters of a program compiled with "
+            "--emit-profile-counters\n");
     exit(EXIT_FAILURE);
 }
 
@@ -57,6 +69,52 @@ static pcap_list_t *get_packets(const char *pcap_base, uint16_t num_pcaps, pcap_
     return merge_and_delete_lists(tmp_list_array, merged_list);
 }
 
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void measure_throughput(pcap_list_t *input_list) {
+    /* Copy the packets into one contiguous buffer, outside of the measurement */
+    pcap_pool_t *pool = pool_from_list(input_list);
+    double start = now();
+    uint64_t passed = RUN_THROUGHPUT(pool, iterations, burst, debug);
+    double elapsed = now() - start;
+    uint64_t total = (uint64_t) pool->num_pkts * iterations;
+    printf("Processed %llu packets (%llu passed) in %.3f s: %.3f Mpps, %.1f ns/packet\n",
+           (unsigned long long) total, (unsigned long long) passed, elapsed,
+           elapsed > 0 ? total / elapsed / 1e6 : 0.0, total ? elapsed * 1e9 / total : 0.0);
+    delete_pool(pool);
+}
+
+static void dump_profile_counters() {
+#if !defined(PROFILE_COUNTERS)
+    fprintf(stderr, "The program was not compiled with --emit-profile-counters\n");
+#elif !defined(PROFILE_COUNTER_LOOKUP)
+    fprintf(stderr, "Read the per-CPU profile counters with "
+            "\"bpftool map dump pinned %s/%s\"\n", MAP_PATH, PROFILE_COUNTER_MAP);
+#else
+    static const char *names[PROFILE_COUNTERS] = PROFILE_COUNTER_NAMES;
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < PROFILE_COUNTERS; i++) {
+        PROFILE_COUNTER_TYPE *counter = PROFILE_COUNTER_LOOKUP(&i);
+        if (counter != NULL)
+            total += counter->ns;
+    }
+    printf("%-40s %12s %14s %10s %7s\n", "region", "calls", "ns", "ns/call", "share");
+    for (uint32_t i = 0; i < PROFILE_COUNTERS; i++) {
+        PROFILE_COUNTER_TYPE *counter = PROFILE_COUNTER_LOOKUP(&i);
+        if (counter == NULL || counter->calls == 0)
+            continue;
+        printf("%-40s %12llu %14llu %10.1f %6.2f%%\n", names[i],
+               (unsigned long long) counter->calls, (unsigned long long) counter->ns,
+               (double) counter->ns / counter->calls,
+               total ? 100.0 * counter->ns / total : 0.0);
+    }
+#endif
+}
+
 void launch_runtime(const char *pcap_name, uint16_t num_pcaps) {
     if (num_pcaps == 0)
         return;
@@ -78,6 +136,11 @@ void launch_runtime(const char *pcap_name, uint16_t num_pcaps) {
     input_list = get_packets(pcap_base, num_pcaps, input_list);
     /* Sort the list */
     sort_pcap_list(input_list);
+    if (iterations > 0) {
+        measure_throughput(input_list);
+        delete_list(input_list);
+        return;
+    }
     /* Run the "program" and retrieve output lists */
     RUN(entry, pcap_base, num_pcaps, input_list, debug);
     /* Delete the list of input packets */
@@ -90,11 +153,14 @@ int main(int argc, char **argv) {
     int c;
     opterr = 0;
 
-    while ((c = getopt (argc, argv, "dn:f:")) != -1) {
+    while ((c = getopt (argc, argv, "dpn:f:t:b:")) != -1) {
         switch (c) {
             case 'd':
             debug = 1;
             break;
+            case 'p':
+                profile = 1;
+            break;
             case 'n':
                 num_pcaps = (int)strtol(optarg, (char **)NULL, 10);
                 if (num_pcaps < 0 || num_pcaps > UINT16_MAX) {
@@ -107,6 +173,16 @@ int main(int argc, char **argv) {
             case 'f':
                 pcap_name = optarg;
             break;
+            case 't':
+                iterations = (uint32_t)strtoul(optarg, (char **)NULL, 10);
+            break;
+            case 'b':
+                burst = (uint32_t)strtoul(optarg, (char **)NULL, 10);
+                if (burst == 0) {
+                    fprintf(stderr, "The burst size must be positive\n");
+                    return EXIT_FAILURE;
+                }
+            break;
             case '?':
                 if (optopt == 'f')
                     fprintf(stderr, "The input trace file is missing. "
@@ -134,6 +210,8 @@ int main(int argc, char **argv) {
 #endif
 
     launch_runtime(pcap_name, num_pcaps);
+    if (profile)
+        dump_profile_counters();
 
     return EXIT_SUCCESS;
 }
@@ -15,23 +15,25 @@ limitations under the License.
 */
 
 #include <stdlib.h>
+#include <string.h>
 #include "ebpf_runtime_ubpf.h"
 
 
 #define PCAPOUT "_out.pcap"
 
+struct std_meta {
+    uint32_t input_port;
+    uint32_t packet_length;
+    uint32_t output_action;
+    uint32_t output_port;
+};
+
 pcap_list_t *feed_packets(packet_filter ebpf_filter, pcap_list_t *pkt_list, int debug) {
     pcap_list_t *output_pkts = allocate_pkt_list();
     uint32_t list_len = get_pkt_list_length(pkt_list);
     for (uint32_t i = 0; i < list_len; i++) {
         /* Parse each packet in the list and check the result */
         struct dp_packet dp;
-        struct std_meta {
-            uint32_t input_port;
-            uint32_t packet_length;
-            uint32_t output_action;
-            uint32_t output_port;
-        };
         struct std_meta md;
         pcap_pkt *input_pkt = get_packet(pkt_list, i);
         dp.data = (void *) input_pkt->data;
@@ -42,6 +44,8 @@ pcap_list_t *feed_packets(packet_filter ebpf_filter, pcap_list_t *pkt_list, int
         md.output_port = 0;
 
         int result = ebpf_filter(&dp, (struct standard_metadata *) &md);
+        /* The program may have reallocated the packet to resize it */
+        input_pkt->data = dp.data;
         /* Updating input_pkt's length */
         input_pkt->pcap_hdr.len = dp.size_;
         input_pkt->pcap_hdr.caplen = dp.size_;
@@ -57,6 +61,71 @@ pcap_list_t *feed_packets(packet_filter ebpf_filter, pcap_list_t *pkt_list, int
     return output_pkts;
 }
 
+/**
+ * @brief Feed a packet pool through the uBPF program in bursts.
+ * @details Throughput mode of the runtime. Each burst slot owns a buffer
+ * which is reused across bursts; the packets are copied into it from the
+ * pool before processing. The buffers are heap allocated since the test
+ * helpers resize packets with realloc(). The program is called directly, so
+ * that it can be inlined when building with link-time optimization.
+ * Surviving packets are recorded as descriptors, not copied.
+ *
+ * @return The number of packets which passed the filter, over all iterations.
+ */
+uint64_t run_throughput(pcap_pool_t *pool, uint32_t iterations, uint32_t burst, int debug) {
+    char **slots = calloc(burst, sizeof(char *));
+    struct dp_packet *dps = calloc(burst, sizeof(struct dp_packet));
+    struct std_meta *mds = calloc(burst, sizeof(struct std_meta));
+    pkt_desc_t *out = calloc(burst, sizeof(pkt_desc_t));
+    uint64_t passed = 0;
+    if (!slots || !dps || !mds || !out) {
+        fprintf(stderr, "Fatal: Failed to allocate the burst buffers!\n");
+        exit(EXIT_FAILURE);
+    }
+    for (uint32_t i = 0; i < burst; i++)
+        slots[i] = malloc(pool->max_len ? pool->max_len : 1);
+    for (uint32_t it = 0; it < iterations; it++) {
+        for (uint32_t first = 0; first < pool->num_pkts; first += burst) {
+            uint32_t num_pkts = pool->num_pkts - first < burst ? pool->num_pkts - first : burst;
+            for (uint32_t i = 0; i < num_pkts; i++) {
+                uint32_t len = pool->lens[first + i];
+                memcpy(slots[i], pool->data + pool->offsets[first + i], len);
+                dps[i].data = slots[i];
+                dps[i].size_ = len;
+                mds[i].input_port = pool->ifindex[first + i];
+                mds[i].packet_length = len;
+                mds[i].output_action = 0;
+                mds[i].output_port = 0;
+            }
+            uint32_t num_out = 0;
+            for (uint32_t i = 0; i < num_pkts; i++) {
+                if (entry(&dps[i], (struct standard_metadata *) &mds[i]) != 0) {
+                    out[num_out].index = first + i;
+                    out[num_out].len = dps[i].size_;
+                    out[num_out].ifindex = mds[i].output_port;
+                    num_out++;
+                }
+            }
+            /* Restore the size of the buffers the program has resized,
+               realloc() may have shrunk them in place */
+            for (uint32_t i = 0; i < num_pkts; i++) {
+                if (dps[i].data != slots[i] || dps[i].size_ != pool->lens[first + i])
+                    slots[i] = realloc(dps[i].data, pool->max_len ? pool->max_len : 1);
+            }
+            passed += num_out;
+            if (debug)
+                printf("Burst at packet %u: %u of %u packets passed\n", first, num_out, num_pkts);
+        }
+    }
+    for (uint32_t i = 0; i < burst; i++)
+        free(slots[i]);
+    free(out);
+    free(mds);
+    free(dps);
+    free(slots);
+    return passed;
+}
+
 void write_pkts_to_pcaps(const char *pcap_base, pcap_list_array_t *output_array, int debug) {
     uint16_t arr_len = get_list_array_length(output_array);
     for (uint16_t i = 0; i < arr_len; i++) {
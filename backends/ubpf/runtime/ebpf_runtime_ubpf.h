@@ -28,6 +28,7 @@ extern uint64_t entry(void *, struct standard_metadata *);
 typedef uint64_t (*packet_filter)(void *dp, struct standard_metadata *std_meta);
 
 void *run_and_record_output(packet_filter entry, const char *pcap_base, pcap_list_t *pkt_list, int debug);
+uint64_t run_throughput(pcap_pool_t *pool, uint32_t iterations, uint32_t burst, int debug);
 
 static void inline init_ubpf_table_test(char *name, unsigned int key_size, unsigned int value_size) {
     struct bpf_table tbl = {
@@ -49,6 +50,8 @@ static void inline init_ubpf_table_test(char *name, unsigned int key_size, unsig
     ubpf_adjust_head_test(ctx, ofs)
 #define ubpf_truncate_packet(ctx, maxlen) \
     ubpf_truncate_packet_test(ctx, maxlen)
+#define ubpf_time_get_ns() \
+    ubpf_time_get_ns_test()
 #define ubpf_map_lookup(table, key) \
     registry_lookup_table_elem(#table, key)
 #define ubpf_map_update(table, key, value) \
@@ -58,8 +61,12 @@ static void inline init_ubpf_table_test(char *name, unsigned int key_size, unsig
 
 #define RUN(entry, pcap_base, num_pcaps, input_list, debug) \
     run_and_record_output(entry, pcap_base, input_list, debug)
+#define RUN_THROUGHPUT(pool, iterations, burst, debug) \
+    run_throughput(pool, iterations, burst, debug)
 #define INIT_EBPF_TABLES(debug)
 #define DELETE_EBPF_TABLES(debug)
+#define PROFILE_COUNTER_LOOKUP(id) \
+    registry_lookup_table_elem("&" PROFILE_COUNTER_MAP, id)
 
 
 #endif //P4C_EBPF_RUNTIME_UBPF_H
\ No newline at end of file
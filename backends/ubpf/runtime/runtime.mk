@@ -27,7 +27,7 @@ override INCLUDES+= -I./$(SRCDIR) -include ebpf_runtime_$(TARGET).h
 # Optimization flags to save space
 override CFLAGS+=-O2 -g # -Wall -Werror
 LIBS+=-lpcap
-SOURCES=$(EBPFDIR)/ebpf_registry.c  $(EBPFDIR)/ebpf_map.c $(BPFNAME).c $(EXTERNOBJ)
+SOURCES=$(EBPFDIR)/ebpf_registry.c  $(EBPFDIR)/ebpf_map.c $(EBPFDIR)/ebpf_lpm.c $(BPFNAME).c $(EXTERNOBJ)
 SRC_BASE+=$(SRCDIR)/ebpf_runtime.c $(EBPFDIR)/pcap_util.c $(SOURCES)
 SRC_BASE+=$(SRCDIR)/ebpf_runtime_$(TARGET).c
 OBJECTS = $(SRC_BASE:%.c=$(BUILDDIR)/%.o)
@@ -62,9 +62,13 @@ $(BPFNAME).c: $(P4FILE)
 	fi;
 	$(P4C) --Werror $(P4INCLUDE) --target $(TARGET) -o $@ $< $(P4ARGS)
 
+# Stress benchmark of the concurrent maps, independent of any P4 program
+rcu_map_bench: $(SRCDIR)/ubpf_rcu_map.c $(SRCDIR)/ubpf_rcu_map_bench.c
+	$(GCC) $(CFLAGS) -pthread $^ -o $@
+
 .PHONY: clean
 clean:
 	@echo "Deleting build folder"
 	@$(RM) -rf $(BUILDDIR)
-	@$(RM) $(BPFNAME)
+	@$(RM) $(BPFNAME) rcu_map_bench
 
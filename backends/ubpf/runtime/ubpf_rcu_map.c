@@ -0,0 +1,536 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/*
+Concurrent maps for the uBPF helpers. Readers follow atomic pointers only;
+writers copy, publish with release stores and retire what they replaced.
+An LPM map is a set of hash tables, one per prefix length in use, probed
+from the longest length down.
+*/
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ubpf_rcu_map.h"
+
+/* Retired objects kept by a map before it waits for a grace period */
+#define RCU_RETIRE_BATCH 256
+
+/* Buckets of the table of a prefix length when it is first used */
+#define LPM_INITIAL_BUCKETS 16
+
+#define ROUNDUP8(x) (((x) + 7) & ~7u)
+
+_Atomic uint64_t rcu_global_epoch = 1;
+static struct rcu_reader *rcu_readers = NULL;
+static pthread_mutex_t rcu_readers_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void rcu_register_reader(struct rcu_reader *reader) {
+    pthread_mutex_lock(&rcu_readers_lock);
+    reader->next = rcu_readers;
+    rcu_readers = reader;
+    pthread_mutex_unlock(&rcu_readers_lock);
+    rcu_online(reader);
+}
+
+void rcu_unregister_reader(struct rcu_reader *reader) {
+    rcu_offline(reader);
+    pthread_mutex_lock(&rcu_readers_lock);
+    for (struct rcu_reader **r = &rcu_readers; *r != NULL; r = &(*r)->next) {
+        if (*r == reader) {
+            *r = reader->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&rcu_readers_lock);
+}
+
+void rcu_offline(struct rcu_reader *reader) {
+    atomic_store_explicit(&reader->epoch, 0, memory_order_release);
+}
+
+void rcu_online(struct rcu_reader *reader) {
+    /* The store must be visible before the lookups which follow it */
+    atomic_store(&reader->epoch, atomic_load(&rcu_global_epoch));
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+void rcu_synchronize(void) {
+    uint64_t target = atomic_fetch_add(&rcu_global_epoch, 1) + 1;
+    pthread_mutex_lock(&rcu_readers_lock);
+    for (struct rcu_reader *r = rcu_readers; r != NULL; r = r->next) {
+        while (1) {
+            uint64_t epoch = atomic_load(&r->epoch);
+            if (epoch == 0 || epoch >= target)
+                break;
+            sched_yield();
+        }
+    }
+    pthread_mutex_unlock(&rcu_readers_lock);
+}
+
+/* First member of every object which can be retired */
+struct rcu_head {
+    struct rcu_head *next;
+};
+
+struct hash_entry {
+    struct rcu_head rcu;
+    struct hash_entry *_Atomic next;
+    uint32_t hash;
+    uint64_t data[];  // the key, then the value at value_offset
+};
+
+/* Replaced as a whole when the table grows */
+struct hash_buckets {
+    struct rcu_head rcu;
+    uint32_t mask;
+    struct hash_entry *_Atomic heads[];
+};
+
+struct hash_table {
+    struct hash_buckets *_Atomic buckets;  // NULL until used, for LPM tables
+    uint32_t max_buckets;
+    unsigned int key_size;
+    unsigned int count;
+};
+
+/* Prefix lengths in use, longest first */
+struct lpm_lengths {
+    struct rcu_head rcu;
+    unsigned int count;
+    unsigned int lengths[];
+};
+
+struct rcu_map {
+    enum rcu_map_type type;
+    unsigned int key_size;
+    unsigned int value_size;
+    unsigned int value_offset;  // of the value in a hash entry
+    unsigned int max_entries;
+    unsigned int count;
+    pthread_mutex_t lock;  // serializes the writers
+    struct rcu_head *retired;
+    unsigned int num_retired;
+
+    struct hash_table hash;             // RCU_MAP_HASH
+    char *values;                       // RCU_MAP_ARRAY
+    struct hash_table *prefixes;        // RCU_MAP_LPM_TRIE, indexed by length
+    struct lpm_lengths *_Atomic lengths;
+};
+
+static void retire(struct rcu_map *map, struct rcu_head *head) {
+    head->next = map->retired;
+    map->retired = head;
+    if (++map->num_retired < RCU_RETIRE_BATCH)
+        return;
+    rcu_synchronize();
+    while (map->retired != NULL) {
+        struct rcu_head *next = map->retired->next;
+        free(map->retired);
+        map->retired = next;
+    }
+    map->num_retired = 0;
+}
+
+static uint32_t hash_key(const void *key, unsigned int key_size) {
+    /* FNV-1a with a final avalanche */
+    const uint8_t *p = key;
+    uint32_t h = 2166136261u;
+    for (unsigned int i = 0; i < key_size; i++) {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    return h;
+}
+
+static uint32_t pow2_at_least(uint32_t n) {
+    uint32_t p = 1;
+    while (p < n && p < (1u << 31))
+        p <<= 1;
+    return p;
+}
+
+static struct hash_buckets *alloc_buckets(uint32_t size) {
+    struct hash_buckets *b = calloc(1, sizeof(struct hash_buckets) +
+                                       size * sizeof(struct hash_entry *));
+    if (b != NULL)
+        b->mask = size - 1;
+    return b;
+}
+
+static int hash_table_init(struct hash_table *table, unsigned int key_size,
+                           uint32_t buckets, uint32_t max_buckets) {
+    struct hash_buckets *b = alloc_buckets(buckets);
+    if (b == NULL)
+        return EXIT_FAILURE;
+    table->max_buckets = max_buckets;
+    table->key_size = key_size;
+    table->count = 0;
+    atomic_store_explicit(&table->buckets, b, memory_order_release);
+    return EXIT_SUCCESS;
+}
+
+static struct hash_entry *hash_table_find(const struct hash_table *table, const void *key,
+                                          uint32_t hash) {
+    struct hash_buckets *b = atomic_load_explicit(&table->buckets, memory_order_acquire);
+    struct hash_entry *e = atomic_load_explicit(&b->heads[hash & b->mask],
+                                                memory_order_acquire);
+    for (; e != NULL; e = atomic_load_explicit(&e->next, memory_order_acquire)) {
+        if (e->hash == hash && memcmp(e->data, key, table->key_size) == 0)
+            return e;
+    }
+    return NULL;
+}
+
+/* Returns the pointer which points to the entry for key, or the last one */
+static struct hash_entry *_Atomic *hash_table_link(struct hash_table *table, const void *key,
+                                                   uint32_t hash) {
+    struct hash_buckets *b = atomic_load_explicit(&table->buckets, memory_order_relaxed);
+    struct hash_entry *_Atomic *link = &b->heads[hash & b->mask];
+    for (struct hash_entry *e = atomic_load_explicit(link, memory_order_relaxed);
+         e != NULL; e = atomic_load_explicit(link, memory_order_relaxed)) {
+        if (e->hash == hash && memcmp(e->data, key, table->key_size) == 0)
+            break;
+        link = &e->next;
+    }
+    return link;
+}
+
+/*
+ * Doubles the number of buckets. Readers may be walking the old chains, so
+ * the entries are copied into the new buckets and the old ones retired.
+ * Called with the map lock held.
+ */
+static int hash_table_grow(struct rcu_map *map, struct hash_table *table) {
+    struct hash_buckets *old = atomic_load_explicit(&table->buckets, memory_order_relaxed);
+    struct hash_buckets *b = alloc_buckets((old->mask + 1) * 2);
+    if (b == NULL)
+        return EXIT_FAILURE;
+    size_t entry_size = sizeof(struct hash_entry) + map->value_offset + map->value_size;
+    for (uint32_t i = 0; i <= old->mask; i++) {
+        for (struct hash_entry *e = atomic_load_explicit(&old->heads[i], memory_order_relaxed);
+             e != NULL; e = atomic_load_explicit(&e->next, memory_order_relaxed)) {
+            struct hash_entry *copy = malloc(entry_size);
+            if (copy == NULL) {
+                /* nothing was published; undo */
+                for (uint32_t j = 0; j <= b->mask; j++) {
+                    struct hash_entry *c = atomic_load_explicit(&b->heads[j],
+                                                                memory_order_relaxed);
+                    while (c != NULL) {
+                        struct hash_entry *next = atomic_load_explicit(&c->next,
+                                                                       memory_order_relaxed);
+                        free(c);
+                        c = next;
+                    }
+                }
+                free(b);
+                return EXIT_FAILURE;
+            }
+            memcpy(copy, e, entry_size);
+            atomic_init(&copy->next, atomic_load_explicit(&b->heads[e->hash & b->mask],
+                                                          memory_order_relaxed));
+            atomic_init(&b->heads[e->hash & b->mask], copy);
+        }
+    }
+    atomic_store_explicit(&table->buckets, b, memory_order_release);
+    for (uint32_t i = 0; i <= old->mask; i++) {
+        struct hash_entry *e = atomic_load_explicit(&old->heads[i], memory_order_relaxed);
+        while (e != NULL) {
+            struct hash_entry *next = atomic_load_explicit(&e->next, memory_order_relaxed);
+            retire(map, &e->rcu);
+            e = next;
+        }
+    }
+    retire(map, &old->rcu);
+    return EXIT_SUCCESS;
+}
+
+/* Called with the map lock held */
+static int hash_table_update(struct rcu_map *map, struct hash_table *table, const void *key,
+                             const void *value, unsigned long long flags) {
+    if (flags > RCU_MAP_EXIST)
+        return EXIT_FAILURE;
+    uint32_t hash = hash_key(key, table->key_size);
+    struct hash_entry *_Atomic *link = hash_table_link(table, key, hash);
+    struct hash_entry *old = atomic_load_explicit(link, memory_order_relaxed);
+    if (old != NULL && flags == RCU_MAP_NOEXIST)
+        return EXIT_FAILURE;
+    if (old == NULL && (flags == RCU_MAP_EXIST || map->count >= map->max_entries))
+        return EXIT_FAILURE;
+    if (old == NULL) {
+        struct hash_buckets *b = atomic_load_explicit(&table->buckets, memory_order_relaxed);
+        if (table->count > b->mask && b->mask + 1 < table->max_buckets) {
+            if (hash_table_grow(map, table))
+                return EXIT_FAILURE;
+            link = hash_table_link(table, key, hash);
+        }
+    }
+
+    struct hash_entry *e = malloc(sizeof(struct hash_entry) + map->value_offset + map->value_size);
+    if (e == NULL)
+        return EXIT_FAILURE;
+    e->hash = hash;
+    memcpy(e->data, key, table->key_size);
+    memcpy((char *) e->data + map->value_offset, value, map->value_size);
+    atomic_init(&e->next, old ? atomic_load_explicit(&old->next, memory_order_relaxed) : NULL);
+    atomic_store_explicit(link, e, memory_order_release);
+    if (old != NULL) {
+        retire(map, &old->rcu);
+    } else {
+        table->count++;
+        map->count++;
+    }
+    return EXIT_SUCCESS;
+}
+
+/* Called with the map lock held */
+static int hash_table_delete(struct rcu_map *map, struct hash_table *table, const void *key) {
+    uint32_t hash = hash_key(key, table->key_size);
+    struct hash_entry *_Atomic *link = hash_table_link(table, key, hash);
+    struct hash_entry *old = atomic_load_explicit(link, memory_order_relaxed);
+    if (old == NULL)
+        return EXIT_FAILURE;
+    atomic_store_explicit(link, atomic_load_explicit(&old->next, memory_order_relaxed),
+                          memory_order_release);
+    retire(map, &old->rcu);
+    table->count--;
+    map->count--;
+    return EXIT_SUCCESS;
+}
+
+static void hash_table_free(struct hash_table *table) {
+    struct hash_buckets *b = atomic_load_explicit(&table->buckets, memory_order_relaxed);
+    if (b == NULL)
+        return;
+    for (uint32_t i = 0; i <= b->mask; i++) {
+        struct hash_entry *e = atomic_load_explicit(&b->heads[i], memory_order_relaxed);
+        while (e != NULL) {
+            struct hash_entry *next = atomic_load_explicit(&e->next, memory_order_relaxed);
+            free(e);
+            e = next;
+        }
+    }
+    free(b);
+}
+
+/* Copies the first length bits of data, zeroing the others */
+static void lpm_mask(uint8_t *out, const uint8_t *data, unsigned int data_size,
+                     unsigned int length) {
+    unsigned int full = length / 8;
+    memcpy(out, data, full);
+    memset(out + full, 0, data_size - full);
+    if (length % 8)
+        out[full] = data[full] & (uint8_t) (0xff << (8 - length % 8));
+}
+
+/* Called with the map lock held, after a length appeared or disappeared */
+static int lpm_publish_lengths(struct rcu_map *map) {
+    unsigned int max_length = (map->key_size - 4) * 8;
+    struct lpm_lengths *lengths = malloc(sizeof(struct lpm_lengths) +
+                                         (max_length + 1) * sizeof(unsigned int));
+    if (lengths == NULL)
+        return EXIT_FAILURE;
+    lengths->count = 0;
+    for (unsigned int l = max_length + 1; l-- > 0;) {
+        if (map->prefixes[l].count > 0)
+            lengths->lengths[lengths->count++] = l;
+    }
+    struct lpm_lengths *old = atomic_exchange_explicit(&map->lengths, lengths,
+                                                       memory_order_acq_rel);
+    if (old != NULL)
+        retire(map, &old->rcu);
+    return EXIT_SUCCESS;
+}
+
+static void *lpm_lookup(struct rcu_map *map, const void *key) {
+    const struct { uint32_t prefixlen; uint8_t data[]; } *k = key;
+    unsigned int data_size = map->key_size - 4;
+    uint8_t masked[data_size];
+    struct lpm_lengths *lengths = atomic_load_explicit(&map->lengths, memory_order_acquire);
+    if (lengths == NULL)
+        return NULL;
+    for (unsigned int i = 0; i < lengths->count; i++) {
+        unsigned int length = lengths->lengths[i];
+        if (length > k->prefixlen)
+            continue;
+        lpm_mask(masked, k->data, data_size, length);
+        const struct hash_table *table = &map->prefixes[length];
+        struct hash_entry *e = hash_table_find(table, masked, hash_key(masked, data_size));
+        if (e != NULL)
+            return (char *) e->data + map->value_offset;
+    }
+    return NULL;
+}
+
+static int lpm_update(struct rcu_map *map, const void *key, const void *value,
+                      unsigned long long flags) {
+    const struct { uint32_t prefixlen; uint8_t data[]; } *k = key;
+    unsigned int data_size = map->key_size - 4;
+    if (k->prefixlen > data_size * 8)
+        return EXIT_FAILURE;
+    struct hash_table *table = &map->prefixes[k->prefixlen];
+    if (atomic_load_explicit(&table->buckets, memory_order_relaxed) == NULL) {
+        /* a length holds at most 2^length prefixes */
+        uint32_t entries = map->max_entries;
+        if (k->prefixlen < 31 && entries > (1u << k->prefixlen))
+            entries = 1u << k->prefixlen;
+        uint32_t max_buckets = pow2_at_least(entries);
+        uint32_t buckets = max_buckets < LPM_INITIAL_BUCKETS ? max_buckets : LPM_INITIAL_BUCKETS;
+        if (hash_table_init(table, data_size, buckets, max_buckets))
+            return EXIT_FAILURE;
+    }
+    uint8_t masked[data_size];
+    lpm_mask(masked, k->data, data_size, k->prefixlen);
+    unsigned int count = table->count;
+    if (hash_table_update(map, table, masked, value, flags))
+        return EXIT_FAILURE;
+    /* the table is filled before readers can see its length */
+    if (count == 0)
+        return lpm_publish_lengths(map);
+    return EXIT_SUCCESS;
+}
+
+static int lpm_delete(struct rcu_map *map, const void *key) {
+    const struct { uint32_t prefixlen; uint8_t data[]; } *k = key;
+    unsigned int data_size = map->key_size - 4;
+    if (k->prefixlen > data_size * 8 ||
+        atomic_load_explicit(&map->prefixes[k->prefixlen].buckets, memory_order_relaxed) == NULL)
+        return EXIT_FAILURE;
+    struct hash_table *table = &map->prefixes[k->prefixlen];
+    uint8_t masked[data_size];
+    lpm_mask(masked, k->data, data_size, k->prefixlen);
+    if (hash_table_delete(map, table, masked))
+        return EXIT_FAILURE;
+    if (table->count == 0)
+        return lpm_publish_lengths(map);
+    return EXIT_SUCCESS;
+}
+
+struct rcu_map *rcu_map_create(enum rcu_map_type type, unsigned int key_size,
+                               unsigned int value_size, unsigned int max_entries) {
+    if (max_entries == 0 || value_size == 0)
+        return NULL;
+    struct rcu_map *map = calloc(1, sizeof(struct rcu_map));
+    if (map == NULL)
+        return NULL;
+    map->type = type;
+    map->key_size = key_size;
+    map->value_size = value_size;
+    map->value_offset = ROUNDUP8(key_size);
+    map->max_entries = max_entries;
+    pthread_mutex_init(&map->lock, NULL);
+
+    int ret = EXIT_FAILURE;
+    switch (type) {
+        case RCU_MAP_ARRAY:
+            if (key_size != sizeof(uint32_t))
+                break;
+            map->values = calloc(max_entries, value_size);
+            ret = map->values ? EXIT_SUCCESS : EXIT_FAILURE;
+            break;
+        case RCU_MAP_HASH:
+            if (key_size == 0)
+                break;
+            /* preallocated, as in the kernel */
+            ret = hash_table_init(&map->hash, key_size, pow2_at_least(max_entries),
+                                  pow2_at_least(max_entries));
+            break;
+        case RCU_MAP_LPM_TRIE:
+            if (key_size <= 4)
+                break;
+            map->prefixes = calloc((key_size - 4) * 8 + 1, sizeof(struct hash_table));
+            ret = map->prefixes ? EXIT_SUCCESS : EXIT_FAILURE;
+            break;
+    }
+    if (ret != EXIT_SUCCESS) {
+        rcu_map_destroy(map);
+        return NULL;
+    }
+    return map;
+}
+
+void *rcu_map_lookup_elem(struct rcu_map *map, const void *key) {
+    switch (map->type) {
+        case RCU_MAP_ARRAY: {
+            uint32_t index = *(const uint32_t *) key;
+            if (index >= map->max_entries)
+                return NULL;
+            return map->values + (size_t) index * map->value_size;
+        }
+        case RCU_MAP_HASH: {
+            struct hash_entry *e = hash_table_find(&map->hash, key,
+                                                   hash_key(key, map->key_size));
+            return e ? (char *) e->data + map->value_offset : NULL;
+        }
+        case RCU_MAP_LPM_TRIE:
+            return lpm_lookup(map, key);
+    }
+    return NULL;
+}
+
+int rcu_map_update_elem(struct rcu_map *map, const void *key, const void *value,
+                        unsigned long long flags) {
+    int ret = EXIT_FAILURE;
+    if (map->type == RCU_MAP_ARRAY) {
+        /* array elements always exist and are written in place */
+        uint32_t index = *(const uint32_t *) key;
+        if (index >= map->max_entries || flags == RCU_MAP_NOEXIST || flags > RCU_MAP_EXIST)
+            return EXIT_FAILURE;
+        memcpy(map->values + (size_t) index * map->value_size, value, map->value_size);
+        return EXIT_SUCCESS;
+    }
+    pthread_mutex_lock(&map->lock);
+    if (map->type == RCU_MAP_HASH)
+        ret = hash_table_update(map, &map->hash, key, value, flags);
+    else if (map->type == RCU_MAP_LPM_TRIE)
+        ret = lpm_update(map, key, value, flags);
+    pthread_mutex_unlock(&map->lock);
+    return ret;
+}
+
+int rcu_map_delete_elem(struct rcu_map *map, const void *key) {
+    int ret = EXIT_FAILURE;
+    pthread_mutex_lock(&map->lock);
+    if (map->type == RCU_MAP_HASH)
+        ret = hash_table_delete(map, &map->hash, key);
+    else if (map->type == RCU_MAP_LPM_TRIE)
+        ret = lpm_delete(map, key);
+    pthread_mutex_unlock(&map->lock);
+    return ret;
+}
+
+void rcu_map_destroy(struct rcu_map *map) {
+    if (map == NULL)
+        return;
+    while (map->retired != NULL) {
+        struct rcu_head *next = map->retired->next;
+        free(map->retired);
+        map->retired = next;
+    }
+    free(map->values);
+    hash_table_free(&map->hash);
+    if (map->prefixes != NULL) {
+        for (unsigned int l = 0; l <= (map->key_size - 4) * 8; l++)
+            hash_table_free(&map->prefixes[l]);
+        free(map->prefixes);
+    }
+    free(atomic_load_explicit(&map->lengths, memory_order_relaxed));
+    pthread_mutex_destroy(&map->lock);
+    free(map);
+}
@@ -0,0 +1,127 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/*
+ * This file defines a reference implementation of the maps behind the uBPF
+ * helpers ubpf_map_lookup, ubpf_map_update and ubpf_map_delete which can be
+ * shared by several packet processing threads and a control plane thread.
+ *
+ * Lookups take no locks and never wait. Updates and deletes replace or unlink
+ * entries and retire them; retired memory is freed only after every registered
+ * reader thread has passed a quiescent state (quiescent-state-based RCU).
+ * Updates to the same map are serialized with a mutex, so writers do not
+ * block readers but do block each other.
+ */
+
+#ifndef P4C_UBPF_RCU_MAP_H
+#define P4C_UBPF_RCU_MAP_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+/* Same values as the enum ubpf_map_type of the generated code */
+enum rcu_map_type {
+    RCU_MAP_ARRAY = 1,
+    RCU_MAP_HASH = 4,
+    RCU_MAP_LPM_TRIE = 5,
+};
+
+/* flags for rcu_map_update_elem, as for BPF_MAP_UPDATE_ELEM */
+#define RCU_MAP_ANY     0 /* create new element or update existing */
+#define RCU_MAP_NOEXIST 1 /* create new element if it didn't exist */
+#define RCU_MAP_EXIST   2 /* update existing element */
+
+/**
+ * @brief A thread which looks up maps.
+ * @details Each packet processing thread owns one of these. Values returned by
+ * a lookup stay valid until the thread calls rcu_quiescent() or goes offline.
+ */
+struct rcu_reader {
+    _Atomic uint64_t epoch;  // last epoch observed, 0 when offline
+    struct rcu_reader *next;
+};
+
+/* Registers a reader; it starts online. */
+void rcu_register_reader(struct rcu_reader *reader);
+void rcu_unregister_reader(struct rcu_reader *reader);
+
+extern _Atomic uint64_t rcu_global_epoch;
+
+/**
+ * @brief Announce that the thread holds no value returned by a lookup.
+ * @details Call it between packets or bursts of packets.
+ */
+static inline void rcu_quiescent(struct rcu_reader *reader) {
+    atomic_store_explicit(&reader->epoch,
+                          atomic_load_explicit(&rcu_global_epoch, memory_order_acquire),
+                          memory_order_release);
+}
+
+/* An offline thread may not look up maps; writers do not wait for it. */
+void rcu_offline(struct rcu_reader *reader);
+void rcu_online(struct rcu_reader *reader);
+
+/**
+ * @brief Wait until every online reader has passed a quiescent state.
+ * @details Must not be called by an online reader.
+ */
+void rcu_synchronize(void);
+
+struct rcu_map;
+
+/**
+ * @brief Create a map.
+ * @details LPM keys use the kernel layout: a 32-bit prefix length in host
+ * byte order followed by the key data, matched most significant bit first.
+ * Array keys are 32-bit indexes and all array values exist, zeroed.
+ *
+ * @return NULL if the arguments are invalid
+ */
+struct rcu_map *rcu_map_create(enum rcu_map_type type, unsigned int key_size,
+                               unsigned int value_size, unsigned int max_entries);
+
+/**
+ * @brief Find a value based on a key, without taking locks.
+ * @details For LPM maps, finds the longest prefix matching the key which is no
+ * longer than the prefix length of the key.
+ *
+ * @return NULL if key does not exist
+ */
+void *rcu_map_lookup_elem(struct rcu_map *map, const void *key);
+
+/**
+ * @brief Add/Update a value in the map.
+ * @details Hash and LPM entries are replaced, not modified in place: readers
+ * holding the previous value keep seeing it. Array values are copied in place.
+ *
+ * @return EXIT_FAILURE if update operation fails
+ */
+int rcu_map_update_elem(struct rcu_map *map, const void *key, const void *value,
+                        unsigned long long flags);
+
+/**
+ * @brief Delete key and value from the map.
+ * @details Array elements cannot be deleted.
+ *
+ * @return EXIT_FAILURE if the key does not exist or the map is an array
+ */
+int rcu_map_delete_elem(struct rcu_map *map, const void *key);
+
+/**
+ * @brief Delete the entire map at once.
+ * @details No thread may use the map any more.
+ */
+void rcu_map_destroy(struct rcu_map *map);
+
+#endif  // P4C_UBPF_RCU_MAP_H
@@ -0,0 +1,234 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/* Stress benchmark of the concurrent uBPF maps. Reader threads look up
+  random keys as a packet processing loop would, and check every value they
+  find, while a writer thread keeps replacing, deleting and re-adding entries.
+  Build it with "make -f runtime.mk rcu_map_bench".
+ */
+
+#include <unistd.h>     // getopt()
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>       // clock_gettime()
+#include "ubpf_rcu_map.h"
+
+#define LOOKUPS_PER_QUIESCENT 32
+
+struct bench_value {
+    uint32_t key;        // the key, or the prefix for LPM maps
+    uint32_t prefixlen;  // LPM maps only
+    uint64_t generation;
+};
+
+struct lpm_key {
+    uint32_t prefixlen;
+    uint32_t addr;  // network byte order
+};
+
+struct reader_stats {
+    pthread_t thread;
+    uint64_t lookups;
+    uint64_t hits;
+    uint64_t errors;
+};
+
+static enum rcu_map_type type = RCU_MAP_HASH;
+static struct rcu_map *map;
+static uint32_t entries = 65536;
+static _Atomic int running = 1;
+static uint64_t updates = 0;
+
+static void usage(char *name) {
+    fprintf(stderr, "Usage: %s [-m hash|array|lpm] [-r readers] [-n entries] [-s seconds]\n",
+            name);
+    exit(EXIT_FAILURE);
+}
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static inline uint64_t xorshift(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/* The i-th LPM prefix: lengths from 8 to 32 bits spread over the address space */
+static struct lpm_key lpm_prefix(uint32_t i) {
+    struct lpm_key key;
+    key.prefixlen = 8 + i % 25;
+    uint32_t addr = i * 2654435761u;
+    addr &= key.prefixlen == 32 ? ~0u : ~(~0u >> key.prefixlen);
+    key.addr = __builtin_bswap32(addr);
+    return key;
+}
+
+static void write_entry(uint32_t i, uint64_t generation) {
+    struct bench_value value = { i, 0, generation };
+    if (type == RCU_MAP_LPM_TRIE) {
+        struct lpm_key key = lpm_prefix(i);
+        value.key = __builtin_bswap32(key.addr);
+        value.prefixlen = key.prefixlen;
+        rcu_map_update_elem(map, &key, &value, RCU_MAP_ANY);
+    } else {
+        rcu_map_update_elem(map, &i, &value, RCU_MAP_ANY);
+    }
+}
+
+static void delete_entry(uint32_t i) {
+    if (type == RCU_MAP_LPM_TRIE) {
+        struct lpm_key key = lpm_prefix(i);
+        rcu_map_delete_elem(map, &key);
+    } else {
+        rcu_map_delete_elem(map, &i);
+    }
+}
+
+/* Returns 0 if the value found for the lookup of key i is consistent */
+static int check(uint32_t key, const struct bench_value *value) {
+    if (type != RCU_MAP_LPM_TRIE)
+        return value->key != key;
+    if (value->prefixlen < 8 || value->prefixlen > 32)
+        return 1;
+    uint32_t mask = value->prefixlen == 32 ? ~0u : ~(~0u >> value->prefixlen);
+    return (key & mask) != value->key;
+}
+
+static void *reader(void *arg) {
+    struct reader_stats *stats = arg;
+    struct rcu_reader self;
+    uint64_t seed = (uintptr_t) arg | 1;
+    rcu_register_reader(&self);
+    while (atomic_load_explicit(&running, memory_order_relaxed)) {
+        for (int i = 0; i < LOOKUPS_PER_QUIESCENT; i++) {
+            uint32_t r = (uint32_t) xorshift(&seed);
+            struct bench_value *value;
+            uint32_t key;
+            if (type == RCU_MAP_LPM_TRIE) {
+                /* an address inside a random prefix */
+                struct lpm_key k = lpm_prefix(r % entries);
+                key = __builtin_bswap32(k.addr) | (r >> k.prefixlen >> 1);
+                k.prefixlen = 32;
+                k.addr = __builtin_bswap32(key);
+                value = rcu_map_lookup_elem(map, &k);
+            } else {
+                key = r % entries;
+                value = rcu_map_lookup_elem(map, &key);
+            }
+            if (value != NULL) {
+                stats->hits++;
+                stats->errors += check(key, value);
+            }
+        }
+        stats->lookups += LOOKUPS_PER_QUIESCENT;
+        rcu_quiescent(&self);
+    }
+    rcu_unregister_reader(&self);
+    return NULL;
+}
+
+static void *writer(void *arg) {
+    (void) arg;
+    uint64_t seed = 88172645463325252ull;
+    while (atomic_load_explicit(&running, memory_order_relaxed)) {
+        uint32_t i = (uint32_t) xorshift(&seed) % entries;
+        /* arrays cannot delete; replace the others half of the time */
+        if (type != RCU_MAP_ARRAY && (updates & 1))
+            delete_entry(i);
+        write_entry(i, updates);
+        updates++;
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    int num_readers = 4;
+    double seconds = 2;
+    int c;
+
+    while ((c = getopt(argc, argv, "m:r:n:s:")) != -1) {
+        switch (c) {
+            case 'm':
+                if (strcmp(optarg, "hash") == 0)
+                    type = RCU_MAP_HASH;
+                else if (strcmp(optarg, "array") == 0)
+                    type = RCU_MAP_ARRAY;
+                else if (strcmp(optarg, "lpm") == 0)
+                    type = RCU_MAP_LPM_TRIE;
+                else
+                    usage(argv[0]);
+            break;
+            case 'r':
+                num_readers = atoi(optarg);
+            break;
+            case 'n':
+                entries = (uint32_t) strtoul(optarg, NULL, 10);
+            break;
+            case 's':
+                seconds = atof(optarg);
+            break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (num_readers <= 0 || entries == 0)
+        usage(argv[0]);
+
+    unsigned int key_size = type == RCU_MAP_LPM_TRIE ? sizeof(struct lpm_key) : sizeof(uint32_t);
+    map = rcu_map_create(type, key_size, sizeof(struct bench_value), entries);
+    if (map == NULL) {
+        fprintf(stderr, "Could not create the map\n");
+        return EXIT_FAILURE;
+    }
+    for (uint32_t i = 0; i < entries; i++)
+        write_entry(i, 0);
+
+    struct reader_stats *stats = calloc(num_readers, sizeof(struct reader_stats));
+    pthread_t writer_thread;
+    double start = now();
+    for (int i = 0; i < num_readers; i++)
+        pthread_create(&stats[i].thread, NULL, reader, &stats[i]);
+    pthread_create(&writer_thread, NULL, writer, NULL);
+    struct timespec duration = { (time_t) seconds,
+                                 (long) ((seconds - (time_t) seconds) * 1e9) };
+    nanosleep(&duration, NULL);
+    atomic_store(&running, 0);
+    pthread_join(writer_thread, NULL);
+    uint64_t lookups = 0, errors = 0;
+    for (int i = 0; i < num_readers; i++) {
+        pthread_join(stats[i].thread, NULL);
+        lookups += stats[i].lookups;
+        errors += stats[i].errors;
+    }
+    double elapsed = now() - start;
+
+    for (int i = 0; i < num_readers; i++)
+        printf("reader %d: %.2f Mlookups/s, %.1f%% hits\n", i,
+               stats[i].lookups / elapsed / 1e6,
+               stats[i].lookups ? 100.0 * stats[i].hits / stats[i].lookups : 0.0);
+    printf("total: %.2f Mlookups/s with %d readers, %.2f Mupdates/s, %llu errors\n",
+           lookups / elapsed / 1e6, num_readers, updates / elapsed / 1e6,
+           (unsigned long long) errors);
+
+    free(stats);
+    rcu_map_destroy(map);
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
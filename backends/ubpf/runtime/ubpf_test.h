@@ -20,6 +20,7 @@ limitations under the License.
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <time.h>
 
 #define MAX_PRINTF_LENGTH 80
 
@@ -38,6 +39,12 @@ static inline void ubpf_printf_test(const char *fmt, ...) {
     va_end(args);
 }
 
+static inline uint64_t ubpf_time_get_ns_test(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
 static inline void *ubpf_packet_data_test(void *ctx) {
     struct dp_packet *dp = (struct dp_packet *) ctx;
     return dp->data;
@@ -50,12 +57,12 @@ static inline void *ubpf_adjust_head_test(void *ctx, int offset) {
         return dp->data;
     } else if (offset > 0) {
         dp->data = realloc(dp->data, dp->size_ + offset);
-        memcpy((char *) dp->data + offset, dp->data, dp->size_);
+        memmove((char *) dp->data + offset, dp->data, dp->size_);
         dp->size_ += offset;
         return dp->data;
     } else {
         int ofs = abs(offset);
-        memcpy(dp->data, (char *) dp->data + ofs, dp->size_ - ofs);
+        memmove(dp->data, (char *) dp->data + ofs, dp->size_ - ofs);
         dp->data = realloc(dp->data, dp->size_ - ofs);
         dp->size_ -= ofs;
         return dp->data;
@@ -67,6 +67,11 @@ namespace UBPF {
             type = "UBPF_MAP_TYPE_ARRAY";
         } else if (tableKind == EBPF::TableLPMTrie) {
             type = "UBPF_MAP_TYPE_LPM_TRIE";
+        } else if (tableKind == EBPF::TablePerCPUArray) {
+            // a uBPF VM runs on a single thread
+            type = "UBPF_MAP_TYPE_ARRAY";
+        } else if (tableKind == EBPF::TablePerCPUHash) {
+            type = "UBPF_MAP_TYPE_HASHMAP";
         } else {
             BUG("%1%: unsupported table kind", tableKind);
         }
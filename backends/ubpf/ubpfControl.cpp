@@ -17,6 +17,7 @@ limitations under the License.
 #include <p4/enumInstance.h>
 #include "ubpfType.h"
 #include "ubpfControl.h"
+#include "backends/ebpf/ebpfProfile.h"
 #include "lib/error.h"
 #include "frontends/p4/tableApply.h"
 #include "frontends/p4/typeMap.h"
@@ -193,6 +194,11 @@ namespace UBPF {
         }
         builder->blockStart();
 
+        auto profile = control->program->profile;
+        if (profile != nullptr)
+            profile->emitProbe(builder,
+                               EBPF::ProfileCounters::tableLookup(table->instanceName));
+
         BUG_CHECK(method->expr->arguments->empty(),
                   "%1%: table apply with arguments", method);
         cstring keyname = "key";
@@ -269,6 +275,8 @@ namespace UBPF {
                               builder->target->abortReturnCode().c_str());
         builder->endOfStatement(true);
 
+        if (profile != nullptr)
+            profile->emitProbe(builder, "control");
         builder->blockEnd(true);
     }
 
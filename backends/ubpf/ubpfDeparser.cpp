@@ -15,6 +15,8 @@ limitations under the License.
 */
 
 #include "ubpfDeparser.h"
+#include "ubpfControl.h"
+#include "ubpfParser.h"
 #include "ubpfType.h"
 #include "frontends/p4/methodInstance.h"
 
@@ -102,6 +104,71 @@ class OutHeaderSize final : public EBPF::CodeGenInspector {
     { substitution.emplace(p, with); }
 };
 
+// Finds the headers written by the parser or the control: assigned
+// to, passed as out or inout argument, or with their validity changed.
+// Extracting a header is not a write.
+class HeaderWrites final : public Inspector {
+    P4::ReferenceMap* refMap;
+    P4::TypeMap*      typeMap;
+    std::set<const IR::Parameter*> headerParams;
+
+    void write(const IR::Expression* expr) {
+        const IR::Member* header = nullptr;
+        while (true) {
+            if (auto m = expr->to<IR::Member>()) {
+                header = m;
+                expr = m->expr;
+            } else if (auto a = expr->to<IR::ArrayIndex>()) {
+                expr = a->left;
+            } else if (auto sl = expr->to<IR::Slice>()) {
+                expr = sl->e0;
+            } else {
+                break;
+            }
+        }
+        auto pe = expr->to<IR::PathExpression>();
+        if (pe == nullptr)
+            return;
+        auto decl = refMap->getDeclaration(pe->path, true);
+        if (headerParams.count(decl->getNode()->to<IR::Parameter>()) == 0)
+            return;
+        if (header == nullptr)
+            allWritten = true;
+        else
+            written.emplace(header->member.name);
+    }
+
+ public:
+    std::set<cstring> written;
+    bool allWritten = false;
+
+    HeaderWrites(P4::ReferenceMap* refMap, P4::TypeMap* typeMap) :
+            refMap(refMap), typeMap(typeMap) { setName("HeaderWrites"); }
+    void addHeaders(const IR::Parameter* param) { headerParams.emplace(param); }
+
+    bool preorder(const IR::AssignmentStatement* statement) override {
+        write(statement->left);
+        return true;
+    }
+    bool preorder(const IR::MethodCallExpression* expression) override {
+        auto mi = P4::MethodInstance::resolve(expression, refMap, typeMap);
+        if (auto bim = mi->to<P4::BuiltInMethod>()) {
+            if (bim->name.name != IR::Type_Header::isValid)
+                write(bim->appliedTo);
+            return true;
+        }
+        if (auto em = mi->to<P4::ExternMethod>()) {
+            if (em->originalExternType->name.name == P4::P4CoreLibrary::instance.packetIn.name)
+                return true;
+        }
+        for (auto p : *mi->substitution.getParametersInArgumentOrder()) {
+            if (p->direction == IR::Direction::Out || p->direction == IR::Direction::InOut)
+                write(mi->substitution.lookup(p)->expression);
+        }
+        return true;
+    }
+};
+
 UBPFDeparserTranslationVisitor::UBPFDeparserTranslationVisitor(
         const UBPFDeparser *deparser) :
         CodeGenInspector(deparser->program->refMap,
@@ -154,6 +221,21 @@ void UBPFDeparserTranslationVisitor::compileEmitField(const IR::Expression *expr
     }
 
     auto program = deparser->program;
+    if (alignment == 0 && widthToEmit % 8 == 0 && widthToEmit > 8 && widthToEmit <= 64) {
+        // the swapped value holds the field bytes in network order
+        builder->emitIndent();
+        builder->appendFormat("memcpy(%s + BYTES(%s), &", program->packetStartVar.c_str(),
+                              program->offsetVar.c_str());
+        visit(expr);
+        builder->appendFormat(".%s, %d)", field.c_str(), bytes);
+        builder->endOfStatement(true);
+        builder->emitIndent();
+        builder->appendFormat("%s += %d", program->offsetVar.c_str(), widthToEmit);
+        builder->endOfStatement(true);
+        builder->newline();
+        return;
+    }
+
     unsigned bitsInFirstByte = widthToEmit % 8;
     if (bitsInFirstByte == 0) bitsInFirstByte = 8;
     unsigned bitsInCurrentByte = bitsInFirstByte;
@@ -264,6 +346,24 @@ void UBPFDeparserTranslationVisitor::compileEmit(const IR::Vector<IR::Argument>
     builder->emitIndent();
     builder->newline();
 
+    cstring header = deparser->unmodifiedHeader(expr, deparser->headers);
+    if (!header.isNullOrEmpty()) {
+        cstring position = deparser->headerPositionVar(header);
+        builder->emitIndent();
+        builder->appendFormat("if (%s >= 0 && %s == %s + %s * 8) ",
+                              position.c_str(), program->offsetVar.c_str(),
+                              position.c_str(), program->outerHdrOffsetVar.c_str());
+        builder->blockStart();
+        builder->emitIndent();
+        builder->appendLine("/* unmodified and in place */");
+        builder->emitIndent();
+        builder->appendFormat("%s += %d", program->offsetVar.c_str(), width);
+        builder->endOfStatement(true);
+        builder->blockEnd(false);
+        builder->append(" else ");
+        builder->blockStart();
+    }
+
     unsigned alignment = 0;
     for (auto f : ht->fields) {
         auto ftype = typeMap->getType(f);
@@ -279,6 +379,8 @@ void UBPFDeparserTranslationVisitor::compileEmit(const IR::Vector<IR::Argument>
         alignment %= 8;
     }
 
+    if (!header.isNullOrEmpty())
+        builder->blockEnd(true);
     builder->blockEnd(true);
 }
 
@@ -319,9 +421,47 @@ bool UBPFDeparser::build() {
     codeGen = new UBPFDeparserTranslationVisitor(this);
     codeGen->substitute(headers, parserHeaders);
 
+    auto writes = new HeaderWrites(program->refMap, program->typeMap);
+    writes->addHeaders(program->parser->headers);
+    writes->addHeaders(program->control->headers);
+    program->parser->parserBlock->container->apply(*writes);
+    program->control->controlBlock->container->apply(*writes);
+    if (!writes->allWritten) {
+        auto ht = program->typeMap->getType(parserHeaders)->to<IR::Type_StructLike>();
+        if (ht != nullptr) {
+            for (auto f : ht->fields) {
+                if (program->typeMap->getType(f)->is<IR::Type_Header>() &&
+                    writes->written.count(f->name.name) == 0)
+                    unmodifiedHeaders.emplace(f->name.name);
+            }
+        }
+    }
+
     return ::errorCount() == 0;
 }
 
+cstring UBPFDeparser::unmodifiedHeader(const IR::Expression *expr,
+                                       const IR::Parameter *headersParam) const {
+    auto member = expr->to<IR::Member>();
+    if (member == nullptr)
+        return nullptr;
+    auto pe = member->expr->to<IR::PathExpression>();
+    if (pe == nullptr ||
+        program->refMap->getDeclaration(pe->path, true)->getNode() != headersParam)
+        return nullptr;
+    if (unmodifiedHeaders.count(member->member.name) == 0)
+        return nullptr;
+    return member->member.name;
+}
+
+void UBPFDeparser::emitHeaderPositions(EBPF::CodeBuilder *builder) const {
+    for (auto h : unmodifiedHeaders) {
+        builder->emitIndent();
+        builder->appendFormat("int %s = -1;", headerPositionVar(h).c_str());
+        builder->newline();
+    }
+}
+
 void UBPFDeparser::emit(EBPF::CodeBuilder *builder) {
     builder->emitIndent();
     builder->appendFormat("int %s = 0", program->outerHdrLengthVar.c_str());
@@ -66,6 +66,9 @@ namespace UBPF {
         const IR::Parameter *parserHeaders;
 
         UBPFDeparserTranslationVisitor *codeGen;
+        // Headers which are never written after they are extracted.
+        // If one is emitted where it was parsed, its bytes are still in place.
+        std::set<cstring> unmodifiedHeaders;
 
         UBPFDeparser(const UBPFProgram *program, const IR::ControlBlock *block,
                      const IR::Parameter *parserHeaders) :
@@ -74,6 +77,14 @@ namespace UBPF {
 
         bool build();
         void emit(EBPF::CodeBuilder *builder);
+        // Name of the header in the headers struct if expr is one of
+        // its fields and the header is unmodified, nullptr otherwise.
+        cstring unmodifiedHeader(const IR::Expression *expr,
+                                 const IR::Parameter *headersParam) const;
+        // Variable holding the bit offset where the header was extracted.
+        cstring headerPositionVar(cstring header) const
+        { return UBPFModel::reserved(header + "_position"); }
+        void emitHeaderPositions(EBPF::CodeBuilder *builder) const;
     };
 
 }
@@ -15,9 +15,11 @@ limitations under the License.
 */
 
 #include "ubpfParser.h"
+#include "ubpfDeparser.h"
 #include "ubpfType.h"
 #include "ubpfHelpers.h"
 #include "ubpfModel.h"
+#include "backends/ebpf/ebpfProfile.h"
 #include "frontends/p4/coreLibrary.h"
 #include "frontends/p4/methodInstance.h"
 
@@ -102,6 +104,11 @@ bool UBPFStateTranslationVisitor::preorder(const IR::ParserState* parserState) {
     builder->spc();
     builder->blockStart();
 
+    auto profile = state->parser->program->profile;
+    if (profile != nullptr)
+        profile->emitProbe(builder,
+                           EBPF::ProfileCounters::parserState(parserState->name.name));
+
     visit(parserState->components, "components");
     if (parserState->selectExpression == nullptr) {
         builder->emitIndent();
@@ -295,6 +302,15 @@ UBPFStateTranslationVisitor::compileExtract(const IR::Expression* destination) {
     unsigned width = ht->width_bits();
     emitCheckPacketLength(width);
 
+    auto program = static_cast<const UBPFProgram*>(state->parser->program);
+    cstring header = program->deparser->unmodifiedHeader(destination, state->parser->headers);
+    if (!header.isNullOrEmpty()) {
+        builder->emitIndent();
+        builder->appendFormat("%s = %s", program->deparser->headerPositionVar(header).c_str(),
+                              program->offsetVar.c_str());
+        builder->endOfStatement(true);
+    }
+
     unsigned alignment = 0;
     for (auto f : ht->fields) {
         auto ftype = state->parser->typeMap->getType(f);
@@ -463,10 +479,21 @@ void UBPFParser::emit(EBPF::CodeBuilder *builder) {
 
     // Create a synthetic reject state
     builder->emitIndent();
-    builder->appendFormat("%s: { return %s; }",
-                          IR::ParserState::reject.c_str(),
-                          builder->target->abortReturnCode().c_str());
-    builder->newline();
+    if (program->profile != nullptr) {
+        // charge the last parser state before leaving
+        builder->appendFormat("%s: ", IR::ParserState::reject.c_str());
+        builder->blockStart();
+        program->profile->emitProbe(builder, "other");
+        builder->emitIndent();
+        builder->appendFormat("return %s;", builder->target->abortReturnCode().c_str());
+        builder->newline();
+        builder->blockEnd(true);
+    } else {
+        builder->appendFormat("%s: { return %s; }",
+                              IR::ParserState::reject.c_str(),
+                              builder->target->abortReturnCode().c_str());
+        builder->newline();
+    }
     builder->newline();
 }
 
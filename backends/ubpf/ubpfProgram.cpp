@@ -20,9 +20,36 @@ limitations under the License.
 #include "ubpfProgram.h"
 #include "ubpfType.h"
 #include "codeGen.h"
+#include "backends/ebpf/ebpfProfile.h"
 
 namespace UBPF {
 
+    namespace {
+
+    /// The uBPF lookup helper returns the value instead of assigning it,
+    /// and the update helper takes the value pointer as is.
+    class UBPFProfileCounters : public EBPF::ProfileCounters {
+     public:
+        UBPFProfileCounters() : EBPF::ProfileCounters(UBPFModel::reserved("")) {
+            timeCall = "ubpf_time_get_ns()";
+            u32Type = "uint32_t";
+            u64Type = "uint64_t";
+        }
+
+     protected:
+        void emitLookup(EBPF::CodeBuilder *builder, cstring key,
+                        cstring value) const override {
+            builder->appendFormat("%s = ", value.c_str());
+            builder->target->emitTableLookup(builder, mapName, key, value);
+        }
+        void emitUpdate(EBPF::CodeBuilder *builder, cstring key,
+                        cstring value) const override {
+            builder->target->emitTableUpdate(builder, mapName, key, "&" + value);
+        }
+    };
+
+    }  // namespace
+
     bool UBPFProgram::build() {
         bool success = true;
         auto pack = toplevel->getMain();
@@ -60,9 +87,29 @@ namespace UBPF {
         deparser = new UBPFDeparser(this, dpb, parser->headers);
         success = deparser->build();
 
+        if (success && options.emitProfileCounters)
+            buildProfileCounters();
         return success;
     }
 
+    void UBPFProgram::buildProfileCounters() {
+        profile = new UBPFProfileCounters();
+        for (auto s : parser->states)
+            profile->add(EBPF::ProfileCounters::parserState(s->state->name.name));
+        profile->add("control");
+        profile->add("deparser");
+        for (auto it : control->tables) {
+            auto table = it.second;
+            profile->add(EBPF::ProfileCounters::tableLookup(table->instanceName));
+            for (auto a : table->actionList->actionList) {
+                auto adecl = refMap->getDeclaration(a->getPath(), true);
+                auto action = adecl->getNode()->to<IR::P4Action>();
+                profile->add(EBPF::ProfileCounters::action(table->instanceName,
+                                                           table->generateActionName(action)));
+            }
+        }
+    }
+
     void UBPFProgram::emitC(UbpfCodeBuilder *builder, cstring headerFile) {
         emitGeneratedComment(builder);
 
@@ -75,6 +122,12 @@ namespace UBPF {
 
         builder->emitIndent();
         control->emitTableInstances(builder);
+        if (profile != nullptr) {
+            profile->emitInstance(builder);
+            builder->newline();
+            profile->emitHelper(builder);
+            builder->newline();
+        }
 
         builder->emitIndent();
         builder->target->emitChecksumHelpers(builder);
@@ -111,8 +164,12 @@ namespace UBPF {
         builder->appendFormat("%s:\n", endLabel.c_str());
         builder->emitIndent();
         builder->blockStart();
+        if (profile != nullptr)
+            profile->emitProbe(builder, "deparser");
         deparser->emit(builder);
         builder->blockEnd(true);
+        if (profile != nullptr)
+            profile->emitProbe(builder, "other");
 
         builder->emitIndent();
         builder->appendFormat("if (%s)\n", control->passVariable);
@@ -140,6 +197,8 @@ namespace UBPF {
         emitTableDefinition(builder);
         builder->newline();
         control->emitTableTypes(builder);
+        if (profile != nullptr)
+            profile->emitTypes(builder);
         builder->appendLine("#if CONTROL_PLANE");
         builder->appendLine("static void init_tables() ");
         builder->blockStart();
@@ -147,6 +206,13 @@ namespace UBPF {
         builder->appendFormat("uint32_t %s = 0;", zeroKey.c_str());
         builder->newline();
         control->emitTableInitializers(builder);
+        if (profile != nullptr) {
+            builder->emitIndent();
+            builder->appendFormat("INIT_UBPF_TABLE(\"%s\", sizeof(uint32_t), "
+                                  "sizeof(struct %s));", profile->mapName.c_str(),
+                                  profile->counterTypeName.c_str());
+            builder->newline();
+        }
         builder->blockEnd(true);
         builder->appendLine("#endif");
         builder->appendLine("#endif");
@@ -276,6 +342,11 @@ namespace UBPF {
         builder->emitIndent();
         builder->appendFormat("int %s = -1;", packetTruncatedSizeVar.c_str());
         builder->newline();
+
+        deparser->emitHeaderPositions(builder);
+
+        if (profile != nullptr)
+            profile->emitLocalVariables(builder);
     }
 
     void UBPFProgram::emitPipeline(EBPF::CodeBuilder *builder) {
@@ -285,6 +356,8 @@ namespace UBPF {
         builder->newline();
         builder->emitIndent();
         builder->blockStart();
+        if (profile != nullptr)
+            profile->emitProbe(builder, "control");
         control->emit(builder);
         builder->blockEnd(true);
     }
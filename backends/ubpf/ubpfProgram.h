@@ -73,6 +73,7 @@ namespace UBPF {
         void emitMetadataInstance(EBPF::CodeBuilder *builder) const;
         void emitLocalVariables(EBPF::CodeBuilder *builder) override;
         void emitPipeline(EBPF::CodeBuilder *builder) override;
+        void buildProfileCounters() override;
     };
 
 }
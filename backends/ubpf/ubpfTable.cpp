@@ -22,6 +22,7 @@ limitations under the License.
 #include "frontends/p4/coreLibrary.h"
 #include "frontends/p4/methodInstance.h"
 #include "ubpfControl.h"
+#include "backends/ebpf/ebpfProfile.h"
 
 namespace UBPF {
 
@@ -292,7 +293,8 @@ void UBPFTable::emitKeyType(EBPF::CodeBuilder *builder) {
             if (matchType->name.name != P4::P4CoreLibrary::instance.exactMatch.name &&
                 matchType->name.name != P4::P4CoreLibrary::instance.lpmMatch.name)
                 ::error(ErrorType::ERR_UNSUPPORTED_ON_TARGET,
-                        "Match of type %1% not supported", c->matchType);
+                        "Match of type %1% not supported; uBPF tables only match "
+                        "exact and lpm keys", c->matchType);
             key_idx++;
         }
     }
@@ -429,6 +431,9 @@ void UBPFTable::emitAction(EBPF::CodeBuilder *builder, cstring valueName) {
         builder->newline();
         builder->emitIndent();
         builder->blockStart();
+        if (program->profile != nullptr)
+            program->profile->emitProbe(builder,
+                                        EBPF::ProfileCounters::action(instanceName, name));
         builder->emitIndent();
 
         UbpfActionTranslationVisitor visitor(valueName, program);
@@ -77,12 +77,12 @@ endmacro(p4c_test_set_name)
 #   - p4test is the name of the p4 program to test (path relative to the p4c directory)
 #   - args is a list of arguments to pass to the test
 #
-# It generates a ${p4name}.test file invoking ${driver} on the p4
+# It generates a ${alias}.test file invoking ${driver} on the p4
 # program with command line arguments ${args}
 # Sets the timeout on tests at 300s (for the slow Travis machines)
 #
 macro(p4c_add_test_with_args tag driver isXfail alias p4test test_args cmake_args)
-  set(__testfile "${P4C_BINARY_DIR}/${tag}/${p4test}.test")
+  set(__testfile "${P4C_BINARY_DIR}/${tag}/${alias}.test")
   file (WRITE  ${__testfile} "#! /usr/bin/env bash\n")
   file (APPEND ${__testfile} "# Generated file, modify with care\n\n")
   file (APPEND ${__testfile} "cd ${P4C_BINARY_DIR}\n")
@@ -91,7 +91,7 @@ macro(p4c_add_test_with_args tag driver isXfail alias p4test test_args cmake_arg
   p4c_test_set_name(__testname ${tag} ${alias})
   separate_arguments(__args UNIX_COMMAND ${cmake_args})
   add_test (NAME ${__testname}
-    COMMAND ${tag}/${p4test}.test ${__args}
+    COMMAND ${tag}/${alias}.test ${__args}
     WORKING_DIRECTORY ${P4C_BINARY_DIR})
   if (NOT DEFINED ${tag}_timeout)
     set (${tag}_timeout 300)
@@ -191,6 +191,21 @@ ParserOptions::ParserOptions() : Util::Options(defaultMessage) {
             return true;
         },
         "Set the maximum number of errors to display before failing.");
+    registerOption(
+        "--diagnostics-format", "{text|json}",
+        [](const char* arg) {
+            if (!strcmp(arg, "text")) {
+                P4CContext::get().errorReporter().setDiagnosticFormat(DiagnosticFormat::Text);
+            } else if (!strcmp(arg, "json")) {
+                P4CContext::get().errorReporter().setDiagnosticFormat(DiagnosticFormat::Json);
+            } else {
+                ::error(ErrorType::ERR_INVALID, "Illegal diagnostics format %1%", arg);
+                return false;
+            }
+            return true;
+        },
+        "Select how warnings and errors are printed: as human-readable text (the\n"
+        "default), or as one JSON object per line for consumption by tools.");
     registerOption(
         "-T", "loglevel",
         [](const char* arg) {
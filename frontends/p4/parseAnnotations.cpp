@@ -45,6 +45,13 @@ ParseAnnotations::HandlerMap ParseAnnotations::standardHandlers() {
 
             // @match has an expression argument
             PARSE(IR::Annotation::matchAnnotation, Expression),
+
+            // @flow_cache has an optional argument, the number of cache entries
+            { IR::Annotation::flowCacheAnnotation, [](IR::Annotation* annotation) {
+                    return annotation->body.empty() ||
+                           ParseAnnotations::parseConstantList(annotation);
+                }
+            },
         };
 }
 
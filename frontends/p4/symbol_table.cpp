@@ -53,6 +53,10 @@ class NamedSymbol {
         return typeid(*this) == typeid(*other);
     }
     virtual const Namespace *symNamespace() const;
+    // Cheap replacements for dynamic_cast in lookupIdentifier, which the
+    // lexer calls for every identifier in the program.
+    virtual bool isObject() const { return false; }
+    virtual bool isType() const { return false; }
 
     bool template_args = false;  // does the symbol expect template args
 };
@@ -120,6 +124,7 @@ class Object : public NamedSymbol {
     Object(cstring name, Util::SourceInfo si) : NamedSymbol(name, si) {}
     cstring toString() const override { return cstring("Object ") + getName(); }
     const Namespace *symNamespace() const override { return typeNamespace; }
+    bool isObject() const override { return true; }
     void setNamespace(const Namespace *ns) { typeNamespace = ns; }
 };
 
@@ -127,6 +132,7 @@ class SimpleType : public NamedSymbol {
  public:
     SimpleType(cstring name, Util::SourceInfo si) : NamedSymbol(name, si) {}
     cstring toString() const { return cstring("SimpleType ") + getName(); }
+    bool isType() const override { return true; }
 };
 
 // A Type that is also a namespace (e.g., a parser)
@@ -135,6 +141,7 @@ class ContainerType : public Namespace {
     ContainerType(cstring name, Util::SourceInfo si, bool allowDuplicates) :
             Namespace(name, si, allowDuplicates) {}
     cstring toString() const { return cstring("ContainerType ") + getName(); }
+    bool isType() const override { return true; }
 };
 
 /////////////////////////////////////////////////
@@ -249,17 +256,17 @@ NamedSymbol* ProgramStructure::lookup(cstring identifier) {
 
 ProgramStructure::SymbolKind ProgramStructure::lookupIdentifier(cstring identifier) {
     NamedSymbol* ns = lookup(identifier);
-    if (ns == nullptr || dynamic_cast<Object*>(ns) != nullptr) {
+    if (ns == nullptr || ns->isObject()) {
         LOG2("Identifier " << identifier);
         if (ns && ns->template_args)
             return ProgramStructure::SymbolKind::TemplateIdentifier;
         return ProgramStructure::SymbolKind::Identifier;
     }
-    if (dynamic_cast<SimpleType*>(ns) != nullptr || dynamic_cast<ContainerType*>(ns) != nullptr) {
-        if (ns && ns->template_args)
+    if (ns->isType()) {
+        LOG2("Type " << identifier);
+        if (ns->template_args)
             return ProgramStructure::SymbolKind::TemplateType;
         return ProgramStructure::SymbolKind::Type;
-        LOG2("Type " << identifier);
     }
     BUG("Should be unreachable");
 }
@@ -44,6 +44,30 @@ void PassManager::listPasses(std::ostream &out, cstring sep) const {
         first = false; }
 }
 
+namespace {
+
+/// Collects the children of the root node, looking through child vectors.
+class TopLevelDeclarations : public Inspector {
+    std::vector<const IR::Node *> &decls;
+    bool preorder(const IR::Node *n) override {
+        auto ctxt = getContext();
+        if (!ctxt) return true;  // the root itself
+        if (!ctxt->parent && n->is<IR::VectorBase>()) return true;
+        decls.push_back(n);
+        return false; }
+
+ public:
+    explicit TopLevelDeclarations(std::vector<const IR::Node *> &decls) : decls(decls) {}
+};
+
+std::vector<const IR::Node *> topLevelDeclarations(const IR::Node *root) {
+    std::vector<const IR::Node *> decls;
+    root->apply(TopLevelDeclarations(decls));
+    return decls;
+}
+
+}  // namespace
+
 const IR::Node *PassManager::apply_visitor(const IR::Node *program, const char *) {
     safe_vector<std::pair<safe_vector<Visitor *>::iterator, const IR::Node *>> backup;
     static indent_t log_indent(-1);
@@ -61,6 +85,14 @@ const IR::Node *PassManager::apply_visitor(const IR::Node *program, const char *
         if (auto b = dynamic_cast<Backtrack *>(v)) {
             if (!b->never_backtracks()) {
                 backup.emplace_back(it, program); } }
+        // Forward the converged declarations of an enclosing incremental
+        // PassRepeated to this pass only; the pass may be applied elsewhere.
+        struct skip_nodes_scope {
+            Visitor *v;
+            skip_nodes_scope(Visitor *v, const std::unordered_set<const IR::Node *> *nodes)
+                : v(v) { v->skipNodes = nodes; }
+            ~skip_nodes_scope() { v->skipNodes = nullptr; }
+        } forward_skip_nodes(v, skipNodes);
         try {
             try {
                 LOG1(log_indent << name() << " invoking " << v->name());
@@ -127,19 +159,41 @@ const IR::Node *PassRepeated::apply_visitor(const IR::Node *program, const char
     bool done = false;
     unsigned iterations = 0;
     unsigned initial_error_count = ::errorCount();
+    auto *inherited = skipNodes;
+    std::unordered_set<const IR::Node *> converged;
+    std::vector<const IR::Node *> before;
     while (!done) {
         LOG5("PassRepeated state is:\n" << dumpToString(program));
         running = true;
+        if (incremental)
+            before = topLevelDeclarations(program);
         auto newprogram = PassManager::apply_visitor(program, name);
         if (program == newprogram || newprogram == nullptr)
             done = true;
-        if (stop_on_error && ::errorCount() > initial_error_count)
-            return program;
+        if (stop_on_error && ::errorCount() > initial_error_count) {
+            skipNodes = inherited;
+            return program; }
         iterations++;
         if (repeats != 0 && iterations > repeats)
             done = true;
+        if (incremental && !done) {
+            // IR nodes are immutable, so a declaration that is still the same
+            // node after an iteration was left alone by every pass, and
+            // (per the contract of setIncremental) will be left alone again
+            // unless a pass asks for it through visitConverged.
+            std::unordered_set<const IR::Node *> old(before.begin(), before.end());
+            converged.clear();
+            if (inherited)
+                converged.insert(inherited->begin(), inherited->end());
+            for (auto decl : topLevelDeclarations(newprogram))
+                if (old.count(decl))
+                    converged.insert(decl);
+            LOG2(this->name() << " iteration " << iterations << ": " << converged.size() <<
+                 " of " << old.size() << " declarations converged");
+            skipNodes = &converged; }
         program = newprogram;
     }
+    skipNodes = inherited;
     return program;
 }
 
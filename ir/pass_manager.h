@@ -110,12 +110,23 @@ class OnBacktrack : virtual public Visitor, virtual public Backtrack {
 // Repeat a pass until convergence (or up to a fixed number of repeats)
 class PassRepeated : virtual public PassManager {
     unsigned            repeats;  // 0 = until convergence
+    bool                incremental = false;
  public:
     PassRepeated() : repeats(0) {}
     PassRepeated(const std::initializer_list<VisitorRef> &init) :
             PassManager(init), repeats(0) {}
     const IR::Node *apply_visitor(const IR::Node *, const char * = 0) override;
     PassRepeated *setRepeats(unsigned repeats) { this->repeats = repeats; return this; }
+    // In incremental mode, top-level declarations (children of the root, looking
+    // through vectors) that come out of an iteration unchanged are not visited
+    // again by the Modifiers and Transforms of later iterations; Inspectors
+    // still see the whole program.  This is only correct if every repeated
+    // Modifier and Transform rewrites a declaration based on the contents of
+    // that declaration, plus information it checks in Visitor::visitConverged.
+    // Passes that re-analyze the whole program (e.g. TypeChecking) must not be
+    // repeated this way.
+    PassRepeated *setIncremental(bool incremental = true) {
+        this->incremental = incremental; return this; }
     PassRepeated *clone() const override { return new PassRepeated(*this); }
 };
 
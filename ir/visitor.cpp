@@ -248,7 +248,7 @@ class ForwardChildren : public Visitor {
 
 const IR::Node *Modifier::apply_visitor(const IR::Node *n, const char *name) {
     if (ctxt) ctxt->child_name = name;
-    if (n) {
+    if (n && !skipVisit(n)) {
         PushContext local(ctxt, n);
         if (visited->done(n)) {
             n->apply_visitor_revisit(*this, visited->result(n));
@@ -302,7 +302,7 @@ const IR::Node *Inspector::apply_visitor(const IR::Node *n, const char *name) {
 
 const IR::Node *Transform::apply_visitor(const IR::Node *n, const char *name) {
     if (ctxt) ctxt->child_name = name;
-    if (n) {
+    if (n && !skipVisit(n)) {
         PushContext local(ctxt, n);
         if (visited->done(n)) {
             n->apply_visitor_revisit(*this, visited->result(n));
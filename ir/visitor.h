@@ -19,6 +19,7 @@ limitations under the License.
 
 #include <stdexcept>
 #include <unordered_map>
+#include <unordered_set>
 #include "lib/cstring.h"
 #include "ir/ir.h"
 #include "lib/exceptions.h"
@@ -58,6 +59,13 @@ class Visitor {
 
     mutable cstring internalName;
 
+    // Nodes in this set are returned unchanged without being visited by
+    // Modifier and Transform, unless visitConverged() asks for them.  Set by an
+    // incremental PassRepeated (and forwarded by PassManager) to skip top-level
+    // declarations that have already converged.  Inspectors still visit every
+    // node, so they can collect information about the whole program.
+    const std::unordered_set<const IR::Node *> *skipNodes = nullptr;
+
     // init_apply is called (once) when apply is called on an IR tree
     // it expects to allocate a profile record which will be destroyed
     // when the traversal completes.  Visitor subclasses may extend this
@@ -246,6 +254,12 @@ class Visitor {
     // preorder and postorder functions
     void visitOnce() const { *visitCurrentOnce = true; }
     void visitAgain() const { *visitCurrentOnce = false; }
+    bool skipVisit(const IR::Node *n) const {
+        return skipNodes && skipNodes->count(n) && !visitConverged(n); }
+    // Called for a node in skipNodes; a pass whose rewrite of a converged
+    // declaration also depends on information collected elsewhere in the
+    // program returns true when that information changed.
+    virtual bool visitConverged(const IR::Node *) const { return false; }
 
  private:
     virtual void visitor_const_error();
@@ -1,5 +1,44 @@
 #include "error_message.h"
 
+#include <string>
+
+namespace {
+
+/// Append @str to @out as a quoted JSON string.
+void appendJsonString(std::string &out, const std::string &str) {
+    static const char hexDigits[] = "0123456789abcdef";
+    out += '"';
+    for (unsigned char c : str) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    out += "\\u00";
+                    out += hexDigits[c >> 4];
+                    out += hexDigits[c & 0xf];
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+void appendJsonLocation(std::string &out, const Util::SourceInfo &info) {
+    auto position = info.toPosition();
+    out += "{\"file\":";
+    appendJsonString(out, position.fileName.isNullOrEmpty() ? "" : position.fileName.c_str());
+    out += ",\"line\":" + std::to_string(position.sourceLine);
+    out += ",\"column\":" + std::to_string(info.getStart().getColumnNumber());
+    out += "}";
+}
+
+}  // namespace
+
 std::string ErrorMessage::getPrefix() const {
     std::string p = prefix;
     if (type == MessageType::Error) {
@@ -40,3 +79,36 @@ std::string ParserErrorMessage::toString() const {
     return std::string(location.toPositionString().c_str()) + ":" + message + "\n" +
            location.toSourceFragment().c_str();
 }
+
+std::string ErrorMessage::toJSON() const {
+    std::string result = "{\"type\":";
+    switch (type) {
+        case MessageType::Error: result += "\"error\""; break;
+        case MessageType::Warning: result += "\"warning\""; break;
+        default: result += "\"info\""; break;
+    }
+    result += ",\"name\":";
+    appendJsonString(result, prefix);
+    result += ",\"message\":";
+    appendJsonString(result, message + suffix);
+    result += ",\"locations\":[";
+    bool first = true;
+    for (auto &location : locations) {
+        if (!location.isValid()) continue;
+        if (!first) result += ",";
+        first = false;
+        appendJsonLocation(result, location);
+    }
+    result += "]}";
+    return result;
+}
+
+std::string ParserErrorMessage::toJSON() const {
+    std::string result = "{\"type\":\"error\",\"name\":\"parser\",\"message\":";
+    appendJsonString(result, message.isNullOrEmpty() ? "" : message.c_str());
+    result += ",\"locations\":[";
+    if (location.isValid())
+        appendJsonLocation(result, location);
+    result += "]}";
+    return result;
+}
@@ -55,6 +55,8 @@ struct ErrorMessage {
 
     std::string getPrefix() const;
     std::string toString() const;
+    /// Serialize to a single-line JSON object (used by --diagnostics-format=json).
+    std::string toJSON() const;
 };
 
 /**
@@ -69,6 +71,7 @@ struct ParserErrorMessage {
         : location(loc), message(msg) {}
 
     std::string toString() const;
+    std::string toJSON() const;
 };
 
 #endif  /* _LIB_ERROR_MESSAGE_H_ */
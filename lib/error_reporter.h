@@ -28,6 +28,12 @@ enum class DiagnosticAction {
     Error    /// Print an error and signal that compilation should be aborted.
 };
 
+/// The format in which diagnostics are written to the output stream.
+enum class DiagnosticFormat {
+    Text,    /// Human-readable messages with source fragments (the default).
+    Json     /// One JSON object per line, for consumption by tools.
+};
+
 
 // Keeps track of compilation errors.
 // Errors are specified using the error() and warning() methods,
@@ -43,15 +49,31 @@ class ErrorReporter {
 
     /// Output the message and flush the stream
     virtual void emit_message(const ErrorMessage &msg) {
-        *outputstream << msg.toString();
+        if (diagnosticFormat == DiagnosticFormat::Json)
+            *outputstream << msg.toJSON() << std::endl;
+        else
+            *outputstream << msg.toString();
         outputstream->flush();
     }
 
     virtual void emit_message(const ParserErrorMessage &msg) {
-        *outputstream << msg.toString();
+        if (diagnosticFormat == DiagnosticFormat::Json)
+            *outputstream << msg.toJSON() << std::endl;
+        else
+            *outputstream << msg.toString();
         outputstream->flush();
     }
 
+    /// @return true if a diagnostic with the given (already resolved) action
+    /// would not be printed. This is checked before any deduplication or
+    /// formatting work is done, so suppressed diagnostics are almost free.
+    bool is_suppressed(DiagnosticAction action) const {
+        if (action == DiagnosticAction::Ignore) return true;
+        // Avoid burying errors in a pile of warnings: don't emit any more warnings if we've
+        // emitted errors.
+        return action == DiagnosticAction::Warn && errorCount > 0;
+    }
+
     /// Check whether an error has already been reported, by keeping track of error type
     /// and source info.
     /// If the error has been reported, return true. Otherwise, insert add the error to the
@@ -71,7 +93,8 @@ class ErrorReporter {
         : errorCount(0),
           warningCount(0),
           maxErrorCount(20),
-          defaultWarningDiagnosticAction(DiagnosticAction::Warn)
+          defaultWarningDiagnosticAction(DiagnosticAction::Warn),
+          diagnosticFormat(DiagnosticFormat::Text)
     { outputstream = &std::cerr; }
 
     // error message for a bug
@@ -95,14 +118,13 @@ class ErrorReporter {
               typename... Args>
     void diagnose(DiagnosticAction action, const int errorCode, const char *format,
                   const char* suffix, const T *node, Args... args) {
-        if (!error_reported(errorCode, node->getSourceInfo())) {
-            const char *name = get_error_name(errorCode);
-            auto da = getDiagnosticAction(name, action);
-            if (name)
-                diagnose(da, name, format, suffix, node, args...);
-            else
-                diagnose(action, nullptr, format, suffix, node, std::forward<Args>(args)...);
-        }
+        const char *name = get_error_name(errorCode);
+        auto da = name ? getDiagnosticAction(name, action) : action;
+        // Filter before touching the deduplication set, so that ignored
+        // diagnostics neither format their arguments nor grow errorTracker.
+        if (is_suppressed(da)) return;
+        if (!error_reported(errorCode, node->getSourceInfo()))
+            diagnose(da, name, format, suffix, node, std::forward<Args>(args)...);
     }
 
     template <class T,
@@ -118,11 +140,9 @@ class ErrorReporter {
     void diagnose(DiagnosticAction action, const int errorCode, const char *format,
                   const char* suffix, Args... args) {
         const char *name = get_error_name(errorCode);
-        auto da = getDiagnosticAction(name, action);
-        if (name)
-            diagnose(da, name, format, suffix, args...);
-        else
-            diagnose(action, nullptr, format, suffix, std::forward<Args>(args)...);
+        auto da = name ? getDiagnosticAction(name, action) : action;
+        if (is_suppressed(da)) return;
+        diagnose(da, name, format, suffix, std::forward<Args>(args)...);
     }
 
     /// The sink of all the diagnostic functions. Here the error gets printed
@@ -130,14 +150,10 @@ class ErrorReporter {
     template <typename... T>
     void diagnose(DiagnosticAction action, const char* diagnosticName,
                   const char* format, const char* suffix, T... args) {
-        if (action == DiagnosticAction::Ignore) return;
+        if (is_suppressed(action)) return;
 
         ErrorMessage::MessageType msgType = ErrorMessage::MessageType::None;
         if (action == DiagnosticAction::Warn) {
-            // Avoid burying errors in a pile of warnings: don't emit any more warnings if we've
-            // emitted errors.
-            if (errorCount > 0) return;
-
             warningCount++;
             msgType = ErrorMessage::MessageType::Warning;
         } else if (action == DiagnosticAction::Error) {
@@ -175,6 +191,11 @@ class ErrorReporter {
 
     std::ostream* getOutputStream() const { return outputstream; }
 
+    DiagnosticFormat getDiagnosticFormat() const { return diagnosticFormat; }
+
+    /// Select how diagnostics are rendered on the output stream.
+    void setDiagnosticFormat(DiagnosticFormat format) { diagnosticFormat = format; }
+
     /// Reports an error @message at @location. This allows us to use the
     /// position information provided by Bison.
     template <typename T>
@@ -247,6 +268,9 @@ class ErrorReporter {
     /// The default diagnostic action for calls to `::warning()`.
     DiagnosticAction defaultWarningDiagnosticAction;
 
+    /// How diagnostics are written to outputstream.
+    DiagnosticFormat diagnosticFormat;
+
     /// allow filtering of diagnostic actions
     std::unordered_map<cstring, DiagnosticAction> diagnosticActions;
 };
@@ -41,6 +41,7 @@ namespace Detail {
 
 int verbosity = 0;
 int maximumLogLevel = 0;
+int logLevelGeneration = 0;
 
 // The time at which logging was initialized; used so that log messages can have
 // relative rather than absolute timestamps.
@@ -272,6 +273,7 @@ void invalidateCaches(int possibleNewMaxLogLevel) {
     mostRecentInfo = nullptr;
     logLevelCache.clear();
     maximumLogLevel = std::max(maximumLogLevel, possibleNewMaxLogLevel);
+    ++logLevelGeneration;
     for (auto fn : invalidateCallbacks) fn();
 }
 
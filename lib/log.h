@@ -37,6 +37,10 @@ extern int verbosity;
 // A cache of the maximum log level requested for any file.
 extern int maximumLogLevel;
 
+// Incremented whenever the log levels change (-T or -v); used to validate
+// the per call site caches below.
+extern int logLevelGeneration;
+
 // Look up the log level of @file.
 int fileLogLevel(const char* file);
 std::ostream &fileLogOutput(const char *file);
@@ -60,6 +64,25 @@ class OutputLogPrefix {
 };
 
 void addInvalidateCallback(void (*)(void));
+
+// The log level of a single LOG call site.  Every LOGn statement owns a static
+// instance, so the per-file lookup in fileLogLevel() is done once per call site
+// and redone only after the log levels have been changed, instead of on every
+// execution of the statement.  The struct is constant-initialized, so the
+// static does not need a guard.  The cache is not synchronized, so it is left
+// out of MULTITHREAD builds, which go through the locked per-file cache.
+#ifndef MULTITHREAD
+struct CallSiteLogLevel {
+    int generation = -1;
+    int level = 0;
+
+    bool isAtLeast(const char* file, int l) {
+        if (generation != logLevelGeneration) {
+            level = fileLogLevel(file);
+            generation = logLevelGeneration; }
+        return level >= l; }
+};
+#endif  // !MULTITHREAD
 }  // namespace Detail
 
 inline std::ostream &endl(std::ostream &out) {
@@ -87,11 +110,22 @@ void increaseVerbosity();
 }  // namespace Log
 
 #ifndef MAX_LOGGING_LEVEL
-// can be set on build command line and disables higher logging levels at compile time
+// can be set on build command line and disables higher logging levels at compile time;
+// LOG statements above this level are constant-folded away together with their arguments
 #define MAX_LOGGING_LEVEL 10
 #endif
 
+// The maximumLogLevel test keeps the common case (logging disabled) to a single load;
+// otherwise the level of the call site is cached in a function-local static, except
+// in MULTITHREAD builds.
+#ifdef MULTITHREAD
 #define LOGGING(N) ((N) <= MAX_LOGGING_LEVEL && ::Log::fileLogLevelIsAtLeast(__FILE__, N))
+#else
+#define LOGGING(N) ((N) <= MAX_LOGGING_LEVEL && ::Log::Detail::maximumLogLevel >= (N) &&    \
+                    []() -> ::Log::Detail::CallSiteLogLevel & {                             \
+                        static ::Log::Detail::CallSiteLogLevel site;                        \
+                        return site; }().isAtLeast(__FILE__, N))
+#endif  // MULTITHREAD
 #define LOGN(N, X) (LOGGING(N)                                                  \
                       ? ::Log::Detail::fileLogOutput(__FILE__)                  \
                           << ::Log::Detail::OutputLogPrefix(__FILE__, N)        \
@@ -17,6 +17,7 @@ limitations under the License.
 #include <sstream>
 
 #include <algorithm>
+#include <cstring>
 #include "source_file.h"
 #include "exceptions.h"
 #include "lib/log.h"
@@ -93,20 +94,19 @@ void InputSources::appendToLastLine(StringRef text) {
     if (sealed)
         BUG("Appending to sealed InputSources");
     // Text should not contain any newline characters
-    for (size_t i = 0; i < text.len; i++) {
-        char c = text[i];
-        if (c == '\n')
-            BUG("Text contains newlines");
-    }
-    contents.back() += text.toString();
+    if (memchr(text.p, '\n', text.len))
+        BUG("Text contains newlines");
+    // Append the raw bytes; this is called for every token read by the
+    // lexers, so going through cstring would intern each token's text.
+    contents.back().append(text.p, text.len);
 }
 
 // Append a newline and start a new line
 void InputSources::appendNewline(StringRef newline) {
     if (sealed)
         BUG("Appending to sealed InputSources");
-    contents.back() += newline.toString();
-    contents.push_back("");  // start a new line
+    contents.back().append(newline.p, newline.len);
+    contents.emplace_back();  // start a new line
 }
 
 void InputSources::appendText(const char* text) {
@@ -0,0 +1,347 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "flowCache.h"
+#include "frontends/p4/methodInstance.h"
+
+namespace P4 {
+
+const unsigned FindFlowCacheRegions::defaultSize = 1024;
+
+namespace {
+
+/// Collects the fields read and written by a statement or an expression,
+/// including by the keys and the actions of the tables it applies, and the
+/// first construct which prevents caching.
+class FieldAccesses : public Inspector {
+    ReferenceMap* refMap;
+    TypeMap* typeMap;
+    const std::set<const IR::IDeclaration*> &fields;
+    const std::set<cstring> &statelessProperties;
+
+    /// The declaration a field, a slice or an element of a field belongs to.
+    const IR::IDeclaration* root(const IR::Expression* expression) const {
+        while (true) {
+            if (auto m = expression->to<IR::Member>())
+                expression = m->expr;
+            else if (auto s = expression->to<IR::Slice>())
+                expression = s->e0;
+            else if (auto a = expression->to<IR::ArrayIndex>())
+                expression = a->left;
+            else
+                break;
+        }
+        auto path = expression->to<IR::PathExpression>();
+        if (path == nullptr)
+            return nullptr;
+        return refMap->getDeclaration(path->path, false);
+    }
+    bool isField(const IR::Expression* expression) const {
+        auto e = expression;
+        while (auto m = e->to<IR::Member>())
+            e = m->expr;
+        if (!e->is<IR::PathExpression>())
+            return false;
+        auto decl = root(e);
+        return decl != nullptr && fields.count(decl) != 0;
+    }
+    bool hasSupportedType(const IR::Expression* field) {
+        auto type = typeMap->getType(field);
+        if (type != nullptr && (type->is<IR::Type_Bits>() || type->is<IR::Type_Boolean>()))
+            return true;
+        fail(field, "accesses a value which is not a bit<N>, int<N> or bool field");
+        return false;
+    }
+    void fail(const IR::Node* node, cstring why) {
+        if (unsupported != nullptr)
+            return;
+        unsupported = node;
+        reason = why;
+    }
+    void table(const IR::P4Table* t) {
+        if (std::find(tables.begin(), tables.end(), t) == tables.end())
+            tables.push_back(t);
+        for (auto p : t->properties->properties) {
+            auto name = p->name.name;
+            if (name != IR::TableProperties::keyPropertyName &&
+                name != IR::TableProperties::actionsPropertyName &&
+                name != IR::TableProperties::defaultActionPropertyName &&
+                name != IR::TableProperties::entriesPropertyName &&
+                name != IR::TableProperties::sizePropertyName &&
+                statelessProperties.count(name) == 0)
+                fail(p, "applies a table with a property which may keep state");
+        }
+        if (auto key = t->getKey()) {
+            for (auto k : key->keyElements)
+                visit(k->expression);
+        }
+        for (auto ale : t->getActionList()->actionList) {
+            if (auto mce = ale->expression->to<IR::MethodCallExpression>())
+                visit(mce->arguments);
+            auto decl = refMap->getDeclaration(ale->getPath(), true);
+            if (auto action = decl->to<IR::P4Action>())
+                visit(action->body);
+        }
+    }
+
+ public:
+    std::vector<const IR::Expression*> reads;
+    std::vector<const IR::Expression*> writes;
+    std::vector<const IR::P4Table*> tables;
+    const IR::Node* unsupported = nullptr;
+    cstring reason;
+
+    FieldAccesses(ReferenceMap* refMap, TypeMap* typeMap,
+                  const std::set<const IR::IDeclaration*> &fields,
+                  const std::set<cstring> &statelessProperties) :
+            refMap(refMap), typeMap(typeMap), fields(fields),
+            statelessProperties(statelessProperties)
+    { setName("FieldAccesses"); visitDagOnce = false; }
+
+    bool preorder(const IR::PathExpression* expression) override {
+        if (isField(expression) && hasSupportedType(expression))
+            reads.push_back(expression);
+        return false;
+    }
+    bool preorder(const IR::Member* expression) override {
+        if (!isField(expression))
+            return true;
+        if (hasSupportedType(expression))
+            reads.push_back(expression);
+        return false;
+    }
+    bool preorder(const IR::AssignmentStatement* statement) override {
+        auto left = statement->left;
+        if (isField(left)) {
+            if (hasSupportedType(left))
+                writes.push_back(left);
+        } else if (fields.count(root(left)) != 0) {
+            fail(left, "writes part of a field");
+        } else {
+            // a local variable of an action
+            visit(left);
+        }
+        visit(statement->right);
+        return false;
+    }
+    bool preorder(const IR::MethodCallExpression* expression) override {
+        auto mi = MethodInstance::resolve(expression, refMap, typeMap);
+        if (auto am = mi->to<ApplyMethod>()) {
+            if (am->isTableApply()) {
+                table(am->object->to<IR::P4Table>());
+                return false;
+            }
+        } else if (auto ac = mi->to<ActionCall>()) {
+            for (auto p : ac->action->parameters->parameters) {
+                if (p->direction == IR::Direction::Out || p->direction == IR::Direction::InOut)
+                    fail(expression, "calls an action with out or inout parameters");
+            }
+            visit(expression->arguments);
+            visit(ac->action->body);
+            return false;
+        }
+        fail(expression, "calls an extern, a built-in method or a control");
+        return false;
+    }
+    bool preorder(const IR::ExitStatement* statement) override {
+        fail(statement, "exits the control");
+        return false;
+    }
+};
+
+}  // namespace
+
+const Definitions* FindFlowCacheRegions::after(const IR::Node* node) const {
+    return definitions->getDefinitions(ProgramPoint(node));
+}
+
+const LocationSet* FindFlowCacheRegions::location(const IR::Expression* field) const {
+    if (auto m = field->to<IR::Member>()) {
+        auto base = location(m->expr);
+        return base == nullptr ? nullptr : base->getField(m->member.name);
+    }
+    auto path = field->to<IR::PathExpression>();
+    if (path == nullptr)
+        return nullptr;
+    auto decl = refMap->getDeclaration(path->path, false);
+    if (decl == nullptr)
+        return nullptr;
+    auto storage = definitions->storageMap->getStorage(decl);
+    return storage == nullptr ? nullptr : new LocationSet(storage);
+}
+
+bool FindFlowCacheRegions::fromOutside(const IR::Expression* field,
+                                       const Definitions* defs) const {
+    if (defs == nullptr)
+        return true;
+    auto loc = location(field);
+    if (loc == nullptr)
+        return true;
+    for (auto l : *loc->canonicalize()) {
+        auto base = l->to<BaseLocation>();
+        if (!defs->hasLocation(base))
+            return true;
+        for (auto point : *defs->getPoints(base)) {
+            // Calls are analyzed in the context of the call, so the
+            // first node of a point is a statement or an expression
+            // of the control body.
+            if (point.isBeforeStart() || regionNodes.count(*point.begin()) == 0)
+                return true;
+        }
+    }
+    return false;
+}
+
+namespace {
+void addField(std::vector<const IR::Expression*> &fields, const IR::Expression* field) {
+    for (auto f : fields) {
+        if (f->toString() == field->toString())
+            return;
+    }
+    fields.push_back(field);
+}
+}  // namespace
+
+bool FindFlowCacheRegions::accesses(const IR::Node* node, const Definitions* defs,
+                                    FlowCacheRegion* region) {
+    FieldAccesses fa(refMap, typeMap, fields, statelessProperties);
+    (void)node->apply(fa);
+    if (fa.unsupported != nullptr) {
+        ::warning(ErrorType::WARN_UNSUPPORTED,
+                  "%1%: %2%; the @flow_cache region is not cached", fa.unsupported, fa.reason);
+        return false;
+    }
+    for (auto r : fa.reads) {
+        if (fromOutside(r, defs))
+            addField(region->key, r);
+    }
+    for (auto w : fa.writes)
+        addField(region->value, w);
+    for (auto t : fa.tables) {
+        if (std::find(region->tables.begin(), region->tables.end(), t) == region->tables.end())
+            region->tables.push_back(t);
+    }
+    return true;
+}
+
+// Follows the structure of ComputeWriteSet, which records the definitions
+// after each statement, after the condition of an if statement and after the
+// expression of a switch statement.
+bool FindFlowCacheRegions::statement(const IR::StatOrDecl* s, const Definitions* defs,
+                                     FlowCacheRegion* region) {
+    if (auto block = s->to<IR::BlockStatement>()) {
+        for (auto c : block->components) {
+            if (!statement(c, defs, region))
+                return false;
+            if (c->is<IR::Statement>())
+                defs = after(c);
+        }
+        return true;
+    } else if (auto ifs = s->to<IR::IfStatement>()) {
+        if (!accesses(ifs->condition, defs, region))
+            return false;
+        auto branch = after(ifs->condition);
+        return statement(ifs->ifTrue, branch, region) &&
+               (ifs->ifFalse == nullptr || statement(ifs->ifFalse, branch, region));
+    } else if (auto sw = s->to<IR::SwitchStatement>()) {
+        if (!accesses(sw->expression, defs, region))
+            return false;
+        auto cases = after(sw->expression);
+        for (auto c : sw->cases) {
+            if (c->statement != nullptr && !statement(c->statement, cases, region))
+                return false;
+        }
+        return true;
+    } else if (s->is<IR::ExitStatement>() || s->is<IR::ReturnStatement>()) {
+        ::warning(ErrorType::WARN_UNSUPPORTED,
+                  "%1%: exits the control; the @flow_cache region is not cached", s);
+        return false;
+    } else if (s->is<IR::Declaration>() || s->is<IR::EmptyStatement>()) {
+        return true;
+    }
+    return accesses(s, defs, region);
+}
+
+const FlowCacheRegion* FindFlowCacheRegions::analyze(const IR::BlockStatement* block,
+                                                     const IR::Annotation* annotation) {
+    auto region = new FlowCacheRegion();
+    region->block = block;
+    region->size = defaultSize;
+    if (!annotation->expr.empty()) {
+        auto size = annotation->expr.at(0)->to<IR::Constant>();
+        if (annotation->expr.size() != 1 || size == nullptr ||
+            !size->fitsUint() || size->asUnsigned() == 0) {
+            ::error(ErrorType::ERR_INVALID,
+                    "%1%: expected the number of cache entries", annotation);
+            return nullptr;
+        }
+        region->size = size->asUnsigned();
+    }
+
+    if (definitions == nullptr) {
+        definitions = new AllDefinitions(refMap, typeMap);
+        ComputeWriteSet cws(definitions);
+        (void)control->apply(cws);
+    }
+    regionNodes.clear();
+    forAllMatching<IR::Node>(block, [this](const IR::Node* node) {
+        regionNodes.insert(node);
+    });
+
+    if (!statement(block, nullptr, region))
+        return nullptr;
+    // A field which keeps its value on some path is stored with the value
+    // it had before the block.
+    auto defs = after(block);
+    for (auto f : region->value) {
+        if (fromOutside(f, defs))
+            addField(region->key, f);
+    }
+    if (region->key.empty() || region->value.empty()) {
+        ::warning(ErrorType::WARN_UNSUPPORTED,
+                  "%1%: the region %2%; it is not cached", block,
+                  region->key.empty() ? "reads no field" : "writes no field");
+        return nullptr;
+    }
+    LOG1("Flow cache for " << block << " keyed on " << region->key.size() <<
+         " fields, storing " << region->value.size() << " fields");
+    return region;
+}
+
+bool FindFlowCacheRegions::preorder(const IR::P4Control* c) {
+    control = c;
+    definitions = nullptr;
+    fields.clear();
+    for (auto p : c->getApplyParameters()->parameters)
+        fields.insert(p);
+    for (auto d : c->controlLocals) {
+        if (d->is<IR::Declaration_Variable>())
+            fields.insert(d);
+    }
+    visit(c->body, "body");
+    return false;
+}
+
+bool FindFlowCacheRegions::preorder(const IR::BlockStatement* block) {
+    auto annotation = block->annotations->getSingle(IR::Annotation::flowCacheAnnotation);
+    if (annotation == nullptr || control == nullptr)
+        return true;
+    auto region = analyze(block, annotation);
+    if (region == nullptr)
+        return true;
+    regions.emplace(block, region);
+    return false;
+}
+
+}  // namespace P4
@@ -0,0 +1,120 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef _MIDEND_FLOWCACHE_H_
+#define _MIDEND_FLOWCACHE_H_
+
+#include "ir/ir.h"
+#include "lib/ordered_map.h"
+#include "frontends/p4/def_use.h"
+#include "frontends/p4/typeChecking/typeChecker.h"
+
+namespace P4 {
+
+/// A block of a control which can run behind an exact-match cache.
+struct FlowCacheRegion {
+    /// The block, annotated with @flow_cache.
+    const IR::BlockStatement* block = nullptr;
+    /// Number of cache entries.
+    unsigned size = 0;
+    /// The fields whose values when the block starts determine the values
+    /// of the written fields when it ends, given the table entries.
+    std::vector<const IR::Expression*> key;
+    /// The fields the block may write.
+    std::vector<const IR::Expression*> value;
+    /// The tables the block applies.  The cache must be cleared when their
+    /// entries change.
+    std::vector<const IR::P4Table*> tables;
+};
+
+/**
+ * Finds the blocks annotated with @flow_cache in the body of a control, e.g.
+ *
+ *   @flow_cache(4096) {
+ *       route.apply();
+ *       acl.apply();
+ *   }
+ *
+ * and computes the fields a cache in front of each block is keyed on and
+ * stores.  On a cache hit a back-end restores the stored fields instead of
+ * running the block; on a miss it runs the block and inserts the values of
+ * the fields it wrote.  The fields are the bit<N>, int<N> and bool fields of
+ * the parameters and of the local variables of the control.
+ *
+ * The key holds the fields which the block reads before writing them on
+ * some path, including in table keys and actions, and the fields which the
+ * block writes on some paths only: the cache stores their final value,
+ * which may be their value before the block.  Both follow from the
+ * definitions computed by ComputeWriteSet.
+ *
+ * A block is not cached, with a warning, when the result of running it is
+ * not a function of the key, or running it has other effects; i.e. if it
+ * - calls an extern method or function, a built-in method (isValid,
+ *   setValid, ...) or another control;
+ * - contains an exit or a return statement;
+ * - reads or writes a whole header or struct, or a field of another type;
+ * - writes a slice of a field;
+ * - applies a table with properties other than key, actions,
+ *   default_action, entries, size and the stateless properties given by the
+ *   back-end.  E.g. a direct counter would miss the cache hits.
+ * The cache must be cleared when the control plane changes the entries of
+ * the tables of the block.  A @flow_cache block nested in a cached block is
+ * cached with it.
+ */
+class FindFlowCacheRegions : public Inspector {
+    ReferenceMap* refMap;
+    TypeMap* typeMap;
+    std::set<cstring> statelessProperties;
+
+    const IR::P4Control* control = nullptr;
+    /// The parameters and the local variables of the control.
+    std::set<const IR::IDeclaration*> fields;
+    /// The definitions of the control, computed for the first region.
+    AllDefinitions* definitions = nullptr;
+    /// The nodes of the region being analyzed.
+    std::set<const IR::Node*> regionNodes;
+
+    const Definitions* after(const IR::Node* node) const;
+    const LocationSet* location(const IR::Expression* field) const;
+    /// True if a definition of field in defs, the definitions before a
+    /// statement of the region, may come from before the region.  defs is
+    /// nullptr at the start of the region.
+    bool fromOutside(const IR::Expression* field, const Definitions* defs) const;
+    bool accesses(const IR::Node* node, const Definitions* defs, FlowCacheRegion* region);
+    bool statement(const IR::StatOrDecl* s, const Definitions* defs, FlowCacheRegion* region);
+    const FlowCacheRegion* analyze(const IR::BlockStatement* block,
+                                   const IR::Annotation* annotation);
+
+ public:
+    /// Number of cache entries of a @flow_cache block without argument.
+    static const unsigned defaultSize;
+
+    /// The regions which can be cached, for each of their blocks.
+    ordered_map<const IR::BlockStatement*, const FlowCacheRegion*> regions;
+
+    FindFlowCacheRegions(ReferenceMap* refMap, TypeMap* typeMap,
+                         std::set<cstring> statelessProperties = {}) :
+            refMap(refMap), typeMap(typeMap), statelessProperties(statelessProperties)
+    { CHECK_NULL(refMap); CHECK_NULL(typeMap); setName("FindFlowCacheRegions"); }
+
+    const FlowCacheRegion* getRegion(const IR::BlockStatement* block) const
+    { return ::get(regions, block); }
+
+    bool preorder(const IR::P4Control* control) override;
+    bool preorder(const IR::BlockStatement* block) override;
+};
+
+}  // namespace P4
+
+#endif /* _MIDEND_FLOWCACHE_H_ */
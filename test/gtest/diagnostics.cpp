@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <sstream>
 #include <vector>
 
 #include <boost/algorithm/string/replace.hpp>
@@ -267,4 +268,30 @@ TEST_F(Diagnostics, CompilerOptions) {
     }
 }
 
+TEST_F(Diagnostics, JsonFormat) {
+    AutoCompileContext autoContext(new GTestContext);
+    std::stringstream output;
+    auto& reporter = GTestContext::get().errorReporter();
+    reporter.setOutputStream(&output);
+
+    auto& options = GTestContext::get().options();
+    P4::IOptionPragmaParser::CommandLineOptions args = {
+        "(test)", "--diagnostics-format", "json"
+    };
+    options.process(args.size(), const_cast<char* const*>(args.data()));
+    EXPECT_TRUE(reporter.getDiagnosticFormat() == DiagnosticFormat::Json);
+
+    auto test = createP4_16DiagnosticsTestCase(P4_SOURCE(R"()"));
+    EXPECT_TRUE(test);
+    EXPECT_EQ(1u, ::diagnosticCount());
+
+    // Each diagnostic is a single JSON object on its own line.
+    std::string line;
+    ASSERT_TRUE(static_cast<bool>(std::getline(output, line)));
+    EXPECT_EQ(0u, line.find("{\"type\":\"warning\",\"name\":\"uninitialized_out_param\""));
+    EXPECT_NE(std::string::npos, line.find("\"locations\":[{\"file\":"));
+    EXPECT_EQ('}', line.back());
+    EXPECT_FALSE(static_cast<bool>(std::getline(output, line)));
+}
+
 }  // namespace Test
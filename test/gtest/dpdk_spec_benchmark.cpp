@@ -0,0 +1,106 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "ir/ir.h"
+#include "lib/stringify.h"
+#include "test/gtest/helpers.h"
+
+namespace Test {
+
+namespace {
+
+const IR::Expression* field(cstring base, cstring header, cstring name) {
+    return new IR::Member(new IR::Member(new IR::PathExpression(base), header), name);
+}
+
+/// Generate a DPDK program whose apply block has @instructions instructions,
+/// shaped like the generated code: header and metadata field moves,
+/// arithmetic, conditional jumps and labels.
+const IR::DpdkAsmProgram* generateProgram(unsigned instructions) {
+    IR::IndexedVector<IR::DpdkAsmStatement> stmts;
+    for (unsigned i = 0; stmts.size() < instructions; ++i) {
+        auto meta = new IR::Member(new IR::PathExpression("m"),
+                                   cstring("field_" + Util::toString(i % 64)));
+        auto label = cstring("label_" + Util::toString(i));
+        stmts.push_back(new IR::DpdkMovStatement(meta, field("h", "ipv4", "srcAddr")));
+        stmts.push_back(new IR::DpdkAddStatement(meta, meta, new IR::Constant(i)));
+        stmts.push_back(new IR::DpdkJmpEqualStatement(label, meta,
+                                                      field("h", "ipv4", "dstAddr")));
+        stmts.push_back(new IR::DpdkValidateStatement(
+            new IR::Member(new IR::PathExpression("h"), "ipv4")));
+        stmts.push_back(new IR::DpdkLabelStatement(label));
+    }
+    IR::IndexedVector<IR::DpdkAsmStatement> apply;
+    apply.push_back(new IR::DpdkListStatement(stmts));
+    return new IR::DpdkAsmProgram(
+        IR::IndexedVector<IR::DpdkHeaderType>(), IR::IndexedVector<IR::DpdkStructType>(),
+        IR::IndexedVector<IR::DpdkExternDeclaration>(), IR::IndexedVector<IR::DpdkAction>(),
+        IR::IndexedVector<IR::DpdkTable>(), IR::IndexedVector<IR::DpdkSelector>(), apply,
+        IR::IndexedVector<IR::DpdkDeclaration>());
+}
+
+/// Write the spec of @program and return the time spent, in seconds.
+double timeSpec(const IR::DpdkAsmProgram* program, std::ostream& out) {
+    auto start = std::chrono::steady_clock::now();
+    program->toSpec(out);
+    out.flush();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+}  // namespace
+
+class DpdkSpecBenchmark : public P4CTest { };
+
+TEST_F(DpdkSpecBenchmark, GeneratedProgramSpec) {
+    std::stringstream out;
+    timeSpec(generateProgram(5), out);
+    EXPECT_EQ(0u, ::errorCount());
+    EXPECT_EQ("\n"
+              "apply {\n"
+              "\trx m.psa_ingress_input_metadata_ingress_port\n"
+              "\tmov m.psa_ingress_output_metadata_drop 0x0\n"
+              "\tmov m.field_0 h.ipv4.srcAddr\n"
+              "\tadd m.field_0 0x0\n"
+              "\tjmpeq LABEL_0 m.field_0 h.ipv4.dstAddr\n"
+              "\tvalidate h.ipv4\n"
+              "\tLABEL_0 :"
+              "\ttx m.psa_ingress_output_metadata_egress_port\n"
+              "\tLABEL_DROP : drop\n"
+              "}\n"
+              "\n", out.str());
+}
+
+// Run with --gtest_also_run_disabled_tests; the sizes are too large for the
+// regular unit test run.
+TEST_F(DpdkSpecBenchmark, DISABLED_Throughput) {
+    for (unsigned instructions : { 1000u, 10000u, 100000u }) {
+        auto program = generateProgram(instructions);
+        std::stringstream out;
+        double seconds = timeSpec(program, out);
+        std::cout << instructions << " instructions (" << out.str().size() << " bytes): "
+                  << seconds << " s, "
+                  << static_cast<unsigned long>(instructions / seconds)
+                  << " instructions/s" << std::endl;
+    }
+}
+
+}  // namespace Test
@@ -0,0 +1,126 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <set>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "ir/ir.h"
+#include "helpers.h"
+
+#include "frontends/common/resolveReferences/referenceMap.h"
+#include "frontends/p4/typeChecking/typeChecker.h"
+#include "frontends/p4/typeMap.h"
+#include "midend/flowCache.h"
+
+using namespace P4;
+
+namespace Test {
+
+class P4CFlowCache : public P4CTest { };
+
+namespace {
+
+const P4::FlowCacheRegion* findRegion(const std::string &apply,
+                                      FindFlowCacheRegions** find = nullptr) {
+    std::string source = P4_SOURCE(P4Headers::CORE, R"(
+        header h_t { bit<32> src; bit<32> dst; bit<8> ttl; }
+        struct meta_t { bit<9> port; bit<16> tmp; bit<8> cls; }
+        control c(inout h_t h, inout meta_t m) {
+            action set_port(bit<9> p) { m.port = p; h.ttl = h.ttl - 1; }
+            action classify(bit<8> cls) { m.cls = cls; }
+            table route {
+                key = { h.dst : exact; }
+                actions = { set_port; NoAction; }
+                default_action = NoAction();
+            }
+            table acl {
+                key = { m.tmp : exact; }
+                actions = { classify; NoAction; }
+                default_action = NoAction();
+            }
+            apply { %APPLY% }
+        }
+    )");
+    source.replace(source.find("%APPLY%"), std::string("%APPLY%").size(), apply);
+    auto test = FrontendTestCase::create(source);
+    if (!test)
+        return nullptr;
+
+    ReferenceMap refMap;
+    TypeMap typeMap;
+    TypeChecking typeChecking(&refMap, &typeMap);
+    auto program = test->program->apply(typeChecking);
+    auto regions = new FindFlowCacheRegions(&refMap, &typeMap);
+    program->apply(*regions);
+    if (find != nullptr)
+        *find = regions;
+    if (regions->regions.size() != 1)
+        return nullptr;
+    return regions->regions.begin()->second;
+}
+
+std::set<std::string> names(const std::vector<const IR::Expression*> &fields) {
+    std::set<std::string> result;
+    for (auto f : fields)
+        result.emplace(f->toString().c_str());
+    return result;
+}
+
+}  // namespace
+
+TEST_F(P4CFlowCache, KeyAndValue) {
+    auto region = findRegion(R"(
+        @flow_cache(4096) {
+            route.apply();
+            m.tmp = h.src[15:0];
+            acl.apply();
+        })");
+    ASSERT_TRUE(region != nullptr);
+    EXPECT_EQ(4096u, region->size);
+    // m.tmp is written before acl reads it; m.port and m.cls keep their
+    // value when the tables miss.
+    EXPECT_EQ((std::set<std::string>{ "h.dst", "h.ttl", "h.src", "m.port", "m.cls" }),
+              names(region->key));
+    EXPECT_EQ((std::set<std::string>{ "m.port", "h.ttl", "m.tmp", "m.cls" }),
+              names(region->value));
+    EXPECT_EQ(2u, region->tables.size());
+}
+
+TEST_F(P4CFlowCache, DefaultSize) {
+    auto region = findRegion(R"(
+        @flow_cache {
+            m.tmp = h.src[15:0];
+        })");
+    ASSERT_TRUE(region != nullptr);
+    EXPECT_EQ(FindFlowCacheRegions::defaultSize, region->size);
+    EXPECT_EQ((std::set<std::string>{ "h.src" }), names(region->key));
+    EXPECT_EQ((std::set<std::string>{ "m.tmp" }), names(region->value));
+}
+
+TEST_F(P4CFlowCache, BuiltinMethodIsNotCached) {
+    FindFlowCacheRegions* find = nullptr;
+    auto region = findRegion(R"(
+        @flow_cache {
+            if (h.isValid())
+                route.apply();
+        })", &find);
+    EXPECT_TRUE(region == nullptr);
+    ASSERT_TRUE(find != nullptr);
+    EXPECT_TRUE(find->regions.empty());
+    EXPECT_EQ(0u, ::errorCount());
+    EXPECT_GT(::diagnosticCount(), 0u);
+}
+
+}  // namespace Test
@@ -0,0 +1,108 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "frontends/parsers/parserDriver.h"
+#include "ir/ir.h"
+#include "test/gtest/helpers.h"
+
+namespace Test {
+
+namespace {
+
+/// Generate a P4-16 program of roughly @targetLines lines, shaped like the
+/// machine-generated table-heavy programs the parser is most often fed: many
+/// tables with wide keys and long lists of constant entries.
+std::string generateTableHeavyProgram(unsigned targetLines) {
+    static const unsigned entriesPerTable = 32;
+    std::stringstream out;
+    unsigned lines = 0;
+
+    out << "header h_t {\n";
+    for (unsigned f = 0; f < 8; ++f)
+        out << "    bit<32> f" << f << ";\n";
+    out << "}\n";
+    out << "control ingress(inout h_t h) {\n";
+    lines += 11;
+
+    unsigned table = 0;
+    while (lines < targetLines) {
+        out << "    action set_" << table << "(bit<32> v, bit<16> port) {\n"
+            << "        h.f0 = v; h.f1 = (bit<32>)port + 32w" << table << ";\n"
+            << "    }\n"
+            << "    table t_" << table << " {\n"
+            << "        key = { h.f0 : exact; h.f1 : ternary; h.f2 : lpm; }\n"
+            << "        actions = { set_" << table << "; NoAction; }\n"
+            << "        const entries = {\n";
+        for (unsigned e = 0; e < entriesPerTable; ++e)
+            out << "            (32w" << e << ", 0x" << std::hex << (e << 8) << std::dec
+                << " &&& 0xffff00ff, 8w10 ++ 24w" << e * 7 << ") : set_" << table
+                << "(" << e << ", 16w" << table % 65536 << ");\n";
+        out << "        }\n"
+            << "        default_action = NoAction();\n"
+            << "    }\n";
+        lines += 10 + entriesPerTable;
+        ++table;
+    }
+
+    out << "    apply {\n";
+    for (unsigned t = 0; t < table; ++t)
+        out << "        t_" << t << ".apply();\n";
+    out << "    }\n"
+        << "}\n";
+    return out.str();
+}
+
+/// Parse @source and return the time spent in the parser, in seconds.
+double timeParse(const std::string& source, const IR::P4Program** program) {
+    std::istringstream in(source);
+    auto start = std::chrono::steady_clock::now();
+    *program = P4::P4ParserDriver::parse(in, "benchmark.p4");
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+}  // namespace
+
+class P4ParserBenchmark : public P4CTest { };
+
+TEST_F(P4ParserBenchmark, GeneratedProgramParses) {
+    const IR::P4Program* program = nullptr;
+    timeParse(generateTableHeavyProgram(1000), &program);
+    ASSERT_TRUE(program != nullptr);
+    EXPECT_EQ(0u, ::errorCount());
+    EXPECT_EQ(2u, program->objects.size());
+}
+
+// Run with --gtest_also_run_disabled_tests; the sizes are too large for the
+// regular unit test run.
+TEST_F(P4ParserBenchmark, DISABLED_Throughput) {
+    for (unsigned lines : { 1000u, 10000u, 100000u, 1000000u }) {
+        auto source = generateTableHeavyProgram(lines);
+        const IR::P4Program* program = nullptr;
+        double seconds = timeParse(source, &program);
+        ASSERT_TRUE(program != nullptr);
+        std::cout << lines << " lines (" << source.size() << " bytes): "
+                  << seconds << " s, " << static_cast<unsigned long>(lines / seconds)
+                  << " lines/s" << std::endl;
+    }
+}
+
+}  // namespace Test
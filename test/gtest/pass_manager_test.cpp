@@ -0,0 +1,124 @@
+/*
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <map>
+
+#include "gtest/gtest.h"
+#include "ir/ir.h"
+#include "ir/pass_manager.h"
+#include "ir/visitor.h"
+
+namespace Test {
+
+namespace {
+
+/// Increments the initializer of constant `a` until it reaches 3; leaves all
+/// other constants alone.  Counts how often each declaration is visited.
+class BumpConstantA : public Transform {
+    std::map<cstring, unsigned> &visits;
+
+ public:
+    explicit BumpConstantA(std::map<cstring, unsigned> &visits) : visits(visits) {}
+    const IR::Node *postorder(IR::Declaration_Constant *decl) override {
+        visits[decl->name.name]++;
+        auto value = decl->initializer->to<IR::Constant>()->asInt();
+        if (decl->name.name == "a" && value < 3)
+            decl->initializer = new IR::Constant(IR::Type_Bits::get(8), value + 1);
+        return decl;
+    }
+};
+
+/// Like BumpConstantA, but asks to visit constant `b` even once it converged.
+class BumpConstantAVisitB : public BumpConstantA {
+ public:
+    explicit BumpConstantAVisitB(std::map<cstring, unsigned> &visits) : BumpConstantA(visits) {}
+    bool visitConverged(const IR::Node *n) const override {
+        auto decl = n->to<IR::Declaration_Constant>();
+        return decl && decl->name.name == "b";
+    }
+};
+
+/// Counts how often each constant is inspected.
+class CountConstants : public Inspector {
+    std::map<cstring, unsigned> &visits;
+
+ public:
+    explicit CountConstants(std::map<cstring, unsigned> &visits) : visits(visits) {}
+    void postorder(const IR::Declaration_Constant *decl) override {
+        visits[decl->name.name]++;
+    }
+};
+
+const IR::P4Program *makeProgram() {
+    IR::Vector<IR::Node> objects;
+    for (auto name : { "a", "b", "c" })
+        objects.push_back(new IR::Declaration_Constant(
+            IR::ID(name), IR::Type_Bits::get(8), new IR::Constant(IR::Type_Bits::get(8), 0)));
+    return new IR::P4Program(objects);
+}
+
+unsigned valueOf(const IR::P4Program *program, cstring name) {
+    for (auto node : program->objects)
+        if (auto decl = node->to<IR::Declaration_Constant>())
+            if (decl->name.name == name)
+                return decl->initializer->to<IR::Constant>()->asInt();
+    return ~0U;
+}
+
+}  // namespace
+
+TEST(PassRepeated, Convergence) {
+    std::map<cstring, unsigned> visits;
+    PassRepeated repeated{ new BumpConstantA(visits) };
+    auto program = makeProgram()->apply(repeated);
+
+    EXPECT_EQ(3u, valueOf(program, "a"));
+    EXPECT_EQ(0u, valueOf(program, "b"));
+    // Three changing iterations plus one to detect convergence.
+    EXPECT_EQ(4u, visits["a"]);
+    EXPECT_EQ(4u, visits["b"]);
+    EXPECT_EQ(4u, visits["c"]);
+}
+
+TEST(PassRepeated, Incremental) {
+    std::map<cstring, unsigned> visits;
+    PassRepeated repeated{ new BumpConstantA(visits) };
+    repeated.setIncremental();
+    auto program = makeProgram()->apply(repeated);
+
+    EXPECT_EQ(3u, valueOf(program, "a"));
+    EXPECT_EQ(0u, valueOf(program, "b"));
+    // Declarations that did not change in the first iteration are not revisited.
+    EXPECT_EQ(4u, visits["a"]);
+    EXPECT_EQ(1u, visits["b"]);
+    EXPECT_EQ(1u, visits["c"]);
+}
+
+TEST(PassRepeated, IncrementalVisitConverged) {
+    std::map<cstring, unsigned> visits, inspected;
+    PassRepeated repeated{ new BumpConstantAVisitB(visits), new CountConstants(inspected) };
+    repeated.setIncremental();
+    auto program = makeProgram()->apply(repeated);
+
+    EXPECT_EQ(3u, valueOf(program, "a"));
+    EXPECT_EQ(4u, visits["a"]);
+    EXPECT_EQ(4u, visits["b"]);
+    EXPECT_EQ(1u, visits["c"]);
+    // Inspectors see converged declarations too.
+    EXPECT_EQ(4u, inspected["a"]);
+    EXPECT_EQ(4u, inspected["b"]);
+    EXPECT_EQ(4u, inspected["c"]);
+}
+
+}  // namespace Test
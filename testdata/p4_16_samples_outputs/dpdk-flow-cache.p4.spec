@@ -0,0 +1,181 @@
+
+struct ethernet_t {
+	bit<48> dstAddr
+	bit<48> srcAddr
+	bit<16> etherType
+}
+
+struct ipv4_t {
+	bit<4> version
+	bit<4> ihl
+	bit<8> diffserv
+	bit<16> totalLen
+	bit<16> identification
+	bit<3> flags
+	bit<13> fragOffset
+	bit<8> ttl
+	bit<8> protocol
+	bit<16> hdrChecksum
+	bit<32> srcAddr
+	bit<32> dstAddr
+}
+
+struct EMPTY {
+	bit<32> psa_ingress_parser_input_metadata_ingress_port
+	bit<32> psa_ingress_parser_input_metadata_packet_path
+	bit<32> psa_egress_parser_input_metadata_egress_port
+	bit<32> psa_egress_parser_input_metadata_packet_path
+	bit<32> psa_ingress_input_metadata_ingress_port
+	bit<32> psa_ingress_input_metadata_packet_path
+	bit<64> psa_ingress_input_metadata_ingress_timestamp
+	bit<8> psa_ingress_input_metadata_parser_error
+	bit<8> psa_ingress_output_metadata_class_of_service
+	bit<8> psa_ingress_output_metadata_clone
+	bit<16> psa_ingress_output_metadata_clone_session_id
+	bit<8> psa_ingress_output_metadata_drop
+	bit<8> psa_ingress_output_metadata_resubmit
+	bit<32> psa_ingress_output_metadata_multicast_group
+	bit<32> psa_ingress_output_metadata_egress_port
+	bit<8> psa_egress_input_metadata_class_of_service
+	bit<32> psa_egress_input_metadata_egress_port
+	bit<32> psa_egress_input_metadata_packet_path
+	bit<16> psa_egress_input_metadata_instance
+	bit<64> psa_egress_input_metadata_egress_timestamp
+	bit<8> psa_egress_input_metadata_parser_error
+	bit<32> psa_egress_deparser_input_metadata_egress_port
+	bit<8> psa_egress_output_metadata_clone
+	bit<16> psa_egress_output_metadata_clone_session_id
+	bit<8> psa_egress_output_metadata_drop
+	bit<32> Ingress_acl_ipv4_srcAddr
+	bit<8> Ingress_acl_ipv4_protocol
+	bit<32> Ingress_MyIC_flow_cache_ipv4_dstAddr
+	bit<32> Ingress_MyIC_flow_cache_ipv4_srcAddr
+	bit<8> Ingress_MyIC_flow_cache_ipv4_protocol
+}
+metadata instanceof EMPTY
+
+header ethernet instanceof ethernet_t
+header ipv4 instanceof ipv4_t
+
+struct MyIC_flow_cache_hit_arg_t {
+	bit<32> d_egress_port
+	bit<8> d_drop
+}
+
+struct set_port_arg_t {
+	bit<32> port
+}
+
+struct psa_ingress_output_metadata_t {
+	bit<8> class_of_service
+	bit<8> clone
+	bit<16> clone_session_id
+	bit<8> drop
+	bit<8> resubmit
+	bit<32> multicast_group
+	bit<32> egress_port
+}
+
+struct psa_egress_output_metadata_t {
+	bit<8> clone
+	bit<16> clone_session_id
+	bit<8> drop
+}
+
+struct psa_egress_deparser_input_metadata_t {
+	bit<32> egress_port
+}
+
+action NoAction args none {
+	return
+}
+
+action drop args none {
+	mov m.psa_ingress_output_metadata_drop 1
+	return
+}
+
+action set_port args instanceof set_port_arg_t {
+	mov m.psa_ingress_output_metadata_egress_port t.port
+	return
+}
+
+action MyIC_flow_cache_hit args instanceof MyIC_flow_cache_hit_arg_t {
+	mov m.psa_ingress_output_metadata_egress_port t.d_egress_port
+	mov m.psa_ingress_output_metadata_drop t.d_drop
+	return
+}
+
+action MyIC_flow_cache_miss args none {
+	return
+}
+
+table route {
+	key {
+		h.ipv4.dstAddr lpm
+	}
+	actions {
+		set_port
+		drop
+	}
+	default_action drop args none 
+	size 0x10000
+}
+
+
+table acl {
+	key {
+		m.Ingress_acl_ipv4_srcAddr wildcard
+		m.Ingress_acl_ipv4_protocol exact
+	}
+	actions {
+		drop
+		NoAction
+	}
+	default_action NoAction args none 
+	size 0x10000
+}
+
+
+table MyIC_flow_cache {
+	key {
+		m.Ingress_MyIC_flow_cache_ipv4_dstAddr exact
+		m.Ingress_MyIC_flow_cache_ipv4_srcAddr exact
+		m.Ingress_MyIC_flow_cache_ipv4_protocol exact
+		m.psa_ingress_output_metadata_egress_port exact
+		m.psa_ingress_output_metadata_drop exact
+	}
+	actions {
+		MyIC_flow_cache_hit
+		MyIC_flow_cache_miss
+	}
+	default_action MyIC_flow_cache_miss args none 
+	size 0x1000
+}
+
+
+apply {
+	rx m.psa_ingress_input_metadata_ingress_port
+	mov m.psa_ingress_output_metadata_drop 0x0
+	extract h.ethernet
+	jmpeq MYIP_PARSE_IPV4 h.ethernet.etherType 0x800
+	jmp MYIP_ACCEPT
+	MYIP_PARSE_IPV4 :	extract h.ipv4
+	MYIP_ACCEPT :	jmpnv LABEL_0END h.ipv4
+	mov m.Ingress_MyIC_flow_cache_ipv4_dstAddr h.ipv4.dstAddr
+	mov m.Ingress_MyIC_flow_cache_ipv4_srcAddr h.ipv4.srcAddr
+	mov m.Ingress_MyIC_flow_cache_ipv4_protocol h.ipv4.protocol
+	table MyIC_flow_cache
+	jmph LABEL_0END
+	table route
+	mov m.Ingress_acl_ipv4_srcAddr h.ipv4.srcAddr
+	mov m.Ingress_acl_ipv4_protocol h.ipv4.protocol
+	table acl
+	LABEL_0END :	jmpneq LABEL_DROP m.psa_ingress_output_metadata_drop 0x0
+	emit h.ethernet
+	emit h.ipv4
+	tx m.psa_ingress_output_metadata_egress_port
+	LABEL_DROP : drop
+}
+
+
@@ -0,0 +1,132 @@
+
+struct ethernet_t {
+	bit<48> dstAddr
+	bit<48> srcAddr
+	bit<16> etherType
+}
+
+struct ipv4_t {
+	bit<4> version
+	bit<4> ihl
+	bit<8> diffserv
+	bit<16> totalLen
+	bit<16> identification
+	bit<3> flags
+	bit<13> fragOffset
+	bit<8> ttl
+	bit<8> protocol
+	bit<16> hdrChecksum
+	bit<32> srcAddr
+	bit<32> dstAddr
+}
+
+header ethernet instanceof ethernet_t
+header ipv4 instanceof ipv4_t
+
+struct metadata_t {
+	bit<32> psa_ingress_input_metadata_ingress_port
+	bit<32> psa_ingress_output_metadata_egress_port
+	bit<16> local_metadata_port_hash
+	bit<48> local_metadata_mac
+	bit<8> psa_ingress_output_metadata_drop
+	bit<8> local_metadata_cls
+	bit<8> Ingress_classify_ipv4_protocol
+	bit<8> psa_ingress_input_metadata_parser_error
+	bit<16> Ingress_classify_ipv4_identification
+	bit<1> local_metadata_flag
+	bit<7> local_metadata_unused7
+	bit<8> psa_ingress_output_metadata_class_of_service
+	bit<64> psa_ingress_input_metadata_ingress_timestamp
+	bit<64> psa_egress_input_metadata_egress_timestamp
+	bit<32> psa_ingress_parser_input_metadata_ingress_port
+	bit<32> psa_ingress_parser_input_metadata_packet_path
+	bit<32> psa_egress_parser_input_metadata_egress_port
+	bit<32> psa_egress_parser_input_metadata_packet_path
+	bit<32> psa_ingress_input_metadata_packet_path
+	bit<32> psa_ingress_output_metadata_multicast_group
+	bit<32> psa_egress_input_metadata_egress_port
+	bit<32> psa_egress_input_metadata_packet_path
+	bit<32> psa_egress_deparser_input_metadata_egress_port
+	bit<32> local_metadata_unused32
+	bit<16> psa_ingress_output_metadata_clone_session_id
+	bit<16> psa_egress_input_metadata_instance
+	bit<16> psa_egress_output_metadata_clone_session_id
+	bit<8> psa_ingress_output_metadata_clone
+	bit<8> psa_ingress_output_metadata_resubmit
+	bit<8> psa_egress_input_metadata_class_of_service
+	bit<8> psa_egress_input_metadata_parser_error
+	bit<8> psa_egress_output_metadata_clone
+	bit<8> psa_egress_output_metadata_drop
+}
+metadata instanceof metadata_t
+
+struct set_mac_arg_t {
+	bit<48> mac
+}
+
+struct psa_ingress_output_metadata_t {
+	bit<8> class_of_service
+	bit<8> clone
+	bit<16> clone_session_id
+	bit<8> drop
+	bit<8> resubmit
+	bit<32> multicast_group
+	bit<32> egress_port
+}
+
+struct psa_egress_output_metadata_t {
+	bit<8> clone
+	bit<16> clone_session_id
+	bit<8> drop
+}
+
+struct psa_egress_deparser_input_metadata_t {
+	bit<32> egress_port
+}
+
+action NoAction args none {
+	return
+}
+
+action set_mac args instanceof set_mac_arg_t {
+	mov m.local_metadata_flag 0x1
+	mov m.local_metadata_mac t.mac
+	return
+}
+
+table classify {
+	key {
+		m.Ingress_classify_ipv4_protocol exact
+		m.Ingress_classify_ipv4_identification exact
+	}
+	actions {
+		set_mac
+		NoAction
+	}
+	default_action NoAction args none 
+	size 0x10000
+}
+
+
+apply {
+	rx m.psa_ingress_input_metadata_ingress_port
+	mov m.psa_ingress_output_metadata_drop 0x0
+	extract h.ethernet
+	jmpeq MYIP_PARSE_IPV4 h.ethernet.etherType 0x800
+	jmp MYIP_ACCEPT
+	MYIP_PARSE_IPV4 :	extract h.ipv4
+	MYIP_ACCEPT :	mov m.local_metadata_cls h.ipv4.protocol
+	mov m.local_metadata_port_hash h.ipv4.identification
+	mov m.Ingress_classify_ipv4_protocol h.ipv4.protocol
+	mov m.Ingress_classify_ipv4_identification h.ipv4.identification
+	table classify
+	jmpneq LABEL_0END m.local_metadata_flag 0x1
+	mov h.ethernet.dstAddr m.local_metadata_mac
+	LABEL_0END :	jmpneq LABEL_DROP m.psa_ingress_output_metadata_drop 0x0
+	emit h.ethernet
+	emit h.ipv4
+	tx m.psa_ingress_output_metadata_egress_port
+	LABEL_DROP : drop
+}
+
+
@@ -92,9 +92,9 @@ apply {
 	jmpeq MYIP_PARSE_VLAN_TAG1 h.vlan_tag_0.ether_type 0x8100
 	jmp MYIP_ACCEPT
 	MYIP_PARSE_VLAN_TAG1 :	extract h.vlan_tag_1
-	jmpeq MYIP_PARSE_VLAN_TAG2 h.vlan_tag_1.ether_type 0x8100
+	jmpeq MYIP_STATEOUTOFBOUND h.vlan_tag_1.ether_type 0x8100
 	jmp MYIP_ACCEPT
-	MYIP_PARSE_VLAN_TAG2 :	verify 0 error.StackOutOfBounds
+	MYIP_STATEOUTOFBOUND :	verify 0 error.StackOutOfBounds
 	MYIP_ACCEPT :	jmpnv LABEL_0FALSE h.ethernet
 	jmp LABEL_0END
 	LABEL_0FALSE :	table tbl